@@ -1,22 +1,38 @@
 
+find_package(Threads REQUIRED)
+
 add_library(${per_lib} ${per-lib-type})
 
+if (per-lib-type STREQUAL INTERFACE)
+    set(_per_scope INTERFACE)
+else ()
+    # the compiled mode: consumers see the extern template declarations and link against the
+    # explicit instantiations instead of instantiating the templates themselves
+    set(_per_scope PUBLIC)
+    target_sources(${per_lib} PRIVATE ${PROJECT_PER_SRC_DIR}/instantiations.cpp)
+    target_compile_definitions(${per_lib} PUBLIC PER_COMPILED_LIBRARY)
+    # the library may be linked into the python extension module
+    set_target_properties(${per_lib} PROPERTIES POSITION_INDEPENDENT_CODE ON)
+endif ()
+
 target_include_directories(
         ${per_lib}
-        INTERFACE
+        ${_per_scope}
         $<BUILD_INTERFACE:${PROJECT_PER_INCLUDE_DIR}>
         $<INSTALL_INTERFACE:${CMAKE_INSTALL_INCLUDEDIR}>
 )
 
 target_link_libraries(
         ${per_lib}
-        INTERFACE
+        ${_per_scope}
         project_options
         CONAN_PKG::cppitertools
+        Threads::Threads
+        $<$<PLATFORM_ID:Linux>:rt>
 )
 
 set_target_properties(
         ${per_lib}
         PROPERTIES
         CXX_VISIBILITY_PRESET hidden
-)
\ No newline at end of file
+)
@@ -2,6 +2,17 @@ set(PYTHON_MODULE_SOURCES
         module.cpp
         init_sumtree.cpp
         init_experience_replay.cpp
+        init_compression.cpp
+        init_byte_arena.cpp
+        init_journal.cpp
+        init_multi_buffer.cpp
+        init_multi_channel.cpp
+        init_rank_based.cpp
+        init_prefetch.cpp
+        init_rate_limiter.cpp
+        init_shared_experience.cpp
+        init_replay_server.cpp
+        instantiations.cpp
         )
 list(TRANSFORM PYTHON_MODULE_SOURCES PREPEND "${PROJECT_PER_BINDING_DIR}/")
 
@@ -0,0 +1,18 @@
+set(per_server per_server)
+set(per_server_bench per_server_bench)
+
+add_executable(${per_server} ${PROJECT_SRC_DIR}/server/per_server.cpp)
+add_executable(${per_server_bench} ${PROJECT_SRC_DIR}/server/per_server_bench.cpp)
+
+foreach (target ${per_server} ${per_server_bench})
+    target_link_libraries(${target}
+            PRIVATE
+            project_warnings
+            ${per_lib}
+            )
+endforeach ()
+
+install(
+        TARGETS ${per_server}
+        RUNTIME DESTINATION ${CMAKE_INSTALL_BINDIR} COMPONENT Runtime
+)
@@ -2,8 +2,22 @@
 set(TEST_SOURCES
         test_sumtree.cpp
         test_per.cpp
+        test_alias_table.cpp
+        test_compression.cpp
+        test_byte_arena.cpp
+        test_multi_buffer.cpp
+        test_multi_channel.cpp
+        test_rank_based.cpp
+        test_prefetch.cpp
+        test_rate_limiter.cpp
+        test_philox.cpp
+        test_simd_math.cpp
         tests.cpp
         )
+if (UNIX)
+    # the shared-memory buffer, the replay server and the journal rely on POSIX
+    list(APPEND TEST_SOURCES test_shared_experience.cpp test_replay_server.cpp test_journal.cpp)
+endif ()
 list(TRANSFORM TEST_SOURCES PREPEND "${PROJECT_TEST_DIR}/")
 
 add_executable(${per_test} ${TEST_SOURCES})
@@ -0,0 +1,40 @@
+// Explicit instantiations of the class templates for common value types. Translation units
+// including the headers with PER_COMPILED_LIBRARY defined skip the instantiation of these and link
+// against the ones compiled here instead.
+
+#include "per/per.hpp"
+
+namespace per {
+
+template class SumTree< int >;
+template class SumTree< double >;
+template class SumTree< size_t >;
+template class SumTree< ::std::string >;
+
+template class SumTree< ::std::pair< int, double > >;
+template class SumTree< ::std::pair< double, double > >;
+template class SumTree< ::std::pair< ::std::string, double > >;
+
+template class PrioritizedExperience< int >;
+template class PrioritizedExperience< double >;
+template class PrioritizedExperience< ::std::string >;
+
+template class MultiBuffer< int >;
+template class MultiBuffer< double >;
+template class MultiBuffer< ::std::string >;
+
+template class MultiChannelExperience< int >;
+template class MultiChannelExperience< double >;
+template class MultiChannelExperience< ::std::string >;
+
+template class RankBasedExperience< int >;
+template class RankBasedExperience< double >;
+template class RankBasedExperience< ::std::string >;
+
+#if OS == LINUX || OS == MAC
+template class JournaledExperience< int >;
+template class JournaledExperience< double >;
+template class JournaledExperience< ::std::string >;
+#endif
+
+}  // namespace per
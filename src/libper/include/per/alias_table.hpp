@@ -0,0 +1,182 @@
+#ifndef PER_ALIAS_TABLE_HPP
+#define PER_ALIAS_TABLE_HPP
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <vector>
+
+#include "per/macro.hpp"
+#include "per/thread_pool.hpp"
+
+namespace per {
+
+/**
+ * Walker's alias table (in Vose's construction) for O(1) draws from a fixed discrete distribution.
+ *
+ * The table is built in O(n) from non-negative weights. Every entry i holds the probability to
+ * keep i and an alias to return otherwise, hence a draw costs one uniform, one multiplication and
+ * one comparison.
+ *
+ * For a parallel build the weights are split into contiguous chunks, each of which receives its own
+ * alias table, while a small alias table over the chunk totals chooses the chunk. A draw then takes
+ * two O(1) steps and the distribution remains exact.
+ */
+class PER_API AliasTable {
+  public:
+   /// the minimal number of weights per chunk of a parallel build
+   static constexpr size_t min_chunk_size = 1 << 14;
+
+   /**
+    * Build the table from the weights in [@p first, @p last).
+    *
+    * If all weights are 0 the table draws uniformly.
+    * @tparam Iter a random access iterator over doubles.
+    * @param first the iterator to the first weight.
+    * @param last the iterator past the last weight.
+    * @param pool the optional pool to build the chunk tables on concurrently.
+    */
+   template < typename Iter >
+   void build(Iter first, Iter last, ThreadPool *pool = nullptr);
+
+   /**
+    * Draw an index.
+    * @param u_chunk a uniform random number in [0, 1) choosing the chunk.
+    * @param u_entry a uniform random number in [0, 1) choosing the entry within the chunk.
+    * @return the drawn index.
+    */
+   [[nodiscard]] size_t draw(double u_chunk, double u_entry) const
+   {
+      size_t chunk = _pick(m_chunk_prob, m_chunk_alias, 0, m_chunk_prob.size(), u_chunk);
+      return _pick(m_prob, m_alias, m_bounds[chunk], m_bounds[chunk + 1], u_entry);
+   }
+
+   /**
+    * Getter for the number of weights the table was built from.
+    * @return the size.
+    */
+   [[nodiscard]] size_t size() const { return m_prob.size(); }
+   /**
+    * Getter for the number of chunks the table was built in.
+    * @return the number of chunks.
+    */
+   [[nodiscard]] size_t n_chunks() const { return m_chunk_prob.size(); }
+
+  private:
+   /// the probability to keep each entry
+   ::std::vector< double > m_prob;
+   /// the alias of each entry
+   ::std::vector< size_t > m_alias;
+   /// the first index of each chunk, followed by the size
+   ::std::vector< size_t > m_bounds;
+   /// the probability to keep each chunk
+   ::std::vector< double > m_chunk_prob;
+   /// the alias of each chunk
+   ::std::vector< size_t > m_chunk_alias;
+
+   /**
+    * Fill the keep probabilities and aliases of the range [@p first, @p last) with Vose's method.
+    *
+    * On entry @p prob holds the weights of the range, which are replaced by the keep
+    * probabilities.
+    * @return the total weight of the range.
+    */
+   static double _vose(
+      ::std::vector< double > &prob,
+      ::std::vector< size_t > &alias,
+      size_t first,
+      size_t last);
+
+   [[nodiscard]] static size_t _pick(
+      const ::std::vector< double > &prob,
+      const ::std::vector< size_t > &alias,
+      size_t first,
+      size_t last,
+      double u)
+   {
+      double x = u * static_cast< double >(last - first);
+      auto offset = ::std::min(static_cast< size_t >(x), last - first - 1);
+      size_t index = first + offset;
+      // the fractional part of x serves as the uniform of the keep decision
+      return x - static_cast< double >(offset) < prob[index] ? index : alias[index];
+   }
+};
+
+template < typename Iter >
+void AliasTable::build(Iter first, Iter last, ThreadPool *pool)
+{
+   auto n = static_cast< size_t >(::std::distance(first, last));
+   m_prob.assign(first, last);
+   m_alias.resize(n);
+
+   size_t n_chunks = 1;
+   if(pool != nullptr and pool->size() > 1) {
+      n_chunks = ::std::clamp(n / min_chunk_size, size_t(1), pool->size());
+   }
+   m_bounds.resize(n_chunks + 1);
+   for(size_t c = 0; c <= n_chunks; c++) {
+      m_bounds[c] = n * c / n_chunks;
+   }
+
+   m_chunk_prob.resize(n_chunks);
+   m_chunk_alias.resize(n_chunks);
+   if(n_chunks == 1) {
+      m_chunk_prob[0] = _vose(m_prob, m_alias, 0, n);
+   } else {
+      ::std::vector< ::std::future< double > > totals;
+      totals.reserve(n_chunks);
+      for(size_t c = 0; c < n_chunks; c++) {
+         totals.emplace_back(pool->submit(
+            [this, c] { return _vose(m_prob, m_alias, m_bounds[c], m_bounds[c + 1]); }));
+      }
+      for(size_t c = 0; c < n_chunks; c++) {
+         m_chunk_prob[c] = totals[c].get();
+      }
+   }
+   _vose(m_chunk_prob, m_chunk_alias, 0, n_chunks);
+}
+
+inline double AliasTable::_vose(
+   ::std::vector< double > &prob,
+   ::std::vector< size_t > &alias,
+   size_t first,
+   size_t last)
+{
+   double total = 0.;
+   for(size_t i = first; i < last; i++) {
+      total += prob[i];
+   }
+   auto n = static_cast< double >(last - first);
+   ::std::vector< size_t > small;
+   ::std::vector< size_t > large;
+   for(size_t i = first; i < last; i++) {
+      // scale the weights to a mean of 1. A zero total falls back to the uniform distribution.
+      prob[i] = total > 0. ? prob[i] * n / total : 1.;
+      alias[i] = i;
+      (prob[i] < 1. ? small : large).emplace_back(i);
+   }
+   while(not small.empty() and not large.empty()) {
+      size_t less = small.back();
+      small.pop_back();
+      size_t more = large.back();
+      alias[less] = more;
+      // the large entry donates the missing mass of the small one
+      prob[more] -= 1. - prob[less];
+      if(prob[more] < 1.) {
+         large.pop_back();
+         small.emplace_back(more);
+      }
+   }
+   // the remaining entries are (up to rounding errors) exactly full
+   for(auto i : large) {
+      prob[i] = 1.;
+   }
+   for(auto i : small) {
+      prob[i] = 1.;
+   }
+   return total;
+}
+
+}  // namespace per
+
+#endif  // PER_ALIAS_TABLE_HPP
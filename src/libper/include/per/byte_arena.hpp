@@ -0,0 +1,362 @@
+#ifndef PER_BYTE_ARENA_HPP
+#define PER_BYTE_ARENA_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "per/experience_replay.hpp"
+#include "per/macro.hpp"
+
+namespace per {
+
+/**
+ * Handle of a payload stored in a `ByteArena`.
+ */
+struct ArenaHandle {
+   /// the position of the first byte within the arena
+   ::std::uint64_t offset = 0;
+   /// the number of bytes
+   ::std::uint64_t length = 0;
+};
+
+/**
+ * Ring-shaped byte arena whose allocations are released in the order they were made (FIFO).
+ *
+ * Every allocation is a contiguous byte range. An allocation that does not fit between the write
+ * position and the end of the arena wraps around to the front, leaving the remaining tail unused
+ * until the write position passes it again. The memory is allocated once at construction, hence
+ * allocating and releasing never touches the heap.
+ *
+ * Empty allocations occupy no range. They are placed at the end of the arena (offset `capacity()`)
+ * and may be released at any time, i.e. they take no part in the FIFO order.
+ */
+class PER_API ByteArena {
+  public:
+   /**
+    * The constructor.
+    * @param capacity the number of bytes of the arena.
+    */
+   explicit ByteArena(size_t capacity) : m_data(capacity), m_wrap(capacity) {}
+
+   /**
+    * Allocate a contiguous range of @p length bytes.
+    * @param length the number of bytes.
+    * @return the handle of the range or an empty optional, if the free space does not suffice
+    * until the oldest allocations are released.
+    */
+   [[nodiscard]] ::std::optional< ArenaHandle > allocate(size_t length);
+   /**
+    * Release the oldest allocation.
+    * @param handle the handle of the oldest allocation (or of an empty allocation).
+    * @throw ::std::logic_error if @p handle is neither the oldest nor an empty allocation.
+    */
+   void release(const ArenaHandle &handle);
+
+   /**
+    * Access the bytes of an allocation.
+    * @param handle the handle of the allocation.
+    * @return a pointer to the first byte.
+    */
+   [[nodiscard]] char *data(const ArenaHandle &handle) { return m_data.data() + handle.offset; }
+   /**
+    * View the bytes of an allocation.
+    * @param handle the handle of the allocation.
+    * @return a view of the bytes, valid until the allocation is released.
+    */
+   [[nodiscard]] ::std::string_view view(const ArenaHandle &handle) const
+   {
+      return {m_data.data() + handle.offset, handle.length};
+   }
+
+   /**
+    * Getter for the number of bytes of the arena.
+    * @return the capacity.
+    */
+   [[nodiscard]] size_t capacity() const { return m_data.size(); }
+   /**
+    * Getter for the number of bytes held by live allocations (excluding unused tails).
+    * @return the number of used bytes.
+    */
+   [[nodiscard]] size_t used() const { return m_used; }
+   /**
+    * Getter for the number of live allocations.
+    * @return the number of allocations.
+    */
+   [[nodiscard]] size_t count() const { return m_count; }
+
+  private:
+   /// the bytes of the arena
+   ::std::vector< char > m_data;
+   /// the position of the next allocation
+   size_t m_head = 0;
+   /// the position of the oldest allocation
+   size_t m_tail = 0;
+   /// the end of the allocations before the last wrap-around. The bytes behind it are unused.
+   size_t m_wrap;
+   /// whether the allocations wrapped around, i.e. whether the head lies in front of the tail
+   bool m_wrapped = false;
+   /// the number of bytes held by live allocations
+   size_t m_used = 0;
+   /// the number of live allocations
+   size_t m_count = 0;
+};
+
+inline ::std::optional< ArenaHandle > ByteArena::allocate(size_t length)
+{
+   if(m_count == 0) {
+      m_head = m_tail = 0;
+      m_wrap = capacity();
+      m_wrapped = false;
+   }
+   if(length == 0) {
+      // an empty allocation at the write position could end up behind the wrap-around point,
+      // which would break the FIFO order of the release
+      m_count++;
+      return ArenaHandle{capacity(), 0};
+   }
+   size_t offset;
+   if(m_wrapped) {
+      // the free space lies between head and tail
+      if(m_tail - m_head < length) {
+         return ::std::nullopt;
+      }
+      offset = m_head;
+   } else if(capacity() - m_head >= length) {
+      offset = m_head;
+   } else if(m_tail >= length) {
+      // wrap around to the front and leave the remaining tail of the arena unused
+      m_wrap = m_head;
+      m_wrapped = true;
+      offset = 0;
+   } else {
+      return ::std::nullopt;
+   }
+   m_head = offset + length;
+   m_used += length;
+   m_count++;
+   return ArenaHandle{offset, length};
+}
+
+inline void ByteArena::release(const ArenaHandle &handle)
+{
+   if(m_count > 0 and handle.length == 0 and handle.offset == capacity()) {
+      m_count--;
+      return;
+   }
+   if(m_count == 0 or handle.offset != m_tail) {
+      throw ::std::logic_error("Arena allocations have to be released oldest first.");
+   }
+   m_tail = handle.offset + handle.length;
+   if(m_wrapped and m_tail == m_wrap) {
+      // all allocations before the wrap-around are released, the next oldest starts at the front
+      m_tail = 0;
+      m_wrap = capacity();
+      m_wrapped = false;
+   }
+   m_used -= handle.length;
+   m_count--;
+}
+
+/**
+ * Prioritized Experience Replay buffer storing variable-size payloads in a `ByteArena`.
+ *
+ * The wrapped `PrioritizedExperience` only holds the (offset, length) handles of the payloads. The
+ * arena allocates in the order of the insertion cursor, hence overwriting the oldest entry also
+ * frees the oldest arena range. If the freed space does not suffice for a new payload, further of
+ * the oldest entries are evicted early: their arena ranges are released and their priorities set
+ * to 0, so that they are never sampled again. Thereby pushing never allocates or frees heap memory
+ * and the memory footprint stays constant over arbitrarily long runs.
+ *
+ * The buffer always uses the FIFO eviction policy.
+ */
+class PER_API ArenaExperience {
+  public:
+   using BufferType = PrioritizedExperience< ArenaHandle >;
+   using ViewVec = ::std::vector< ::std::string_view >;
+   using WeightVec = BufferType::WeightVec;
+   using IndexVec = BufferType::IndexVec;
+   using seed_type = BufferType::seed_type;
+
+   /**
+    * The constructor.
+    *
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param arena_bytes the number of bytes of the payload arena.
+    * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$.
+    * @param beta the 'temperature' parameter for the weights.
+    * @param seed the random seed for sampling.
+    */
+   ArenaExperience(
+      size_t capacity,
+      size_t arena_bytes,
+      double alpha = 1.,
+      double beta = 1.,
+      seed_type seed = ::std::random_device{}());
+
+   /**
+    * Copy a payload into the arena and add it to the buffer.
+    * @param payload the bytes of the sample.
+    * @throw ::std::invalid_argument if the payload is larger than the arena.
+    */
+   void push(::std::string_view payload);
+   /**
+    * Update the given sample indices with new priorities.
+    *
+    * Entries evicted early for lack of arena space keep their priority of 0.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities);
+   /**
+    * Sample @p n samples from the buffer according to the PER method.
+    * @param n the number of samples to draw. At most the number of live entries are drawn.
+    * @return a tuple of 3 vectors holding views of the payloads, weights, and indices
+    * respectively. The views are valid until the next push.
+    */
+   ::std::tuple< ViewVec, WeightVec, IndexVec > sample(size_t n);
+
+   /**
+    * View the payload of an entry.
+    * @param index the index of the entry.
+    * @return a view of the payload, valid until the next push.
+    * @throw ::std::out_of_range if the entry does not exist or its payload has been released.
+    */
+   [[nodiscard]] ::std::string_view payload(size_t index) const
+   {
+      if(not m_live.at(index)) {
+         throw ::std::out_of_range(
+            "Payload of entry '" + ::std::to_string(index) + "' has been released.");
+      }
+      return m_arena.view(m_handles[index]);
+   }
+
+   [[nodiscard]] auto capacity() const { return m_buffer.capacity(); }
+   [[nodiscard]] auto size() const { return m_buffer.size(); }
+   /**
+    * Getter for the number of entries whose payload is still held in the arena.
+    * @return the number of live entries.
+    */
+   [[nodiscard]] size_t n_live() const { return m_arena.count(); }
+   /**
+    * Getter for the payload arena.
+    * @return a const reference to the arena.
+    */
+   [[nodiscard]] const ByteArena &arena() const { return m_arena; }
+
+  private:
+   /// the underlying buffer of payload handles
+   BufferType m_buffer;
+   /// the payload arena
+   ByteArena m_arena;
+   /// the handle of each leaf
+   ::std::vector< ArenaHandle > m_handles;
+   /// whether the payload of each leaf is held in the arena
+   ::std::vector< char > m_live;
+   /// the leaf of the oldest live entry. The live entries form the ring range up to the cursor.
+   size_t m_oldest = 0;
+   /// the preallocated arguments for zeroing the priority of an evicted entry
+   IndexVec m_evict_index{0};
+   ::std::vector< double > m_evict_priority{0.};
+
+   void _release_oldest(size_t writing_slot);
+};
+
+inline ArenaExperience::ArenaExperience(
+   size_t capacity,
+   size_t arena_bytes,
+   double alpha,
+   double beta,
+   seed_type seed)
+    : m_buffer(capacity, alpha, beta, seed, EvictionPolicy::fifo),
+      m_arena(arena_bytes),
+      m_handles(capacity),
+      m_live(capacity, 0)
+{
+}
+
+inline void ArenaExperience::_release_oldest(size_t writing_slot)
+{
+   size_t slot = m_oldest;
+   m_arena.release(m_handles[slot]);
+   m_live[slot] = 0;
+   if(slot != writing_slot) {
+      // evicted early, the leaf keeps its place in the buffer until the cursor overwrites it
+      m_evict_index[0] = slot;
+      m_buffer.update(m_evict_index, m_evict_priority);
+   }
+   m_oldest = m_arena.count() == 0 ? writing_slot : (slot + 1) % capacity();
+}
+
+inline void ArenaExperience::push(::std::string_view payload)
+{
+   if(payload.size() > m_arena.capacity()) {
+      throw ::std::invalid_argument(
+         "Payload of " + ::std::to_string(payload.size()) + " bytes exceeds the arena of "
+         + ::std::to_string(m_arena.capacity()) + " bytes.");
+   }
+   size_t slot = m_buffer.cursor();
+   if(m_live[slot]) {
+      // the overwritten entry is the oldest one
+      _release_oldest(slot);
+   }
+   if(m_arena.count() == 0) {
+      m_oldest = slot;
+   }
+   auto handle = m_arena.allocate(payload.size());
+   while(not handle.has_value()) {
+      _release_oldest(slot);
+      handle = m_arena.allocate(payload.size());
+   }
+   ::std::memcpy(m_arena.data(*handle), payload.data(), payload.size());
+   m_handles[slot] = *handle;
+   m_live[slot] = 1;
+   m_buffer.push(*handle);
+}
+
+inline void ArenaExperience::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   if(indices.size() != priorities.size()) {
+      throw ::std::invalid_argument("Index sequence and priority sequence do not match in length.");
+   }
+   IndexVec live_indices;
+   ::std::vector< double > live_priorities;
+   for(size_t i = 0; i < indices.size(); i++) {
+      if(indices[i] < m_live.size() and not m_live[indices[i]]) {
+         continue;
+      }
+      live_indices.emplace_back(indices[i]);
+      live_priorities.emplace_back(priorities[i]);
+   }
+   m_buffer.update(live_indices, live_priorities);
+}
+
+inline auto ArenaExperience::sample(size_t n) -> ::std::tuple< ViewVec, WeightVec, IndexVec >
+{
+   ViewVec payloads;
+   WeightVec weights;
+   IndexVec indices;
+   // the early evicted entries have no priority mass left, hence only live entries can be drawn
+   n = ::std::min(n, n_live());
+   payloads.reserve(n);
+   weights.reserve(n);
+   indices.reserve(n);
+   m_buffer.sample_each(n, [&](size_t index, const ArenaHandle &handle, double weight) {
+      payloads.emplace_back(m_arena.view(handle));
+      weights.emplace_back(weight);
+      indices.emplace_back(index);
+   });
+   return {::std::move(payloads), ::std::move(weights), ::std::move(indices)};
+}
+
+}  // namespace per
+
+#endif  // PER_BYTE_ARENA_HPP
@@ -0,0 +1,421 @@
+#ifndef PER_COMPRESSION_HPP
+#define PER_COMPRESSION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "per/experience_replay.hpp"
+#include "per/macro.hpp"
+#include "per/thread_pool.hpp"
+
+namespace per {
+
+/**
+ * Lossless codec for vectors of arithmetic values using delta encoding followed by run-length
+ * encoding.
+ *
+ * Each element is interpreted as an unsigned integer of the same width and replaced by its
+ * (wrapping) difference to the previous element. The bytes of these deltas are then laid out
+ * plane by plane (all lowest bytes first, then all second bytes, ...) and compressed with a
+ * PackBits style run-length encoding. Slowly varying payloads such as image observations thereby
+ * collapse into long runs of zero bytes.
+ *
+ * Every codec used with `CompressedExperience` has to provide the same static interface:
+ * `value_type`, `encoded_type`, `encode`, `decode` and `raw_size`.
+ *
+ * @tparam T the arithmetic element type of the vectors to compress.
+ */
+template < typename T >
+struct DeltaRLECodec {
+   static_assert(
+      ::std::is_arithmetic_v< T > and not ::std::is_same_v< T, bool >,
+      "The DeltaRLECodec can only compress vectors of arithmetic (non-bool) types.");
+
+   using value_type = ::std::vector< T >;
+   using encoded_type = ::std::vector< ::std::uint8_t >;
+
+   /**
+    * Compress a value.
+    * @param value the vector to compress.
+    * @return the encoded byte sequence.
+    */
+   static encoded_type encode(const value_type &value);
+   /**
+    * Decompress a previously encoded value.
+    * @param encoded the encoded byte sequence.
+    * @return the original vector.
+    * @throw ::std::invalid_argument if the byte sequence is not a valid encoding.
+    */
+   static value_type decode(const encoded_type &encoded);
+   /**
+    * The number of bytes the uncompressed value occupies.
+    * @param value the vector in question.
+    * @return the byte size of the vector's elements.
+    */
+   static size_t raw_size(const value_type &value) { return value.size() * sizeof(T); }
+
+  private:
+   /// the unsigned integer type of the same width as T in which the deltas are computed
+   using bits_type = ::std::conditional_t<
+      sizeof(T) == 1,
+      ::std::uint8_t,
+      ::std::conditional_t<
+         sizeof(T) == 2,
+         ::std::uint16_t,
+         ::std::conditional_t< sizeof(T) == 4, ::std::uint32_t, ::std::uint64_t > > >;
+   static_assert(sizeof(bits_type) == sizeof(T), "No unsigned integer type of matching width.");
+
+   /// the maximum run length a single PackBits control byte can describe
+   static constexpr size_t max_run = 128;
+
+   static void _pack_bits(const ::std::uint8_t *data, size_t size, encoded_type &out);
+   static void _unpack_bits(
+      const ::std::uint8_t *data,
+      size_t size,
+      ::std::vector< ::std::uint8_t > &out);
+};
+
+/**
+ * Accumulated statistics of a `CompressedExperience` buffer.
+ */
+struct CompressionStats {
+   /// the total number of uncompressed bytes pushed into the buffer
+   size_t raw_bytes = 0;
+   /// the total number of bytes these entries were compressed to
+   size_t encoded_bytes = 0;
+   /// the wall time spent encoding entries during `push` (in seconds)
+   double encode_seconds = 0.;
+   /// the wall time `sample` spent waiting for decodes after the tree descent (in seconds)
+   double decode_wait_seconds = 0.;
+
+   /**
+    * The compression ratio over all entries pushed so far.
+    * @return the ratio of raw to encoded bytes (1 if nothing was pushed yet).
+    */
+   [[nodiscard]] double ratio() const
+   {
+      return encoded_bytes == 0
+                ? 1.
+                : static_cast< double >(raw_bytes) / static_cast< double >(encoded_bytes);
+   }
+};
+
+/**
+ * Prioritized Experience Replay buffer holding its entries in compressed form.
+ *
+ * The buffer wraps a `PrioritizedExperience` of encoded entries. Values are compressed on `push`
+ * and decompressed on `sample`. Decompression jobs are handed to a small thread pool as soon as the
+ * tree descent has found the respective entry, so that decoding overlaps with the descent of the
+ * remaining draws. Sampling results (indices, weights, decoded values) are identical to those of
+ * an uncompressed buffer with the same seed.
+ *
+ * @tparam Codec the codec type providing the static interface described in `DeltaRLECodec`.
+ */
+template < typename Codec >
+class PER_API CompressedExperience {
+  public:
+   using codec_type = Codec;
+   using value_type = typename Codec::value_type;
+   using encoded_type = typename Codec::encoded_type;
+   using BufferType = PrioritizedExperience< encoded_type >;
+   using ValueVec = ::std::vector< value_type >;
+   using WeightVec = typename BufferType::WeightVec;
+   using IndexVec = typename BufferType::IndexVec;
+
+   /**
+    * The constructor of a compressed PER buffer.
+    *
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$.
+    * @param beta the 'temperature' parameter for the weights.
+    * @param seed the random seed for sampling.
+    * @param n_threads the number of decoding threads. With 0 threads all entries are decoded
+    * sequentially on the sampling thread.
+    */
+   CompressedExperience(
+      size_t capacity,
+      double alpha = 1.,
+      double beta = 1.,
+      typename BufferType::seed_type seed = ::std::random_device{}(),
+      size_t n_threads = 2);
+
+   /**
+    * Compress and add a sample to the buffer.
+    * @param value the sample to add.
+    */
+   void push(const value_type &value);
+   /**
+    * Compress and add a collection of samples to the buffer.
+    *
+    * The samples are encoded concurrently on the decoding threads (if any).
+    * @param values the vector of samples to add.
+    */
+   void push(const ValueVec &values);
+   /**
+    * Update the given sample indices with new priorities.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities)
+   {
+      m_buffer.update(indices, priorities);
+   }
+   /**
+    * Sample @p n samples from the buffer according to the PER method and decompress them.
+    * @param n the number of samples to draw.
+    * @return a tuple of 3 vectors holding the values, weights, and indices respectively.
+    */
+   ::std::tuple< ValueVec, WeightVec, IndexVec > sample(size_t n);
+
+   // parameter accessors forwarded to the underlying buffer
+   void beta(double beta) { m_buffer.beta(beta); }
+   void alpha(double alpha) { m_buffer.alpha(alpha); }
+   [[nodiscard]] double alpha() const { return m_buffer.alpha(); }
+   [[nodiscard]] double beta() const { return m_buffer.beta(); }
+   [[nodiscard]] auto capacity() const { return m_buffer.capacity(); }
+   [[nodiscard]] auto size() const { return m_buffer.size(); }
+   /**
+    * Getter for the accumulated compression statistics.
+    * @return the statistics.
+    */
+   [[nodiscard]] const CompressionStats &stats() const { return m_stats; }
+
+  private:
+   using clock = ::std::chrono::steady_clock;
+
+   /// the underlying buffer of encoded entries
+   BufferType m_buffer;
+   /// the pool of decoding threads (empty if decoding happens on the sampling thread)
+   ::std::unique_ptr< ThreadPool > m_pool;
+   /// the accumulated compression statistics
+   CompressionStats m_stats;
+
+   static double _seconds_since(clock::time_point start)
+   {
+      return ::std::chrono::duration< double >(clock::now() - start).count();
+   }
+};
+
+// IMPLEMENTATION
+
+template < typename T >
+auto DeltaRLECodec< T >::encode(const value_type &value) -> encoded_type
+{
+   auto count = static_cast< ::std::uint64_t >(value.size());
+   encoded_type out(sizeof(count));
+   ::std::memcpy(out.data(), &count, sizeof(count));
+
+   // compute the deltas and scatter their bytes into byte planes
+   ::std::vector< ::std::uint8_t > planes(raw_size(value));
+   bits_type previous = 0;
+   for(size_t i = 0; i < value.size(); i++) {
+      bits_type current;
+      ::std::memcpy(&current, &value[i], sizeof(T));
+      auto delta = static_cast< bits_type >(current - previous);
+      ::std::uint8_t delta_bytes[sizeof(T)];
+      ::std::memcpy(delta_bytes, &delta, sizeof(T));
+      for(size_t k = 0; k < sizeof(T); k++) {
+         planes[k * value.size() + i] = delta_bytes[k];
+      }
+      previous = current;
+   }
+   _pack_bits(planes.data(), planes.size(), out);
+   return out;
+}
+
+template < typename T >
+auto DeltaRLECodec< T >::decode(const encoded_type &encoded) -> value_type
+{
+   ::std::uint64_t count = 0;
+   if(encoded.size() < sizeof(count)) {
+      throw ::std::invalid_argument("Encoded sequence is too short to hold the element count.");
+   }
+   ::std::memcpy(&count, encoded.data(), sizeof(count));
+   // the count is untrusted. Every two encoded bytes decode to at most `max_run` bytes, which
+   // bounds the count before anything is reserved for it.
+   size_t encoded_size = encoded.size() - sizeof(count);
+   if(count > encoded_size / 2 * max_run / sizeof(T)) {
+      throw ::std::invalid_argument("Encoded sequence does not match its element count.");
+   }
+
+   ::std::vector< ::std::uint8_t > planes;
+   planes.reserve(count * sizeof(T));
+   _unpack_bits(encoded.data() + sizeof(count), encoded_size, planes);
+   if(planes.size() != count * sizeof(T)) {
+      throw ::std::invalid_argument("Encoded sequence does not match its element count.");
+   }
+
+   value_type value(count);
+   bits_type previous = 0;
+   for(size_t i = 0; i < count; i++) {
+      ::std::uint8_t delta_bytes[sizeof(T)];
+      for(size_t k = 0; k < sizeof(T); k++) {
+         delta_bytes[k] = planes[k * count + i];
+      }
+      bits_type delta;
+      ::std::memcpy(&delta, delta_bytes, sizeof(T));
+      previous = static_cast< bits_type >(previous + delta);
+      ::std::memcpy(&value[i], &previous, sizeof(T));
+   }
+   return value;
+}
+
+template < typename T >
+void DeltaRLECodec< T >::_pack_bits(const ::std::uint8_t *data, size_t size, encoded_type &out)
+{
+   // control bytes c < 128 announce a literal sequence of c + 1 bytes, control bytes c > 128 a
+   // run of 257 - c repetitions of the following byte.
+   size_t i = 0;
+   while(i < size) {
+      size_t run = 1;
+      while(i + run < size and run < max_run and data[i + run] == data[i]) {
+         run++;
+      }
+      if(run >= 2) {
+         out.emplace_back(static_cast< ::std::uint8_t >(257 - run));
+         out.emplace_back(data[i]);
+         i += run;
+         continue;
+      }
+      // collect literals until the next repetition starts
+      size_t start = i;
+      while(i < size and i - start < max_run) {
+         if(i + 1 < size and data[i + 1] == data[i]) {
+            break;
+         }
+         i++;
+      }
+      out.emplace_back(static_cast< ::std::uint8_t >(i - start - 1));
+      out.insert(out.end(), data + start, data + i);
+   }
+}
+
+template < typename T >
+void DeltaRLECodec< T >::_unpack_bits(
+   const ::std::uint8_t *data,
+   size_t size,
+   ::std::vector< ::std::uint8_t > &out)
+{
+   size_t i = 0;
+   while(i < size) {
+      size_t control = data[i++];
+      if(control < 128) {
+         size_t length = control + 1;
+         if(i + length > size) {
+            throw ::std::invalid_argument("Literal sequence exceeds the encoded data.");
+         }
+         out.insert(out.end(), data + i, data + i + length);
+         i += length;
+      } else if(control > 128) {
+         if(i >= size) {
+            throw ::std::invalid_argument("Run is missing its repeated byte.");
+         }
+         out.insert(out.end(), 257 - control, data[i++]);
+      } else {
+         throw ::std::invalid_argument("Invalid control byte 128 in encoded data.");
+      }
+   }
+}
+
+template < typename Codec >
+CompressedExperience< Codec >::CompressedExperience(
+   size_t capacity,
+   double alpha,
+   double beta,
+   typename BufferType::seed_type seed,
+   size_t n_threads)
+    : m_buffer(capacity, alpha, beta, seed),
+      m_pool(n_threads > 0 ? ::std::make_unique< ThreadPool >(n_threads) : nullptr)
+{
+}
+
+template < typename Codec >
+void CompressedExperience< Codec >::push(const value_type &value)
+{
+   auto start = clock::now();
+   auto encoded = Codec::encode(value);
+   m_stats.encode_seconds += _seconds_since(start);
+   m_stats.raw_bytes += Codec::raw_size(value);
+   m_stats.encoded_bytes += encoded.size();
+   m_buffer.push(::std::move(encoded));
+}
+
+template < typename Codec >
+void CompressedExperience< Codec >::push(const ValueVec &values)
+{
+   if(not m_pool) {
+      for(const auto &value : values) {
+         push(value);
+      }
+      return;
+   }
+   auto start = clock::now();
+   ::std::vector< ::std::future< encoded_type > > encodings;
+   encodings.reserve(values.size());
+   for(const auto &value : values) {
+      encodings.emplace_back(m_pool->submit([&value] { return Codec::encode(value); }));
+   }
+   ::std::vector< encoded_type > encoded_values;
+   encoded_values.reserve(values.size());
+   for(size_t i = 0; i < values.size(); i++) {
+      auto &encoded = encoded_values.emplace_back(encodings[i].get());
+      m_stats.raw_bytes += Codec::raw_size(values[i]);
+      m_stats.encoded_bytes += encoded.size();
+   }
+   m_buffer.push(::std::move(encoded_values));
+   m_stats.encode_seconds += _seconds_since(start);
+}
+
+template < typename Codec >
+auto CompressedExperience< Codec >::sample(size_t n)
+   -> ::std::tuple< ValueVec, WeightVec, IndexVec >
+{
+   // the values are written in place by the decoding threads, hence the vector must never
+   // reallocate while decodes are in flight.
+   ValueVec values(::std::min(n, m_buffer.size()));
+   WeightVec weights;
+   IndexVec indices;
+   weights.reserve(values.size());
+   indices.reserve(values.size());
+   ::std::vector< ::std::future< void > > decodes;
+   decodes.reserve(values.size());
+
+   // the encoded entries are only read by the decoding threads. The masking of the sampling
+   // procedure merely alters priorities, so the referenced entries stay valid until all decodes
+   // are collected below.
+   m_buffer.sample_each(n, [&](size_t index, const encoded_type &encoded, double weight) {
+      auto slot = indices.size();
+      indices.emplace_back(index);
+      weights.emplace_back(weight);
+      if(m_pool) {
+         decodes.emplace_back(m_pool->submit(
+            [&values, slot, &encoded] { values[slot] = Codec::decode(encoded); }));
+      } else {
+         values[slot] = Codec::decode(encoded);
+      }
+   });
+
+   auto start = clock::now();
+   // wait for all decodes before collecting potential exceptions, so that no thread can write into
+   // the values anymore once we leave this scope.
+   for(auto &decode : decodes) {
+      decode.wait();
+   }
+   for(auto &decode : decodes) {
+      decode.get();
+   }
+   m_stats.decode_wait_seconds += _seconds_since(start);
+
+   return {::std::move(values), ::std::move(weights), ::std::move(indices)};
+}
+
+}  // namespace per
+
+#endif  // PER_COMPRESSION_HPP
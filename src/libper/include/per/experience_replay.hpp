@@ -2,14 +2,39 @@
 #ifndef PER_EXPERIENCE_REPLAY_HPP
 #define PER_EXPERIENCE_REPLAY_HPP
 
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <random>
 #include <vector>
 
+#include "per/alias_table.hpp"
 #include "per/macro.hpp"
+#include "per/philox.hpp"
+#include "per/simd_math.hpp"
 #include "per/sum_tree.hpp"
 
 namespace per {
 
+/**
+ * Handle of a drawn sample, identifying the sample by its leaf index and the leaf's generation.
+ *
+ * Once the buffer overwrites the leaf with a new sample, the generation changes and the handle
+ * becomes stale. Priority updates through stale handles are dropped.
+ */
+struct SampleHandle {
+   /// the leaf index of the sample
+   size_t index;
+   /// the generation of the leaf at the time of drawing
+   ::std::uint64_t generation;
+
+   bool operator==(const SampleHandle &other) const
+   {
+      return index == other.index and generation == other.generation;
+   }
+   bool operator!=(const SampleHandle &other) const { return not(*this == other); }
+};
+
 /**
  * Prioritized Experience Algorithm Buffer as defined in \cite{per}.
  *
@@ -43,6 +68,32 @@ class PER_API PrioritizedExperience {
    using ValueVec = ::std::vector< value_type >;
    using WeightVec = ::std::vector< double >;
    using IndexVec = ::std::vector< size_t >;
+   using HandleVec = ::std::vector< SampleHandle >;
+   using seed_type = CounterRng::seed_type;
+
+   /**
+    * The complete content of a buffer, e.g. to persist it. See `state` and `restore`.
+    */
+   struct State {
+      /// the values in leaf order
+      ValueVec values;
+      /// the weight of each value
+      WeightVec weights;
+      /// the exponentiated priority \f$ \text{prio}_i^\alpha \f$ of each value
+      ::std::vector< double > priorities;
+      /// the leaf the next sample is written to
+      size_t cursor = 0;
+      double alpha = 1.;
+      double beta = 1.;
+      double max_priority = 1.;
+      /// the priority of newly pushed samples
+      double fresh_priority = 1.;
+      double max_weight = 1.;
+      CounterRng rng{0};
+   };
+
+   /// the minimal batch size for which `sample_each` may resolve the draws in a single sweep
+   static constexpr size_t sweep_min_batch = 128;
 
    /**
     * The constructor of a PER buffer.
@@ -51,12 +102,14 @@ class PER_API PrioritizedExperience {
     * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$.
     * @param beta the 'temperature' paramter for the weights.
     * @param seed the random seed for sampling.
+    * @param policy the strategy to choose the sample to overwrite once the capacity is exhausted.
     */
    PrioritizedExperience(
       size_t capacity,
       double alpha = 1.,
       double beta = 1.,
-      ::std::mt19937_64::result_type seed = ::std::random_device{}());
+      seed_type seed = ::std::random_device{}(),
+      EvictionPolicy policy = EvictionPolicy::fifo);
 
    /**
     * Add a sample to the buffer.
@@ -65,9 +118,15 @@ class PER_API PrioritizedExperience {
    void push(value_type value);
    /**
     * Add a collection of samples to the buffer.
+    *
+    * The samples are moved into the tree as one contiguous range, which costs a single update of
+    * the affected tree nodes instead of one leaf-to-root walk per sample. The result is identical
+    * to pushing the samples one by one, except that the maximum priority and weight are refreshed
+    * once per collection instead of once per evicted sample. Eviction policies other than FIFO
+    * push the samples one by one.
     * @param values the vector of samples to add.
     */
-   void push(const ::std::vector< value_type > &values);
+   void push(::std::vector< value_type > values);
    /**
     * Update the given sample indices with new priorties.
     *
@@ -79,6 +138,48 @@ class PER_API PrioritizedExperience {
     * The entries of @p indices and @p priorities are paired.
     */
    void update(const ::std::vector< size_t > &indices, const ::std::vector< double > &priorities);
+   /**
+    * Update the samples referred to by the given handles with new priorities.
+    *
+    * Handles whose sample has been overwritten in the meantime are skipped. This makes it safe to
+    * update priorities of samples drawn several pushes ago, e.g. by a pipelined learner.
+    * @param handles the vector of handles to address.
+    * @param priorities the vector of priorities to emplace.
+    * The entries of @p handles and @p priorities are paired.
+    * @return the number of applied updates, i.e. the number of handles that were not stale.
+    */
+   size_t update_handles(const HandleVec &handles, const ::std::vector< double > &priorities);
+   /**
+    * Multiply the priorities of all samples by @p factor in O(1).
+    *
+    * The sampling probabilities are unaffected, but samples pushed afterwards (or updated with
+    * fresh priorities) gain importance relative to the decayed ones. New samples keep entering with
+    * the undecayed maximum priority. A time decay of rate
+    * \f$ \lambda \f$ over a period \f$ \Delta t \f$ corresponds to the factor
+    * \f$ e^{-\lambda \Delta t} \f$.
+    * @param factor the positive and finite factor to apply to the (not exponentiated) priorities.
+    */
+   void decay_priorities(double factor);
+
+   /**
+    * Change the capacity of the buffer without re-pushing the held samples.
+    *
+    * See `SumTree::resize`. Shrinking below the size evicts the oldest samples. The priorities and
+    * the insertion order of the remaining samples are preserved, their stored weights are not
+    * recomputed for the new capacity.
+    * @param capacity the new capacity.
+    */
+   void resize(size_t capacity);
+   /**
+    * Grow the capacity of the buffer to at least @p capacity. Never evicts samples.
+    * @param capacity the minimal capacity.
+    */
+   void reserve(size_t capacity)
+   {
+      if(capacity > m_capacity) {
+         resize(capacity);
+      }
+   }
 
    /**
     * Sample @p n samples from the buffer according to the PER method.
@@ -88,7 +189,75 @@ class PER_API PrioritizedExperience {
     * respective value, weight, and index is found in v[i], w[i], ind[i].
     */
    ::std::tuple< ValueVec, WeightVec, IndexVec > sample(size_t n);
+   /**
+    * Sample @p n samples from the buffer according to the PER method.
+    *
+    * Behaves as `sample`, but returns generation-tagged handles instead of plain indices.
+    * @param n the number of samples to draw.
+    * @return a tuple of 3 vectors holding the values, weights, and handles respectively.
+    */
+   ::std::tuple< ValueVec, WeightVec, HandleVec > sample_handles(size_t n);
+   /**
+    * Sample @p n samples from the buffer and hand each drawn entry to @p visitor.
+    *
+    * The draws follow the same logic (and random stream) as `sample`, but the drawn values are
+    * passed by const reference in draw order instead of being copied into return vectors. The
+    * references remain valid until the buffer is modified next.
+    *
+    * If enabled through `sweep_threshold`, batches of at least `sweep_min_batch` draws which make up
+    * at least `sweep_threshold()` of the size are drawn stratified instead: draw i falls into the i-th of n strata of equal priority
+    * mass, so that the targets are generated in ascending order and resolved in a single traversal
+    * of the tree (see `SumTree::find_sorted`). Samples hit by several strata are kept once and the
+    * surplus draws are repeated without replacement by regular descents. The stratified draws
+    * follow a different distribution and order than the sequential ones, hence the sweep is
+    * disabled by default.
+    * @param n the number of samples to draw.
+    * @param visitor a callable of signature (size_t index, const value_type &value, double weight).
+    * @return the number of drawn samples, i.e. the minimum of @p n and the current buffer size.
+    */
+   template < typename Visitor >
+   size_t sample_each(size_t n, Visitor &&visitor);
+
+   /**
+    * Freeze the current priorities into an alias table snapshot for O(1) draws.
+    *
+    * The snapshot is built in O(n) and remains valid until the priorities change, i.e. until the
+    * next push, update or change of \f$ \alpha \f$. Sampling through `sample` leaves it intact.
+    * @param n_threads the number of threads to build the snapshot with. Values below 2 build it
+    * on the calling thread. The threads are kept for later builds with the same number.
+    */
+   void build_snapshot(size_t n_threads = 0);
+   /**
+    * Discard the alias table snapshot.
+    */
+   void invalidate_snapshot() { m_snapshot_valid = false; }
+   /**
+    * Check whether a valid alias table snapshot exists.
+    * @return true if the snapshot reflects the current priorities.
+    */
+   [[nodiscard]] bool has_snapshot() const { return m_snapshot_valid; }
+   /**
+    * Sample @p n samples from the alias table snapshot of the priorities.
+    *
+    * Each draw costs O(1) instead of the O(log n) descent of `sample`. The draws follow the same
+    * distribution as those of `sample`, but are drawn with replacement. A missing or outdated
+    * snapshot is rebuilt first.
+    * @param n the number of samples to draw.
+    * @return a tuple of 3 vectors holding the values, weights, and indices respectively.
+    */
+   ::std::tuple< ValueVec, WeightVec, IndexVec > sample_snapshot(size_t n);
 
+   /**
+    * Setter for the fraction of the size above which batches are drawn stratified in a single sweep
+    * (see `sample_each`). The sweep is disabled by default.
+    * @param threshold the fraction. Values above 1 disable the sweep.
+    */
+   void sweep_threshold(double threshold) { m_sweep_threshold = threshold; }
+   /**
+    * Getter for the fraction of the size above which batches are drawn in a single sweep.
+    * @return the fraction.
+    */
+   [[nodiscard]] double sweep_threshold() const { return m_sweep_threshold; }
    /**
     * Setter for \f$ \beta \f$.
     * @param beta the new value.
@@ -114,6 +283,47 @@ class PER_API PrioritizedExperience {
     * @return the capacity.
     */
    [[nodiscard]] auto capacity() const { return m_capacity; }
+   /**
+    * Getter for the number of currently held samples.
+    * @return the size.
+    */
+   [[nodiscard]] auto size() const { return m_sumtree.size(); }
+   /**
+    * Getter for the index the next pushed sample is written to under the FIFO policy.
+    * @return the position of the insertion cursor.
+    */
+   [[nodiscard]] size_t cursor() const { return m_sumtree.cursor(); }
+   /**
+    * Getter for the total priority mass \f$ \sum_k \text{prio}_k^\alpha \f$ of the held samples.
+    * @return the total priority.
+    */
+   [[nodiscard]] double total() const { return m_sumtree.total(); }
+   /**
+    * Getter for the state of the random number generator.
+    * @return the generator, i.e. its (seed, counter) state.
+    */
+   [[nodiscard]] const CounterRng &rng() const { return m_rng; }
+   /**
+    * Setter for the state of the random number generator (e.g. to restore a serialized state).
+    * @param rng the generator to continue sampling with.
+    */
+   void rng(CounterRng rng) { m_rng = rng; }
+
+   /**
+    * Copy the complete content of the buffer.
+    * @return the state, from which `restore` recreates the buffer.
+    */
+   [[nodiscard]] State state() const;
+   /**
+    * Replace the content of the buffer by a previously taken state.
+    *
+    * The tree is rebuilt in a single O(n) pass (see `SumTree::assign`) instead of pushing the
+    * values one by one, hence the samples keep their leaves and the priorities are not
+    * exponentiated again. The capacity of the buffer is kept.
+    * @param state the state to restore.
+    * @throw ::std::invalid_argument if the state does not fit the capacity.
+    */
+   void restore(State state);
 
   private:
    /// the buffer maximum number of samples to hold
@@ -122,18 +332,55 @@ class PER_API PrioritizedExperience {
    double m_alpha;
    /// the temperature parameter for the weights
    double m_beta = 1.;
-   /// the random number generator for sampling
-   ::std::mt19937_64 m_rng;
-   /// the current max priority stored
+   /// the counter-based random number generator for sampling. The uniform of each draw only
+   /// depends on (seed, batch counter, draw slot) and not on the order of computation.
+   CounterRng m_rng;
+   /// the current max priority stored, in the units of the tree (i.e. before its scale factor)
    double m_max_priority = 1.;
+   /// the priority of newly pushed samples. It equals the maximum priority, but is not decayed by
+   /// `decay_priorities`.
+   double m_fresh_priority = 1.;
    /// the current max weight stored
    double m_max_weight = 1.;
    /// the sum tree structure holing the samples with associated priority and updating them
    /// accordingly. This is computationally faster than a simple array of (samples, priorites).
    SumTreeType m_sumtree;
+   /// the alias table snapshot of the priorities
+   AliasTable m_snapshot;
+   /// whether the snapshot reflects the current priorities
+   bool m_snapshot_valid = false;
+   /// the worker threads of the last multi-threaded snapshot build
+   ::std::unique_ptr< ThreadPool > m_snapshot_pool;
+   /// the fraction of the size above which batches are drawn in a single sweep (disabled by default)
+   double m_sweep_threshold = ::std::numeric_limits< double >::infinity();
+   /// the reused buffer of the batch exponentiations
+   ::std::vector< double > m_pow_buffer;
+
+   /**
+    * Draw @p n_samples stratified samples in a single sweep of the tree.
+    * @param n_samples the number of samples to draw, at most the size.
+    * @param visitor the visitor of `sample_each`.
+    */
+   template < typename Visitor >
+   void _sample_sweep(size_t n_samples, Visitor &visitor);
 
    void _recompute_max_priority(::std::optional< double > triggering_prio = ::std::nullopt);
+   /**
+    * Check whether an evicted priority (including the scale factor) was the maximum.
+    * @param priority the evicted priority.
+    * @return true if @p priority equals the maximum up to rounding.
+    */
+   [[nodiscard]] bool _is_max_priority(double priority) const;
+   /**
+    * Raise the stored maximum to the priority of the latest pushed samples.
+    */
+   void _track_fresh_priority();
    void _recompute_max_weight(::std::optional< double > triggering_weight = ::std::nullopt);
+   /**
+    * Recompute the maxima (once) if any of the evicted entries held them.
+    * @param evicted the evicted (entry, priority) tuples.
+    */
+   void _recompute_maxima(const ::std::vector< ::std::tuple< tree_value_type, double > > &evicted);
 };
 
 template < typename ValueType >
@@ -157,22 +404,46 @@ template < typename ValueType >
 void PrioritizedExperience< ValueType >::_recompute_max_priority(
    ::std::optional< double > triggering_prio)
 {
-   if(not triggering_prio.has_value()
-      or ::std::abs(triggering_prio.value() - m_max_priority) >= 1e-16) {
+   if(not triggering_prio.has_value() or not _is_max_priority(triggering_prio.value())) {
       return;
    }
-   m_max_weight = *::std::max_element(m_sumtree.priority_begin(), m_sumtree.priority_end());
+   double max_priority = *::std::max_element(m_sumtree.priority_begin(), m_sumtree.priority_end());
+   // the priority of new samples drops along with the maximum, but remains clear of the decays.
+   // Without any decay both coincide.
+   if(m_max_priority > 0.) {
+      m_fresh_priority *= max_priority / m_max_priority;
+   } else {
+      m_fresh_priority = max_priority * m_sumtree.scale();
+   }
+   m_max_priority = max_priority;
+}
+
+template < typename ValueType >
+bool PrioritizedExperience< ValueType >::_is_max_priority(double priority) const
+{
+   // the evicted priorities are scaled, the maximum is not. Unscaling them may be off by rounding.
+   // Priorities updated above the maximum do not hold it.
+   return ::std::abs(priority / m_sumtree.scale() - m_max_priority) <= 1e-12 * m_max_priority;
+}
+
+template < typename ValueType >
+void PrioritizedExperience< ValueType >::_track_fresh_priority()
+{
+   // samples pushed after a decay are stored above the decayed maximum
+   m_max_priority = ::std::max(m_max_priority, m_fresh_priority / m_sumtree.scale());
 }
 
 template < typename ValueType >
 void PrioritizedExperience< ValueType >::push(PrioritizedExperience::value_type value)
 {
+   m_snapshot_valid = false;
    auto deleted_entry = m_sumtree.insert(
       tree_value_type{
          /*value=*/::std::move(value),
          /*weight=*/::std::pow(
-            m_max_priority / m_sumtree.total() * static_cast< double >(m_capacity), m_beta)},
-      m_max_priority);
+            m_fresh_priority / m_sumtree.total() * static_cast< double >(m_capacity), m_beta)},
+      m_fresh_priority);
+   _track_fresh_priority();
 
    if(deleted_entry.has_value()) {
       auto &deleted_entry_value = deleted_entry.value();
@@ -183,11 +454,120 @@ void PrioritizedExperience< ValueType >::push(PrioritizedExperience::value_type
 
 template < typename ValueType >
 void PrioritizedExperience< ValueType >::push(
-   const ::std::vector< PrioritizedExperience::value_type > &values)
+   ::std::vector< PrioritizedExperience::value_type > values)
 {
-   for(const auto &value : values) {
-      push(value);
+   m_snapshot_valid = false;
+   if(m_sumtree.policy() != EvictionPolicy::fifo) {
+      // the weights below assume the FIFO order of overwrites
+      for(auto &value : values) {
+         push(::std::move(value));
+      }
+      return;
+   }
+   size_t n = values.size();
+   ::std::vector< tree_value_type > entries;
+   entries.reserve(n);
+   // the weight of each sample depends on the total priority before its insertion, which is
+   // tracked here instead of being read off the tree after every single insertion.
+   double total = m_sumtree.total();
+   m_pow_buffer.resize(n);
+   for(size_t i = 0; i < n; i++) {
+      size_t slot = (m_sumtree.cursor() + i) % m_capacity;
+      double evicted_priority = 0.;
+      if(i >= m_capacity) {
+         // the leaf was written by an earlier sample of this collection
+         evicted_priority = m_fresh_priority;
+      } else if(slot < m_sumtree.size()) {
+         evicted_priority = m_sumtree.priority(slot);
+      }
+      m_pow_buffer[i] = m_fresh_priority / total * static_cast< double >(m_capacity);
+      total += m_fresh_priority - evicted_priority;
+   }
+   pow_abs(m_pow_buffer, m_beta);
+   for(size_t i = 0; i < n; i++) {
+      entries.emplace_back(/*value=*/::std::move(values[i]), /*weight=*/m_pow_buffer[i]);
+   }
+
+   auto evicted =
+      m_sumtree.insert(::std::move(entries), ::std::vector< double >(n, m_fresh_priority));
+   _track_fresh_priority();
+   _recompute_maxima(evicted);
+}
+
+template < typename ValueType >
+void PrioritizedExperience< ValueType >::_recompute_maxima(
+   const ::std::vector< ::std::tuple< tree_value_type, double > > &evicted)
+{
+   // the maxima only need to be recomputed (once) if any evicted entry held them
+   auto is_max = [](double value, double max) { return ::std::abs(value - max) < 1e-16; };
+   if(::std::any_of(evicted.begin(), evicted.end(), [&](const auto &entry) {
+         return is_max(::std::get< 0 >(entry).second, m_max_weight);
+      })) {
+      _recompute_max_weight(m_max_weight);
+   }
+   auto max_entry = ::std::max_element(
+      evicted.begin(), evicted.end(), [](const auto &entry1, const auto &entry2) {
+         return ::std::get< 1 >(entry1) < ::std::get< 1 >(entry2);
+      });
+   if(max_entry != evicted.end()) {
+      _recompute_max_priority(::std::get< 1 >(*max_entry));
+   }
+}
+
+template < typename ValueType >
+auto PrioritizedExperience< ValueType >::state() const -> State
+{
+   State state;
+   size_t n = m_sumtree.size();
+   state.values.reserve(n);
+   state.weights.reserve(n);
+   state.priorities.reserve(n);
+   auto priority_it = m_sumtree.priority_begin();
+   for(size_t i = 0; i < n; i++, ++priority_it) {
+      const auto &[value, weight] = m_sumtree.values()[i];
+      state.values.emplace_back(value);
+      state.weights.emplace_back(weight);
+      state.priorities.emplace_back(*priority_it * m_sumtree.scale());
+   }
+   state.cursor = m_sumtree.cursor();
+   state.alpha = m_alpha;
+   state.beta = m_beta;
+   state.max_priority = m_max_priority * m_sumtree.scale();
+   state.fresh_priority = m_fresh_priority;
+   state.max_weight = m_max_weight;
+   state.rng = m_rng;
+   return state;
+}
+
+template < typename ValueType >
+void PrioritizedExperience< ValueType >::restore(State state)
+{
+   if(state.weights.size() != state.values.size()) {
+      throw ::std::invalid_argument("Value sequence and weight sequence do not match in length.");
    }
+   m_snapshot_valid = false;
+   ::std::vector< tree_value_type > entries;
+   entries.reserve(state.values.size());
+   for(size_t i = 0; i < state.values.size(); i++) {
+      entries.emplace_back(::std::move(state.values[i]), state.weights[i]);
+   }
+   m_sumtree.assign(::std::move(entries), state.priorities, state.cursor);
+   m_alpha = state.alpha;
+   m_beta = state.beta;
+   // the restored tree is unscaled
+   m_max_priority = state.max_priority;
+   m_fresh_priority = state.fresh_priority;
+   m_max_weight = state.max_weight;
+   m_rng = state.rng;
+}
+
+template < typename ValueType >
+void PrioritizedExperience< ValueType >::resize(size_t capacity)
+{
+   m_snapshot_valid = false;
+   auto evicted = m_sumtree.resize(capacity);
+   m_capacity = capacity;
+   _recompute_maxima(evicted);
 }
 
 template < typename ValueType >
@@ -195,64 +575,263 @@ void PrioritizedExperience< ValueType >::update(
    const ::std::vector< size_t > &indices,
    const ::std::vector< double > &priorities)
 {
+   if(priorities.size() < indices.size()) {
+      throw ::std::invalid_argument("Priority sequence is shorter than the index sequence.");
+   }
+   m_snapshot_valid = false;
+   m_pow_buffer.resize(indices.size());
+   pow_abs(priorities.data(), m_pow_buffer.data(), indices.size(), m_alpha);
    for(size_t i = 0; i < indices.size(); i++) {
       if(i >= m_capacity) {
          throw ::std::out_of_range(
             "Index '" + ::std::to_string(i) + "' out of bounds for replay capacity "
             + ::std::to_string(m_capacity));
       }
-      m_sumtree.update(indices[i], ::std::pow(::std::abs(priorities[i]), m_alpha));
+      m_sumtree.update(indices[i], m_pow_buffer[i]);
    }
 }
 
 template < typename ValueType >
-::std::tuple<
-   typename PrioritizedExperience< ValueType >::ValueVec,
-   typename PrioritizedExperience< ValueType >::WeightVec,
-   typename PrioritizedExperience< ValueType >::IndexVec >
-PrioritizedExperience< ValueType >::sample(size_t n)
+size_t PrioritizedExperience< ValueType >::update_handles(
+   const HandleVec &handles,
+   const ::std::vector< double > &priorities)
 {
-   ValueVec values;
-   WeightVec weights;
-   IndexVec indices;
+   if(handles.size() != priorities.size()) {
+      throw ::std::invalid_argument(
+         "Handle sequence and priority sequence do not match in length.");
+   }
+   m_snapshot_valid = false;
+   m_pow_buffer.resize(priorities.size());
+   pow_abs(priorities.data(), m_pow_buffer.data(), priorities.size(), m_alpha);
+   size_t n_updated = 0;
+   for(size_t i = 0; i < handles.size(); i++) {
+      const auto &[index, generation] = handles[i];
+      if(index >= m_sumtree.size() or m_sumtree.generation(index) != generation) {
+         continue;
+      }
+      m_sumtree.update(index, m_pow_buffer[i]);
+      n_updated++;
+   }
+   return n_updated;
+}
 
-   // backup container for the priorities of already sampled elements
+template < typename ValueType >
+void PrioritizedExperience< ValueType >::decay_priorities(double factor)
+{
+   // the tree holds priority^alpha, hence the decay factor is exponentiated as well
+   double tree_factor = ::std::pow(factor, m_alpha);
+   double scale = m_sumtree.scale();
+   // the priority of new samples is kept, so that they enter above the decayed ones. The snapshot
+   // is still valid, since the relative priorities did not change.
+   m_sumtree.scale_priorities(tree_factor);
+   // the stored maximum only changes if the tree folded its scale into the stored priorities
+   m_max_priority *= scale * tree_factor / m_sumtree.scale();
+}
+
+template < typename ValueType >
+template < typename Visitor >
+size_t PrioritizedExperience< ValueType >::sample_each(size_t n, Visitor &&visitor)
+{
+   // backup containers for the indices and priorities of already sampled elements
    // (sample without replacement)
+   IndexVec indices;
    ::std::vector< double > priorities;
 
    auto n_samples = ::std::min(n, m_sumtree.size());
-   values.reserve(n_samples);
-   weights.reserve(n_samples);
+   if(n_samples >= sweep_min_batch
+      and static_cast< double >(n_samples)
+             >= m_sweep_threshold * static_cast< double >(m_sumtree.size())) {
+      _sample_sweep(n_samples, visitor);
+      return n_samples;
+   }
    indices.reserve(n_samples);
    priorities.reserve(n_samples);
 
-   ::std::uniform_real_distribution< double > dist(0, 1);
+   // the targets of the individual draws are independent of each other and may be computed in
+   // any order (or concurrently). The descents on the other hand have to happen sequentially due
+   // to the masking of already drawn samples.
+   ::std::vector< double > targets(n_samples);
+   for(size_t i = 0; i < n_samples; i++) {
+      targets[i] = m_rng.uniform(i);
+   }
+   m_rng.advance();
 
    for(size_t i = 0; i < n_samples; i++) {
-      auto r = dist(m_rng);
-      auto [index, value, priority] = m_sumtree.get(r);
-      priorities.emplace_back(priority);
-      weights.emplace_back(value.second);
+      auto index = m_sumtree.find(targets[i]);
+      const auto &[value, weight] = m_sumtree[index];
+      priorities.emplace_back(m_sumtree.priority(index));
       indices.emplace_back(index);
-      values.emplace_back(value.first);
+      visitor(index, value, weight);
       // mask the already sampled elements
       m_sumtree.update(index, 0);
    }
    // restore the priorities
    m_sumtree.update(indices, priorities);
 
+   return n_samples;
+}
+
+template < typename ValueType >
+template < typename Visitor >
+void PrioritizedExperience< ValueType >::_sample_sweep(size_t n_samples, Visitor &visitor)
+{
+   // the stratified targets are ascending by construction
+   ::std::vector< double > targets(n_samples);
+   auto n_strata = static_cast< double >(n_samples);
+   for(size_t i = 0; i < n_samples; i++) {
+      targets[i] = (static_cast< double >(i) + m_rng.uniform(i)) / n_strata;
+   }
+   m_rng.advance();
+   auto leaves = m_sumtree.find_sorted(targets);
+
+   IndexVec indices;
+   indices.reserve(n_samples);
+   size_t n_duplicates = 0;
+   for(size_t i = 0; i < n_samples; i++) {
+      // the leaves are ascending as well, hence repeated hits are adjacent
+      if(i > 0 and leaves[i] == leaves[i - 1]) {
+         n_duplicates++;
+         continue;
+      }
+      const auto &[value, weight] = m_sumtree[leaves[i]];
+      indices.emplace_back(leaves[i]);
+      visitor(leaves[i], value, weight);
+   }
+   if(n_duplicates == 0) {
+      return;
+   }
+   // a sample heavier than a stratum was hit several times. The surplus draws are repeated with
+   // all drawn samples masked.
+   ::std::vector< double > priorities;
+   priorities.reserve(n_samples);
+   for(auto index : indices) {
+      priorities.emplace_back(m_sumtree.priority(index));
+      m_sumtree.update(index, 0);
+   }
+   for(size_t i = 0; i < n_duplicates; i++) {
+      auto index = m_sumtree.find(m_rng.uniform(i));
+      const auto &[value, weight] = m_sumtree[index];
+      priorities.emplace_back(m_sumtree.priority(index));
+      indices.emplace_back(index);
+      visitor(index, value, weight);
+      m_sumtree.update(index, 0);
+   }
+   m_rng.advance();
+   // restore the priorities
+   m_sumtree.update(indices, priorities);
+}
+
+template < typename ValueType >
+::std::tuple<
+   typename PrioritizedExperience< ValueType >::ValueVec,
+   typename PrioritizedExperience< ValueType >::WeightVec,
+   typename PrioritizedExperience< ValueType >::IndexVec >
+PrioritizedExperience< ValueType >::sample(size_t n)
+{
+   ValueVec values;
+   WeightVec weights;
+   IndexVec indices;
+
+   auto n_samples = ::std::min(n, m_sumtree.size());
+   values.reserve(n_samples);
+   weights.reserve(n_samples);
+   indices.reserve(n_samples);
+
+   sample_each(n, [&](size_t index, const value_type &value, double weight) {
+      values.emplace_back(value);
+      weights.emplace_back(weight);
+      indices.emplace_back(index);
+   });
+
+   return {values, weights, indices};
+}
+
+template < typename ValueType >
+::std::tuple<
+   typename PrioritizedExperience< ValueType >::ValueVec,
+   typename PrioritizedExperience< ValueType >::WeightVec,
+   typename PrioritizedExperience< ValueType >::HandleVec >
+PrioritizedExperience< ValueType >::sample_handles(size_t n)
+{
+   ValueVec values;
+   WeightVec weights;
+   HandleVec handles;
+
+   auto n_samples = ::std::min(n, m_sumtree.size());
+   values.reserve(n_samples);
+   weights.reserve(n_samples);
+   handles.reserve(n_samples);
+
+   sample_each(n, [&](size_t index, const value_type &value, double weight) {
+      values.emplace_back(value);
+      weights.emplace_back(weight);
+      handles.push_back({index, m_sumtree.generation(index)});
+   });
+
+   return {values, weights, handles};
+}
+
+template < typename ValueType >
+void PrioritizedExperience< ValueType >::build_snapshot(size_t n_threads)
+{
+   ThreadPool *pool = nullptr;
+   if(n_threads > 1) {
+      // spawning the threads may cost as much as the build itself, hence they are reused
+      if(m_snapshot_pool == nullptr or m_snapshot_pool->size() != n_threads) {
+         m_snapshot_pool = ::std::make_unique< ThreadPool >(n_threads);
+      }
+      pool = m_snapshot_pool.get();
+   }
+   m_snapshot.build(m_sumtree.priority_begin(), m_sumtree.priority_end(), pool);
+   m_snapshot_valid = true;
+}
+
+template < typename ValueType >
+::std::tuple<
+   typename PrioritizedExperience< ValueType >::ValueVec,
+   typename PrioritizedExperience< ValueType >::WeightVec,
+   typename PrioritizedExperience< ValueType >::IndexVec >
+PrioritizedExperience< ValueType >::sample_snapshot(size_t n)
+{
+   ValueVec values;
+   WeightVec weights;
+   IndexVec indices;
+   if(m_sumtree.size() == 0) {
+      return {values, weights, indices};
+   }
+   if(not m_snapshot_valid) {
+      build_snapshot();
+   }
+   values.reserve(n);
+   weights.reserve(n);
+   indices.reserve(n);
+   for(size_t i = 0; i < n; i++) {
+      auto index = m_snapshot.draw(m_rng.uniform(2 * i), m_rng.uniform(2 * i + 1));
+      const auto &[value, weight] = m_sumtree[index];
+      values.emplace_back(value);
+      weights.emplace_back(weight);
+      indices.emplace_back(index);
+   }
+   m_rng.advance();
    return {values, weights, indices};
 }
+
 template < typename ValueType >
 void PrioritizedExperience< ValueType >::alpha(double alpha)
 {
+   m_snapshot_valid = false;
    double old_alpha = m_alpha;
    m_alpha = alpha;
+   m_pow_buffer.resize(m_sumtree.size());
+   for(size_t i = 0; i < m_sumtree.size(); i++) {
+      m_pow_buffer[i] = m_sumtree.priority(i);
+   }
+   // we have always stored priority^alpha. So in order to change the exponent to the new
+   // alpha we need to exponentiate the stored priority by the fraction of new/old alpha:
+   //    (p^(a_1))^(a_2 / a_1) = p^(a_2)
+   pow_abs(m_pow_buffer, alpha / old_alpha);
    for(size_t i = 0; i < m_sumtree.size(); i++) {
-      // we have always stored priority^alpha. So in order to change the exponent to the new
-      // alpha we need to exponentiate the stored priority by the fraction of new/old alpha:
-      //    (p^(a_1))^(a_2 / a_1) = p^(a_2)
-      m_sumtree.update(i, ::std::pow(m_sumtree.priority(i), alpha / old_alpha));
+      m_sumtree.update(i, m_pow_buffer[i]);
    }
 }
 template < typename ValueType >
@@ -260,10 +839,13 @@ void PrioritizedExperience< ValueType >::beta(double beta)
 {
    double old_beta = m_beta;
    m_beta = beta;
+   m_pow_buffer.resize(m_sumtree.size());
    for(size_t i = 0; i < m_sumtree.size(); i++) {
-      auto &[value, weight] = m_sumtree[i];
-      m_sumtree[i] = {
-         value, 1. / (::std::pow(weight * m_max_weight, m_beta / old_beta) * m_max_weight)};
+      m_pow_buffer[i] = m_sumtree[i].second * m_max_weight;
+   }
+   pow_abs(m_pow_buffer, m_beta / old_beta);
+   for(size_t i = 0; i < m_sumtree.size(); i++) {
+      m_sumtree[i].second = 1. / (m_pow_buffer[i] * m_max_weight);
    }
 }
 template < typename ValueType >
@@ -271,11 +853,26 @@ PrioritizedExperience< ValueType >::PrioritizedExperience(
    size_t capacity,
    double alpha,
    double beta,
-   ::std::mt19937_64::result_type seed)
-    : m_capacity(capacity), m_alpha(alpha), m_beta(beta), m_rng(seed), m_sumtree(capacity)
+   seed_type seed,
+   EvictionPolicy policy)
+    : m_capacity(capacity),
+      m_alpha(alpha),
+      m_beta(beta),
+      m_rng(seed),
+      m_sumtree(capacity, policy, seed)
 {
 }
 
+#ifdef PER_COMPILED_LIBRARY
+// instantiated in the compiled per++ library
+extern template class SumTree< ::std::pair< int, double > >;
+extern template class SumTree< ::std::pair< double, double > >;
+extern template class SumTree< ::std::pair< ::std::string, double > >;
+extern template class PrioritizedExperience< int >;
+extern template class PrioritizedExperience< double >;
+extern template class PrioritizedExperience< ::std::string >;
+#endif
+
 }  // namespace per
 
 #endif  // PER_EXPERIENCE_REPLAY_HPP
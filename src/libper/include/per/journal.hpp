@@ -0,0 +1,988 @@
+#ifndef PER_JOURNAL_HPP
+#define PER_JOURNAL_HPP
+
+#include "per/macro.hpp"
+
+#if OS == LINUX || OS == MAC
+
+   #include <fcntl.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+
+   #include <algorithm>
+   #include <cerrno>
+   #include <chrono>
+   #include <condition_variable>
+   #include <cstdint>
+   #include <cstring>
+   #include <exception>
+   #include <memory>
+   #include <mutex>
+   #include <optional>
+   #include <random>
+   #include <string>
+   #include <system_error>
+   #include <thread>
+   #include <tuple>
+   #include <type_traits>
+   #include <vector>
+
+   #include "per/experience_replay.hpp"
+   #include "per/replay_protocol.hpp"
+
+namespace per {
+
+/**
+ * The operation codes of the journal records.
+ */
+enum class JournalOp : ::std::uint8_t {
+   /// [value]
+   push = 1,
+   /// [u64 n][values[n]]
+   push_many = 2,
+   /// [u64 n][u64 indices[n]][f64 priorities[n]]
+   update = 3,
+   /// [f64 alpha]
+   alpha = 4,
+   /// [f64 beta]
+   beta = 5,
+   /// the only record of a base snapshot: [u64 n][u64 cursor][f64 alpha][f64 beta]
+   /// [f64 max priority][f64 max weight][u64 seed][u64 counter][values[n]][f64 weights[n]]
+   /// [f64 priorities[n]]
+   state = 6,
+};
+
+/**
+ * The header at the start of a journal file and of a base snapshot file.
+ *
+ * Journal and snapshot are only read back on the host that wrote them, hence all integers and
+ * floats are stored in native byte order.
+ */
+struct JournalFileHeader {
+   ::std::uint32_t magic;
+   ::std::uint32_t version;
+   /// the number of compactions preceding the file. A journal only continues the snapshot of the
+   /// same epoch.
+   ::std::uint64_t epoch;
+   ::std::uint64_t capacity;
+};
+static_assert(sizeof(JournalFileHeader) == 24, "Unexpected padding in the journal file header.");
+
+/**
+ * The fixed-size header preceding every journal record.
+ */
+struct JournalRecordHeader {
+   JournalOp op;
+   ::std::uint8_t reserved[3];
+   /// the FNV-1a hash of the payload, detecting records torn by a crash
+   ::std::uint32_t checksum;
+   ::std::uint64_t payload_bytes;
+};
+static_assert(sizeof(JournalRecordHeader) == 16, "Unexpected padding in the record header.");
+
+/**
+ * Binary encoding of the journaled values.
+ *
+ * Trivially copyable values are stored as their bytes. Other value types need a specialization.
+ * @tparam T the value type.
+ */
+template < typename T >
+struct JournalCodec {
+   static_assert(
+      ::std::is_trivially_copyable_v< T >,
+      "Journaled values have to be trivially copyable or specialize JournalCodec.");
+
+   static void encode(::std::vector< char > &out, const T &value)
+   {
+      ReplayProtocol::append(out, value);
+   }
+   static T decode(ReplayProtocol::Reader &reader) { return reader.read< T >(); }
+};
+
+/**
+ * Strings are stored as [u64 length][bytes].
+ */
+template <>
+struct JournalCodec< ::std::string > {
+   static void encode(::std::vector< char > &out, const ::std::string &value)
+   {
+      ReplayProtocol::append< ::std::uint64_t >(out, value.size());
+      out.insert(out.end(), value.begin(), value.end());
+   }
+   static ::std::string decode(ReplayProtocol::Reader &reader)
+   {
+      auto length = reader.read< ::std::uint64_t >();
+      return ::std::string(reader.take(length), length);
+   }
+};
+
+/**
+ * Helpers to frame journal records and to access the journal files.
+ */
+struct JournalFiles {
+   /// the value identifying journal files
+   static constexpr ::std::uint32_t magic = 0x5045524a;  // "PERJ"
+   /// the version of the record layouts
+   static constexpr ::std::uint32_t version = 1;
+
+   static ::std::uint32_t checksum(const char *data, size_t size)
+   {
+      ::std::uint32_t hash = 2166136261u;
+      for(size_t i = 0; i < size; i++) {
+         hash = (hash ^ static_cast< unsigned char >(data[i])) * 16777619u;
+      }
+      return hash;
+   }
+
+   /**
+    * Append a record to a byte buffer.
+    * @param out the buffer to append to.
+    * @param op the operation of the record.
+    * @param payload the payload of the record.
+    * @param with_checksum whether to hash the payload now. Otherwise the checksum is left 0 for
+    * `seal` to fill in.
+    */
+   static void append_record(
+      ::std::vector< char > &out,
+      JournalOp op,
+      const ::std::vector< char > &payload,
+      bool with_checksum = true)
+   {
+      JournalRecordHeader header{
+         op,
+         {0, 0, 0},
+         with_checksum ? checksum(payload.data(), payload.size()) : 0u,
+         payload.size()};
+      ReplayProtocol::append(out, header);
+      out.insert(out.end(), payload.begin(), payload.end());
+   }
+
+   /**
+    * Fill in the checksums of all records of a buffer.
+    * @param records the consecutive records.
+    */
+   static void seal(::std::vector< char > &records)
+   {
+      size_t pos = 0;
+      while(pos < records.size()) {
+         JournalRecordHeader header;
+         ::std::memcpy(&header, records.data() + pos, sizeof(header));
+         header.checksum = checksum(
+            records.data() + pos + sizeof(header), header.payload_bytes);
+         ::std::memcpy(records.data() + pos, &header, sizeof(header));
+         pos += sizeof(header) + header.payload_bytes;
+      }
+   }
+
+   /**
+    * Scan the records following the file header.
+    *
+    * Scanning stops at the first incomplete or corrupted record, which is what a crash in the
+    * middle of a write leaves behind.
+    * @param data the bytes of the file.
+    * @param visitor a callable of signature (JournalOp op, ReplayProtocol::Reader &payload).
+    * @return the number of bytes of the file up to the end of the last intact record.
+    */
+   template < typename Visitor >
+   static size_t scan(const ::std::vector< char > &data, Visitor &&visitor)
+   {
+      size_t pos = sizeof(JournalFileHeader);
+      while(data.size() - pos >= sizeof(JournalRecordHeader)) {
+         JournalRecordHeader header;
+         ::std::memcpy(&header, data.data() + pos, sizeof(header));
+         const char *payload = data.data() + pos + sizeof(header);
+         size_t available = data.size() - pos - sizeof(header);
+         if(header.payload_bytes > available
+            or checksum(payload, header.payload_bytes) != header.checksum) {
+            break;
+         }
+         ReplayProtocol::Reader reader(payload, payload + header.payload_bytes);
+         visitor(header.op, reader);
+         pos += sizeof(header) + header.payload_bytes;
+      }
+      return pos;
+   }
+
+   static JournalFileHeader make_header(::std::uint64_t epoch, ::std::uint64_t capacity)
+   {
+      return JournalFileHeader{magic, version, epoch, capacity};
+   }
+
+   /**
+    * Read a journal file.
+    * @param path the path of the file.
+    * @return the bytes of the file, or an empty optional if the file does not exist.
+    * @throw ::std::system_error on failure, ::std::invalid_argument if the file header is invalid.
+    */
+   static ::std::optional< ::std::vector< char > > read(const ::std::string &path)
+   {
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if(fd < 0) {
+         if(errno == ENOENT) {
+            return ::std::nullopt;
+         }
+         throw ::std::system_error(errno, ::std::generic_category(), "open " + path);
+      }
+      ::std::vector< char > data;
+      char chunk[1 << 16];
+      while(true) {
+         auto n_read = ::read(fd, chunk, sizeof(chunk));
+         if(n_read < 0) {
+            if(errno == EINTR) {
+               continue;
+            }
+            int error = errno;
+            ::close(fd);
+            throw ::std::system_error(error, ::std::generic_category(), "read " + path);
+         }
+         if(n_read == 0) {
+            break;
+         }
+         data.insert(data.end(), chunk, chunk + n_read);
+      }
+      ::close(fd);
+      JournalFileHeader header;
+      if(data.size() < sizeof(header)) {
+         throw ::std::invalid_argument("Journal file '" + path + "' is truncated.");
+      }
+      ::std::memcpy(&header, data.data(), sizeof(header));
+      if(header.magic != magic or header.version != version) {
+         throw ::std::invalid_argument("File '" + path + "' is not a journal of this version.");
+      }
+      return data;
+   }
+
+   static JournalFileHeader header_of(const ::std::vector< char > &data)
+   {
+      JournalFileHeader header;
+      ::std::memcpy(&header, data.data(), sizeof(header));
+      return header;
+   }
+
+   /**
+    * Write all bytes to a file descriptor.
+    * @throw ::std::system_error on failure.
+    */
+   static void write_all(int fd, const char *data, size_t size)
+   {
+      while(size > 0) {
+         auto written = ::write(fd, data, size);
+         if(written < 0) {
+            if(errno == EINTR) {
+               continue;
+            }
+            throw ::std::system_error(errno, ::std::generic_category(), "write");
+         }
+         data += written;
+         size -= static_cast< size_t >(written);
+      }
+   }
+
+   /**
+    * Flush the written bytes of a file descriptor to the storage device.
+    * @throw ::std::system_error on failure.
+    */
+   static void sync(int fd)
+   {
+      if(::fsync(fd) != 0) {
+         throw ::std::system_error(errno, ::std::generic_category(), "fsync");
+      }
+   }
+
+   /**
+    * Replace a file by the given bytes such that a crash leaves either the old or the new file.
+    *
+    * The bytes are written to a temporary file, which is synced and renamed over @p path.
+    * @param path the path of the file.
+    * @param data the new content.
+    * @throw ::std::system_error on failure.
+    */
+   static void replace(const ::std::string &path, const ::std::vector< char > &data)
+   {
+      auto tmp_path = path + ".tmp";
+      int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if(fd < 0) {
+         throw ::std::system_error(errno, ::std::generic_category(), "open " + tmp_path);
+      }
+      try {
+         write_all(fd, data.data(), data.size());
+         sync(fd);
+      } catch(...) {
+         ::close(fd);
+         throw;
+      }
+      ::close(fd);
+      if(::rename(tmp_path.c_str(), path.c_str()) != 0) {
+         throw ::std::system_error(errno, ::std::generic_category(), "rename " + tmp_path);
+      }
+      // persist the directory entry of the renamed file
+      auto slash = path.find_last_of('/');
+      auto directory =
+         slash == ::std::string::npos ? ::std::string(".") : path.substr(0, slash + 1);
+      int dir_fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+      if(dir_fd >= 0) {
+         ::fsync(dir_fd);
+         ::close(dir_fd);
+      }
+   }
+
+   /**
+    * Open a file for appending.
+    * @param path the path of the file.
+    * @param size the size to truncate the file to, dropping any torn record behind it.
+    * @return the file descriptor.
+    * @throw ::std::system_error on failure.
+    */
+   static int open_append(const ::std::string &path, size_t size)
+   {
+      int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+      if(fd < 0) {
+         throw ::std::system_error(errno, ::std::generic_category(), "open " + path);
+      }
+      if(::ftruncate(fd, static_cast< off_t >(size)) != 0) {
+         int error = errno;
+         ::close(fd);
+         throw ::std::system_error(error, ::std::generic_category(), "ftruncate " + path);
+      }
+      return fd;
+   }
+};
+
+/**
+ * Background writer of a journal file with group commit.
+ *
+ * Appended records are collected in memory and written by a worker thread with a single write and
+ * sync per commit interval (or once enough bytes are pending), so that appending never waits for
+ * the storage device. A crash loses at most the records of the last commit interval.
+ *
+ * A compaction replaces the base snapshot and starts a new, empty journal of the next epoch. The
+ * records pending at the time of the request are covered by the snapshot and dropped.
+ */
+class PER_API JournalWriter {
+  public:
+   /**
+    * The constructor. Starts the worker thread.
+    * @param path the path of the journal file. The base snapshot lives next to it.
+    * @param fd the descriptor of the journal file opened for appending. Owned by the writer.
+    * @param file_bytes the current size of the journal file.
+    * @param epoch the epoch of the journal file.
+    * @param capacity the capacity recorded in the file headers.
+    * @param commit_interval the maximum time appended records wait for their commit.
+    * @param group_bytes the number of pending bytes which trigger a commit right away.
+    */
+   JournalWriter(
+      ::std::string path,
+      int fd,
+      size_t file_bytes,
+      ::std::uint64_t epoch,
+      size_t capacity,
+      ::std::chrono::microseconds commit_interval,
+      size_t group_bytes = size_t(1) << 20u)
+       : m_path(::std::move(path)),
+         m_fd(fd),
+         m_file_bytes(file_bytes),
+         m_epoch(epoch),
+         m_capacity(capacity),
+         m_commit_interval(commit_interval),
+         m_group_bytes(group_bytes),
+         m_worker([this] { _work(); })
+   {
+   }
+
+   JournalWriter(const JournalWriter &) = delete;
+   JournalWriter &operator=(const JournalWriter &) = delete;
+
+   /**
+    * The destructor. Commits the pending records and stops the worker thread.
+    */
+   ~JournalWriter()
+   {
+      {
+         ::std::lock_guard lock(m_mutex);
+         m_stop = true;
+      }
+      m_wake.notify_all();
+      m_worker.join();
+      ::close(m_fd);
+   }
+
+   /**
+    * Append a record. It is committed by the worker thread.
+    * @param op the operation of the record.
+    * @param payload the payload of the record.
+    * @throw any exception the worker encountered while writing.
+    */
+   void append(JournalOp op, const ::std::vector< char > &payload)
+   {
+      bool commit_now;
+      {
+         ::std::lock_guard lock(m_mutex);
+         _rethrow();
+         // the worker hashes the payloads, keeping the appending thread free of it
+         JournalFiles::append_record(m_pending, op, payload, false);
+         m_file_bytes += sizeof(JournalRecordHeader) + payload.size();
+         m_n_appended++;
+         commit_now = m_pending.size() >= m_group_bytes;
+      }
+      if(commit_now) {
+         m_wake.notify_all();
+      }
+   }
+
+   /**
+    * Replace the base snapshot and continue with an empty journal of the next epoch.
+    * @param state the payload of the state record of the new snapshot.
+    * @throw any exception the worker encountered while writing.
+    */
+   void compact(const ::std::vector< char > &state)
+   {
+      {
+         ::std::lock_guard lock(m_mutex);
+         _rethrow();
+         m_epoch++;
+         auto header = JournalFiles::make_header(m_epoch, m_capacity);
+         m_base.clear();
+         ReplayProtocol::append(m_base, header);
+         JournalFiles::append_record(m_base, JournalOp::state, state);
+         // the snapshot covers all records appended so far
+         m_pending.clear();
+         m_file_bytes = sizeof(JournalFileHeader);
+         m_n_appended++;
+      }
+      m_wake.notify_all();
+   }
+
+   /**
+    * Block until all records appended so far are committed.
+    * @throw any exception the worker encountered while writing.
+    */
+   void flush()
+   {
+      ::std::unique_lock lock(m_mutex);
+      auto target = m_n_appended;
+      m_n_flush_target = ::std::max(m_n_flush_target, target);
+      m_wake.notify_all();
+      m_committed.wait(lock, [&] { return m_n_committed >= target or m_error != nullptr; });
+      _rethrow();
+   }
+
+   /**
+    * Getter for the size of the journal file including the records pending for commit.
+    * @return the number of bytes.
+    */
+   [[nodiscard]] size_t file_bytes() const
+   {
+      ::std::lock_guard lock(m_mutex);
+      return m_file_bytes;
+   }
+   /**
+    * Getter for the epoch of the journal, i.e. the number of compactions.
+    * @return the epoch.
+    */
+   [[nodiscard]] ::std::uint64_t epoch() const
+   {
+      ::std::lock_guard lock(m_mutex);
+      return m_epoch;
+   }
+
+   /// the suffix of the base snapshot file next to the journal file
+   static constexpr const char *base_suffix = ".base";
+
+  private:
+   /// the path of the journal file
+   ::std::string m_path;
+   /// the descriptor of the journal file
+   int m_fd;
+   /// the size of the journal file including the pending records
+   size_t m_file_bytes;
+   /// the epoch of the journal file
+   ::std::uint64_t m_epoch;
+   /// the capacity recorded in the file headers
+   size_t m_capacity;
+   /// the maximum time a record waits for its commit
+   ::std::chrono::microseconds m_commit_interval;
+   /// the number of pending bytes which trigger a commit
+   size_t m_group_bytes;
+   /// the mutex guarding the pending records, the counters and the flags
+   mutable ::std::mutex m_mutex;
+   /// the condition the worker waits on for work
+   ::std::condition_variable m_wake;
+   /// the condition flushing threads wait on for commits
+   ::std::condition_variable m_committed;
+   /// the framed records appended since the last commit
+   ::std::vector< char > m_pending;
+   /// the framed snapshot of a requested compaction (if any)
+   ::std::vector< char > m_base;
+   /// the number of appended records and compactions
+   ::std::uint64_t m_n_appended = 0;
+   /// the number of committed records and compactions
+   ::std::uint64_t m_n_committed = 0;
+   /// the number of appended records a flush waits for
+   ::std::uint64_t m_n_flush_target = 0;
+   /// whether the writer is being destroyed
+   bool m_stop = false;
+   /// the exception the worker encountered (if any)
+   ::std::exception_ptr m_error = nullptr;
+   /// the worker thread
+   ::std::thread m_worker;
+
+   void _rethrow() const
+   {
+      if(m_error != nullptr) {
+         ::std::rethrow_exception(m_error);
+      }
+   }
+
+   void _work()
+   {
+      ::std::vector< char > records;
+      ::std::vector< char > base;
+      ::std::unique_lock lock(m_mutex);
+      while(true) {
+         m_wake.wait_for(lock, m_commit_interval, [&] {
+            return m_stop or m_n_flush_target > m_n_committed or not m_base.empty()
+                   or m_pending.size() >= m_group_bytes;
+         });
+         records.clear();
+         base.clear();
+         ::std::swap(records, m_pending);
+         ::std::swap(base, m_base);
+         auto epoch = m_epoch;
+         auto n_appended = m_n_appended;
+         bool stop = m_stop;
+         lock.unlock();
+         try {
+            if(not base.empty()) {
+               _write_base(base, epoch);
+            }
+            if(not records.empty()) {
+               JournalFiles::seal(records);
+               JournalFiles::write_all(m_fd, records.data(), records.size());
+               JournalFiles::sync(m_fd);
+            }
+         } catch(...) {
+            lock.lock();
+            m_error = ::std::current_exception();
+            m_committed.notify_all();
+            return;
+         }
+         lock.lock();
+         m_n_committed = n_appended;
+         m_committed.notify_all();
+         if(stop and m_pending.empty() and m_base.empty()) {
+            return;
+         }
+      }
+   }
+
+   void _write_base(const ::std::vector< char > &base, ::std::uint64_t epoch)
+   {
+      JournalFiles::replace(m_path + base_suffix, base);
+      // a crash before the new journal replaces the old one leaves a journal of an older epoch,
+      // which is ignored when opening
+      ::std::vector< char > journal;
+      ReplayProtocol::append(journal, JournalFiles::make_header(epoch, m_capacity));
+      JournalFiles::replace(m_path, journal);
+      ::close(m_fd);
+      m_fd = JournalFiles::open_append(m_path, journal.size());
+   }
+};
+
+/**
+ * Prioritized Experience Replay buffer whose modifications are recorded in a write-ahead journal.
+ *
+ * Every `push`, `update` and change of \f$ \alpha \f$ or \f$ \beta \f$ is applied to the buffer
+ * and appended to the journal file at @p path as a compact binary record (see `JournalOp`). A
+ * `JournalWriter` commits the records in the background with group commit, hence the
+ * modifications only pay for encoding their arguments. A crash loses at most the records of the
+ * last commit interval. Records torn by a crash are detected by their checksum and dropped.
+ *
+ * Once the journal exceeds @p compact_bytes, it is compacted: the complete buffer state is written
+ * to the base snapshot at `path + ".base"` and the journal starts over empty.
+ *
+ * Constructing the buffer on existing files recovers the state: the snapshot is restored by a
+ * single rebuild of the sum tree (see `PrioritizedExperience::restore`), after which the journal
+ * records are applied in order. Bulk pushes are replayed as bulk pushes, so that the recovered
+ * buffer equals the journaled one, except for the rounding of the sums in the rebuilt tree (and
+ * thereby of the weights of later pushes). Sampling is not journaled, hence the random number
+ * generator continues from its state at the last compaction.
+ *
+ * The buffer always uses the FIFO eviction policy.
+ *
+ * @tparam ValueType the data value type to store. Has to be encodable by `JournalCodec`.
+ */
+template < typename ValueType >
+class PER_API JournaledExperience {
+  public:
+   using BufferType = PrioritizedExperience< ValueType >;
+   using value_type = ValueType;
+   using ValueVec = typename BufferType::ValueVec;
+   using WeightVec = typename BufferType::WeightVec;
+   using IndexVec = typename BufferType::IndexVec;
+   using seed_type = typename BufferType::seed_type;
+   using Codec = JournalCodec< ValueType >;
+
+   /**
+    * The constructor. Recovers the state from the journal at @p path if it exists.
+    *
+    * @param path the path of the journal file.
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$. Overridden by
+    * the recovered state.
+    * @param beta the 'temperature' parameter for the weights. Overridden by the recovered state.
+    * @param seed the random seed for sampling. Overridden by the recovered state.
+    * @param commit_interval the maximum time in seconds records wait for their commit.
+    * @param compact_bytes the size of the journal in bytes which triggers a compaction. 0 disables
+    * automatic compactions.
+    * @throw ::std::invalid_argument if the journal was written for a different capacity.
+    */
+   JournaledExperience(
+      ::std::string path,
+      size_t capacity,
+      double alpha = 1.,
+      double beta = 1.,
+      seed_type seed = ::std::random_device{}(),
+      double commit_interval = 1.,
+      size_t compact_bytes = size_t(1) << 28u);
+
+   /**
+    * Add a sample to the buffer.
+    * @param value the sample to add.
+    */
+   void push(value_type value);
+   /**
+    * Add a collection of samples to the buffer.
+    * @param values the vector of samples to add.
+    */
+   void push(ValueVec values);
+   /**
+    * Update the given sample indices with new priorities.
+    *
+    * The arguments are validated before any update is applied, so that a failing update leaves
+    * both the buffer and the journal unchanged.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    * @throw ::std::invalid_argument if there are fewer priorities than indices.
+    * @throw ::std::out_of_range if an index does not address a held sample.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities);
+   /**
+    * Setter for \f$ \alpha \f$.
+    * @param alpha the new value.
+    */
+   void alpha(double alpha);
+   /**
+    * Setter for \f$ \beta \f$.
+    * @param beta the new value.
+    */
+   void beta(double beta);
+
+   /**
+    * Sample @p n samples from the buffer according to the PER method.
+    * @param n the number of samples to draw.
+    * @return a tuple of 3 vectors holding the values, weights, and indices respectively.
+    */
+   ::std::tuple< ValueVec, WeightVec, IndexVec > sample(size_t n) { return m_buffer.sample(n); }
+   /**
+    * Sample @p n samples from the buffer and hand each drawn entry to @p visitor. See
+    * `PrioritizedExperience::sample_each`.
+    */
+   template < typename Visitor >
+   size_t sample_each(size_t n, Visitor &&visitor)
+   {
+      return m_buffer.sample_each(n, ::std::forward< Visitor >(visitor));
+   }
+
+   /**
+    * Block until all modifications so far are committed to the journal.
+    */
+   void flush() { m_writer->flush(); }
+   /**
+    * Write the complete state to the base snapshot and start over with an empty journal.
+    *
+    * The state is copied on the calling thread, the files are written in the background.
+    */
+   void compact();
+
+   [[nodiscard]] double alpha() const { return m_buffer.alpha(); }
+   [[nodiscard]] double beta() const { return m_buffer.beta(); }
+   [[nodiscard]] auto capacity() const { return m_buffer.capacity(); }
+   [[nodiscard]] auto size() const { return m_buffer.size(); }
+   /**
+    * Getter for the underlying buffer.
+    * @return a const reference to the buffer.
+    */
+   [[nodiscard]] const BufferType &buffer() const { return m_buffer; }
+   /**
+    * Getter for the size of the journal file including the records pending for commit.
+    * @return the number of bytes.
+    */
+   [[nodiscard]] size_t journal_bytes() const { return m_writer->file_bytes(); }
+   /**
+    * Getter for the number of compactions of the journal.
+    * @return the epoch.
+    */
+   [[nodiscard]] ::std::uint64_t epoch() const { return m_writer->epoch(); }
+
+  private:
+   /// the journaled buffer
+   BufferType m_buffer;
+   /// the size of the journal which triggers a compaction
+   size_t m_compact_bytes;
+   /// the reused buffer of the record payloads
+   ::std::vector< char > m_payload;
+   /// the background writer of the journal
+   ::std::unique_ptr< JournalWriter > m_writer;
+
+   void _append(JournalOp op);
+   void _apply(JournalOp op, ReplayProtocol::Reader &reader);
+   [[nodiscard]] ::std::vector< char > _encode_state() const;
+   void _decode_state(ReplayProtocol::Reader &reader);
+};
+
+template < typename ValueType >
+JournaledExperience< ValueType >::JournaledExperience(
+   ::std::string path,
+   size_t capacity,
+   double alpha,
+   double beta,
+   seed_type seed,
+   double commit_interval,
+   size_t compact_bytes)
+    : m_buffer(capacity, alpha, beta, seed, EvictionPolicy::fifo), m_compact_bytes(compact_bytes)
+{
+   auto check_capacity = [&](const ::std::vector< char > &data, const ::std::string &file) {
+      auto recorded = JournalFiles::header_of(data).capacity;
+      if(recorded != capacity) {
+         throw ::std::invalid_argument(
+            "Journal '" + file + "' was written for capacity '" + ::std::to_string(recorded)
+            + "' instead of '" + ::std::to_string(capacity) + "'.");
+      }
+   };
+   auto base_path = path + JournalWriter::base_suffix;
+   ::std::uint64_t epoch = 0;
+   if(auto base = JournalFiles::read(base_path); base.has_value()) {
+      check_capacity(*base, base_path);
+      epoch = JournalFiles::header_of(*base).epoch;
+      bool restored = false;
+      JournalFiles::scan(*base, [&](JournalOp op, ReplayProtocol::Reader &reader) {
+         if(op == JournalOp::state) {
+            _decode_state(reader);
+            restored = true;
+         }
+      });
+      if(not restored) {
+         throw ::std::invalid_argument("Journal snapshot '" + base_path + "' is corrupted.");
+      }
+   } else {
+      ::std::vector< char > data;
+      ReplayProtocol::append(data, JournalFiles::make_header(epoch, capacity));
+      JournalFiles::append_record(data, JournalOp::state, _encode_state());
+      JournalFiles::replace(base_path, data);
+   }
+
+   auto journal = JournalFiles::read(path);
+   size_t journal_bytes = sizeof(JournalFileHeader);
+   if(journal.has_value() and JournalFiles::header_of(*journal).epoch == epoch) {
+      check_capacity(*journal, path);
+      journal_bytes = JournalFiles::scan(
+         *journal, [&](JournalOp op, ReplayProtocol::Reader &reader) { _apply(op, reader); });
+   } else {
+      // no journal yet, or one left behind by a compaction interrupted after its snapshot
+      ::std::vector< char > data;
+      ReplayProtocol::append(data, JournalFiles::make_header(epoch, capacity));
+      JournalFiles::replace(path, data);
+   }
+   int fd = JournalFiles::open_append(path, journal_bytes);
+   m_writer = ::std::make_unique< JournalWriter >(
+      path,
+      fd,
+      journal_bytes,
+      epoch,
+      capacity,
+      ::std::chrono::microseconds(static_cast< ::std::int64_t >(commit_interval * 1e6)));
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::_append(JournalOp op)
+{
+   m_writer->append(op, m_payload);
+   if(m_compact_bytes > 0 and m_writer->file_bytes() >= m_compact_bytes) {
+      compact();
+   }
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::push(value_type value)
+{
+   m_payload.clear();
+   Codec::encode(m_payload, value);
+   m_buffer.push(::std::move(value));
+   _append(JournalOp::push);
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::push(ValueVec values)
+{
+   m_payload.clear();
+   ReplayProtocol::append< ::std::uint64_t >(m_payload, values.size());
+   for(const auto &value : values) {
+      Codec::encode(m_payload, value);
+   }
+   m_buffer.push(::std::move(values));
+   _append(JournalOp::push_many);
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   // the buffer applies the updates one by one. A failure midway would leave an applied prefix
+   // that is never journaled, hence all arguments are validated first.
+   if(priorities.size() < indices.size()) {
+      throw ::std::invalid_argument("Priority sequence is shorter than the index sequence.");
+   }
+   for(auto index : indices) {
+      if(index >= m_buffer.size()) {
+         throw ::std::out_of_range("Index '" + ::std::to_string(index) + "' out of bounds.");
+      }
+   }
+   m_buffer.update(indices, priorities);
+   m_payload.clear();
+   ReplayProtocol::append< ::std::uint64_t >(m_payload, indices.size());
+   for(::std::uint64_t index : indices) {
+      ReplayProtocol::append(m_payload, index);
+   }
+   ReplayProtocol::append(m_payload, priorities.data(), indices.size());
+   _append(JournalOp::update);
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::alpha(double alpha)
+{
+   m_buffer.alpha(alpha);
+   m_payload.clear();
+   ReplayProtocol::append(m_payload, alpha);
+   _append(JournalOp::alpha);
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::beta(double beta)
+{
+   m_buffer.beta(beta);
+   m_payload.clear();
+   ReplayProtocol::append(m_payload, beta);
+   _append(JournalOp::beta);
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::compact()
+{
+   m_writer->compact(_encode_state());
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::_apply(JournalOp op, ReplayProtocol::Reader &reader)
+{
+   switch(op) {
+      case JournalOp::push: {
+         m_buffer.push(Codec::decode(reader));
+         break;
+      }
+      case JournalOp::push_many: {
+         auto n = reader.read< ::std::uint64_t >();
+         ValueVec values;
+         values.reserve(n);
+         for(::std::uint64_t i = 0; i < n; i++) {
+            values.emplace_back(Codec::decode(reader));
+         }
+         m_buffer.push(::std::move(values));
+         break;
+      }
+      case JournalOp::update: {
+         auto n = reader.read< ::std::uint64_t >();
+         const auto *index_bytes = reader.take(n * sizeof(::std::uint64_t));
+         const auto *priority_bytes = reader.take(n * sizeof(double));
+         ::std::vector< ::std::uint64_t > indices(n);
+         ::std::vector< double > priorities(n);
+         if(n > 0) {
+            ::std::memcpy(indices.data(), index_bytes, n * sizeof(::std::uint64_t));
+            ::std::memcpy(priorities.data(), priority_bytes, n * sizeof(double));
+         }
+         m_buffer.update({indices.begin(), indices.end()}, priorities);
+         break;
+      }
+      case JournalOp::alpha: {
+         m_buffer.alpha(reader.read< double >());
+         break;
+      }
+      case JournalOp::beta: {
+         m_buffer.beta(reader.read< double >());
+         break;
+      }
+      default: throw ::std::invalid_argument("Unexpected operation in the journal.");
+   }
+}
+
+template < typename ValueType >
+::std::vector< char > JournaledExperience< ValueType >::_encode_state() const
+{
+   auto state = m_buffer.state();
+   ::std::vector< char > payload;
+   ReplayProtocol::append< ::std::uint64_t >(payload, state.values.size());
+   ReplayProtocol::append< ::std::uint64_t >(payload, state.cursor);
+   ReplayProtocol::append(payload, state.alpha);
+   ReplayProtocol::append(payload, state.beta);
+   ReplayProtocol::append(payload, state.max_priority);
+   ReplayProtocol::append(payload, state.fresh_priority);
+   ReplayProtocol::append(payload, state.max_weight);
+   ReplayProtocol::append(payload, state.rng.seed());
+   ReplayProtocol::append(payload, state.rng.counter());
+   for(const auto &value : state.values) {
+      Codec::encode(payload, value);
+   }
+   ReplayProtocol::append(payload, state.weights.data(), state.weights.size());
+   ReplayProtocol::append(payload, state.priorities.data(), state.priorities.size());
+   return payload;
+}
+
+template < typename ValueType >
+void JournaledExperience< ValueType >::_decode_state(ReplayProtocol::Reader &reader)
+{
+   typename BufferType::State state;
+   size_t n = reader.read< ::std::uint64_t >();
+   state.cursor = reader.read< ::std::uint64_t >();
+   state.alpha = reader.read< double >();
+   state.beta = reader.read< double >();
+   state.max_priority = reader.read< double >();
+   state.fresh_priority = reader.read< double >();
+   state.max_weight = reader.read< double >();
+   auto seed = reader.read< seed_type >();
+   state.rng = CounterRng(seed, reader.read< ::std::uint64_t >());
+   state.values.reserve(n);
+   for(size_t i = 0; i < n; i++) {
+      state.values.emplace_back(Codec::decode(reader));
+   }
+   for(auto *doubles : {&state.weights, &state.priorities}) {
+      const auto *bytes = reader.take(n * sizeof(double));
+      doubles->resize(n);
+      if(n > 0) {
+         ::std::memcpy(doubles->data(), bytes, n * sizeof(double));
+      }
+   }
+   m_buffer.restore(::std::move(state));
+}
+
+   #ifdef PER_COMPILED_LIBRARY
+// instantiated in the compiled per++ library
+extern template class JournaledExperience< int >;
+extern template class JournaledExperience< double >;
+extern template class JournaledExperience< ::std::string >;
+   #endif
+
+}  // namespace per
+
+#endif  // OS == LINUX || OS == MAC
+
+#endif  // PER_JOURNAL_HPP
@@ -0,0 +1,324 @@
+#ifndef PER_MULTI_BUFFER_HPP
+#define PER_MULTI_BUFFER_HPP
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "per/experience_replay.hpp"
+#include "per/macro.hpp"
+#include "per/philox.hpp"
+#include "per/sum_tree.hpp"
+
+namespace per {
+
+/**
+ * Collection of `PrioritizedExperience` sub-buffers (e.g. one per task or actor) sampled jointly.
+ *
+ * A top-level sum tree holds one leaf per sub-buffer whose priority is the sub-buffer's total
+ * priority mass, scaled by the sub-buffer's mixing weight. A draw first descends the top-level tree
+ * to choose a sub-buffer and then continues in the chosen sub-buffer. With all mixing weights equal
+ * to 1 the samples are hence drawn according to the global priority distribution over all
+ * sub-buffers, while a mixing weight of 0 excludes a sub-buffer from sampling.
+ *
+ * The drawn samples are addressed by (sub-buffer, index) pairs, through which their priorities are
+ * updated in the owning sub-buffer. The weights of the samples are those of their sub-buffers.
+ *
+ * @tparam ValueType the data value type of the sub-buffers.
+ */
+template < typename ValueType >
+class PER_API MultiBuffer {
+  public:
+   using BufferType = PrioritizedExperience< ValueType >;
+   using value_type = ValueType;
+   using ValueVec = typename BufferType::ValueVec;
+   using WeightVec = typename BufferType::WeightVec;
+   using IndexVec = typename BufferType::IndexVec;
+   using seed_type = typename BufferType::seed_type;
+   /// the drawn values, weights, sub-buffers, and indices within the sub-buffers (in this order)
+   using BatchType = ::std::tuple< ValueVec, WeightVec, IndexVec, IndexVec >;
+
+   /**
+    * The constructor.
+    *
+    * Creates @p n_buffers sub-buffers of identical configuration with mixing weights of 1.
+    * Sub-buffer b samples with the seed @p seed + b + 1.
+    * @param n_buffers the number of sub-buffers.
+    * @param capacity the capacity of each sub-buffer.
+    * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$.
+    * @param beta the 'temperature' paramter for the weights.
+    * @param seed the random seed for sampling.
+    * @param policy the strategy to choose the sample to overwrite once a sub-buffer is full.
+    */
+   MultiBuffer(
+      size_t n_buffers,
+      size_t capacity,
+      double alpha = 1.,
+      double beta = 1.,
+      seed_type seed = ::std::random_device{}(),
+      EvictionPolicy policy = EvictionPolicy::fifo);
+
+   /**
+    * Add a sample to a sub-buffer.
+    * @param buffer the sub-buffer to add to.
+    * @param value the sample to add.
+    */
+   void push(size_t buffer, value_type value);
+   /**
+    * Add a collection of samples to a sub-buffer.
+    * @param buffer the sub-buffer to add to.
+    * @param values the vector of samples to add.
+    */
+   void push(size_t buffer, ValueVec values);
+   /**
+    * Update the priorities of samples in their sub-buffers.
+    * @param buffers the vector of sub-buffers of the samples.
+    * @param indices the vector of indices within the sub-buffers.
+    * @param priorities the vector of priorities to emplace.
+    * The entries of @p buffers, @p indices and @p priorities are paired.
+    */
+   void update(
+      const IndexVec &buffers,
+      const IndexVec &indices,
+      const ::std::vector< double > &priorities);
+
+   /**
+    * Multiply the priorities of the samples in all sub-buffers by @p factor.
+    *
+    * See `PrioritizedExperience::decay_priorities`. Costs O(1) per sub-buffer.
+    * @param factor the positive and finite factor.
+    */
+   void decay_priorities(double factor);
+
+   /**
+    * Sample @p n samples across all sub-buffers in a single call.
+    *
+    * The sub-buffer of each draw is chosen by the top-level tree first. A sub-buffer which has been
+    * chosen as often as it holds samples is masked for the remaining draws, hence as in
+    * `PrioritizedExperience::sample` no sample is drawn twice. Afterwards every chosen sub-buffer
+    * draws its share of the samples. The returned samples are therefore grouped by sub-buffer.
+    * @param n the number of samples to draw.
+    * @return a tuple of 4 vectors holding the values, weights, sub-buffers, and indices within the
+    * sub-buffers respectively. The entries of these vectors are linked.
+    */
+   BatchType sample(size_t n);
+
+   /**
+    * Setter for the mixing weights of the sub-buffers.
+    * @param weights the finite, non-negative weight of each sub-buffer.
+    */
+   void mixing_weights(::std::vector< double > weights);
+   /**
+    * Getter for the mixing weights of the sub-buffers.
+    * @return the weight of each sub-buffer.
+    */
+   [[nodiscard]] const ::std::vector< double > &mixing_weights() const { return m_mixing_weights; }
+   /**
+    * Access a sub-buffer. All modifications have to go through the `MultiBuffer`, since the
+    * top-level tree would not notice them otherwise.
+    * @param buffer the sub-buffer to access.
+    * @return a const reference to the sub-buffer.
+    */
+   [[nodiscard]] const BufferType &buffer(size_t buffer) const { return m_buffers.at(buffer); }
+   /**
+    * Getter for the number of sub-buffers.
+    * @return the number of sub-buffers.
+    */
+   [[nodiscard]] size_t n_buffers() const { return m_buffers.size(); }
+   /**
+    * Getter for the number of samples held by all sub-buffers.
+    * @return the size.
+    */
+   [[nodiscard]] size_t size() const;
+   /**
+    * Getter for the total mixed priority mass, i.e. the root of the top-level tree.
+    * @return the total priority.
+    */
+   [[nodiscard]] double total() const { return m_toptree.total(); }
+
+  private:
+   /// the sub-buffers
+   ::std::vector< BufferType > m_buffers;
+   /// the mixing weight of each sub-buffer
+   ::std::vector< double > m_mixing_weights;
+   /// the tree of the mixed total priorities of the sub-buffers. Leaf b belongs to sub-buffer b.
+   SumTree< size_t > m_toptree;
+   /// the generator choosing the sub-buffers of the draws
+   CounterRng m_rng;
+
+   /**
+    * Write the mixed total priority of a sub-buffer into the top-level tree.
+    * @param buffer the sub-buffer.
+    */
+   void _refresh(size_t buffer)
+   {
+      m_toptree.update(buffer, m_mixing_weights[buffer] * m_buffers[buffer].total());
+   }
+   /**
+    * Check if the sub-buffer exists.
+    * @param buffer the sub-buffer to check.
+    * @throw ::std::out_of_range exception if there is no such sub-buffer.
+    */
+   void _assert_buffer_in_range(size_t buffer) const
+   {
+      if(buffer >= m_buffers.size()) {
+         throw ::std::out_of_range("Buffer '" + ::std::to_string(buffer) + "' out of bounds.");
+      }
+   }
+};
+
+template < typename ValueType >
+MultiBuffer< ValueType >::MultiBuffer(
+   size_t n_buffers,
+   size_t capacity,
+   double alpha,
+   double beta,
+   seed_type seed,
+   EvictionPolicy policy)
+    : m_mixing_weights(n_buffers, 1.), m_toptree(n_buffers), m_rng(seed)
+{
+   if(n_buffers == 0) {
+      throw ::std::invalid_argument("A MultiBuffer needs at least one sub-buffer.");
+   }
+   m_buffers.reserve(n_buffers);
+   for(size_t b = 0; b < n_buffers; b++) {
+      m_buffers.emplace_back(capacity, alpha, beta, static_cast< seed_type >(seed + b + 1), policy);
+      m_toptree.insert(b, 0.);
+   }
+}
+
+template < typename ValueType >
+void MultiBuffer< ValueType >::push(size_t buffer, value_type value)
+{
+   _assert_buffer_in_range(buffer);
+   m_buffers[buffer].push(::std::move(value));
+   _refresh(buffer);
+}
+
+template < typename ValueType >
+void MultiBuffer< ValueType >::push(size_t buffer, ValueVec values)
+{
+   _assert_buffer_in_range(buffer);
+   m_buffers[buffer].push(::std::move(values));
+   _refresh(buffer);
+}
+
+template < typename ValueType >
+void MultiBuffer< ValueType >::update(
+   const IndexVec &buffers,
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   if(buffers.size() != indices.size() or indices.size() != priorities.size()) {
+      throw ::std::invalid_argument(
+         "Buffer, index, and priority sequence do not match in length.");
+   }
+   // gather the updates per sub-buffer, so that each sub-buffer is updated (and refreshed) once
+   ::std::vector< IndexVec > buffer_indices(m_buffers.size());
+   ::std::vector< ::std::vector< double > > buffer_priorities(m_buffers.size());
+   for(size_t i = 0; i < buffers.size(); i++) {
+      _assert_buffer_in_range(buffers[i]);
+      buffer_indices[buffers[i]].emplace_back(indices[i]);
+      buffer_priorities[buffers[i]].emplace_back(priorities[i]);
+   }
+   for(size_t b = 0; b < m_buffers.size(); b++) {
+      if(not buffer_indices[b].empty()) {
+         m_buffers[b].update(buffer_indices[b], buffer_priorities[b]);
+         _refresh(b);
+      }
+   }
+}
+
+template < typename ValueType >
+void MultiBuffer< ValueType >::decay_priorities(double factor)
+{
+   for(size_t b = 0; b < m_buffers.size(); b++) {
+      m_buffers[b].decay_priorities(factor);
+      _refresh(b);
+   }
+}
+
+template < typename ValueType >
+auto MultiBuffer< ValueType >::sample(size_t n) -> BatchType
+{
+   ValueVec values;
+   WeightVec weights;
+   IndexVec buffers;
+   IndexVec indices;
+
+   auto n_samples = ::std::min(n, size());
+   values.reserve(n_samples);
+   weights.reserve(n_samples);
+   buffers.reserve(n_samples);
+   indices.reserve(n_samples);
+
+   // distribute the draws among the sub-buffers
+   ::std::vector< size_t > counts(m_buffers.size(), 0);
+   for(size_t i = 0; i < n_samples and m_toptree.total() > 0.; i++) {
+      auto b = m_toptree.find(m_rng.uniform(i));
+      if(++counts[b] == m_buffers[b].size()) {
+         // mask the exhausted sub-buffer
+         m_toptree.update(b, 0.);
+      }
+   }
+   m_rng.advance();
+
+   for(size_t b = 0; b < m_buffers.size(); b++) {
+      if(counts[b] == 0) {
+         continue;
+      }
+      // restore the masked priority
+      _refresh(b);
+      m_buffers[b].sample_each(
+         counts[b], [&](size_t index, const value_type &value, double weight) {
+            values.emplace_back(value);
+            weights.emplace_back(weight);
+            buffers.emplace_back(b);
+            indices.emplace_back(index);
+         });
+   }
+   return {values, weights, buffers, indices};
+}
+
+template < typename ValueType >
+void MultiBuffer< ValueType >::mixing_weights(::std::vector< double > weights)
+{
+   if(weights.size() != m_buffers.size()) {
+      throw ::std::invalid_argument(
+         "Expected " + ::std::to_string(m_buffers.size()) + " mixing weights, got "
+         + ::std::to_string(weights.size()) + ".");
+   }
+   for(double weight : weights) {
+      if(not(weight >= 0.) or not ::std::isfinite(weight)) {
+         throw ::std::invalid_argument("Mixing weights must be finite and non-negative.");
+      }
+   }
+   m_mixing_weights = ::std::move(weights);
+   for(size_t b = 0; b < m_buffers.size(); b++) {
+      _refresh(b);
+   }
+}
+
+template < typename ValueType >
+size_t MultiBuffer< ValueType >::size() const
+{
+   size_t size = 0;
+   for(const auto &buffer : m_buffers) {
+      size += buffer.size();
+   }
+   return size;
+}
+
+#ifdef PER_COMPILED_LIBRARY
+// instantiated in the compiled per++ library
+extern template class MultiBuffer< int >;
+extern template class MultiBuffer< double >;
+extern template class MultiBuffer< ::std::string >;
+#endif
+
+}  // namespace per
+
+#endif  // PER_MULTI_BUFFER_HPP
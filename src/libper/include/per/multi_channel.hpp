@@ -0,0 +1,360 @@
+#ifndef PER_MULTI_CHANNEL_HPP
+#define PER_MULTI_CHANNEL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "per/macro.hpp"
+#include "per/philox.hpp"
+#include "per/simd_math.hpp"
+#include "per/sum_tree.hpp"
+
+namespace per {
+
+/**
+ * Prioritized Experience Replay buffer with several priority channels over one value store.
+ *
+ * Each channel (e.g. a head of a network or an agent) holds its own sum tree of priorities and its
+ * own \f$ \alpha \f$ and \f$ \beta \f$, hence samples are drawn and updated per channel as in a
+ * `PrioritizedExperience` of that configuration. The values are only stored once, so that the
+ * memory of the values is independent of the number of channels. The leaves of a channel's tree
+ * hold the weights of the samples with respect to that channel.
+ *
+ * All channels insert in lockstep and the buffer overwrites the oldest sample once the capacity is
+ * exhausted (FIFO).
+ *
+ * @tparam ValueType the data value type to store.
+ */
+template < typename ValueType >
+class PER_API MultiChannelExperience {
+  public:
+   using value_type = ValueType;
+   using ValueVec = ::std::vector< value_type >;
+   using WeightVec = ::std::vector< double >;
+   using IndexVec = ::std::vector< size_t >;
+   using seed_type = CounterRng::seed_type;
+
+   /**
+    * The constructor.
+    *
+    * The number of channels is given by the number of alphas.
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param alphas the degree of uniformity in the distribution \f$ p_i^\alpha \f$ per channel.
+    * @param betas the 'temperature' parameter for the weights per channel.
+    * @param seed the random seed for sampling.
+    */
+   MultiChannelExperience(
+      size_t capacity,
+      const ::std::vector< double > &alphas,
+      const ::std::vector< double > &betas,
+      seed_type seed = ::std::random_device{}());
+
+   /**
+    * Add a sample to the buffer with the maximum priority of every channel.
+    * @param value the sample to add.
+    */
+   void push(value_type value);
+   /**
+    * Add a collection of samples to the buffer.
+    *
+    * Each channel inserts the collection in bulk (see `SumTree::insert`) and recomputes its maxima
+    * at most once, with the same result as pushing the samples one by one.
+    * @param values the vector of samples to add.
+    */
+   void push(ValueVec values);
+   /**
+    * Update the given sample indices of a channel with new priorities.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    * @param channel the channel to update.
+    * The entries of @p indices and @p priorities are paired.
+    */
+   void update(
+      const IndexVec &indices,
+      const ::std::vector< double > &priorities,
+      size_t channel);
+
+   /**
+    * Sample @p n samples according to the priorities of a channel.
+    * @param n the number of samples to draw.
+    * @param channel the channel to sample from.
+    * @return a tuple of 3 vectors holding the values, weights, and indices respectively.
+    */
+   ::std::tuple< ValueVec, WeightVec, IndexVec > sample(size_t n, size_t channel);
+   /**
+    * Sample @p n samples according to the priorities of a channel and hand each drawn entry to
+    * @p visitor. See `PrioritizedExperience::sample_each`.
+    * @param n the number of samples to draw.
+    * @param channel the channel to sample from.
+    * @param visitor a callable of signature (size_t index, const value_type &value, double weight).
+    * @return the number of drawn samples.
+    */
+   template < typename Visitor >
+   size_t sample_each(size_t n, size_t channel, Visitor &&visitor);
+
+   /**
+    * Getter for \f$ \alpha \f$ of a channel.
+    * @param channel the channel.
+    * @return \f$ \alpha \f$.
+    */
+   [[nodiscard]] double alpha(size_t channel) const { return _channel(channel).alpha; }
+   /**
+    * Getter for \f$ \beta \f$ of a channel.
+    * @param channel the channel.
+    * @return \f$ \beta \f$.
+    */
+   [[nodiscard]] double beta(size_t channel) const { return _channel(channel).beta; }
+   /**
+    * Getter for the total priority mass of a channel.
+    * @param channel the channel.
+    * @return the total priority.
+    */
+   [[nodiscard]] double total(size_t channel) const { return _channel(channel).tree.total(); }
+   /**
+    * Getter for the number of channels.
+    * @return the number of channels.
+    */
+   [[nodiscard]] size_t n_channels() const { return m_channels.size(); }
+   /**
+    * Getter for the capacity.
+    * @return the capacity.
+    */
+   [[nodiscard]] size_t capacity() const { return m_capacity; }
+   /**
+    * Getter for the number of currently held samples.
+    * @return the size.
+    */
+   [[nodiscard]] size_t size() const { return m_channels.front().tree.size(); }
+
+  private:
+   /**
+    * The priorities and configuration of a single channel.
+    */
+   struct Channel {
+      double alpha;
+      double beta;
+      /// the current max priority stored
+      double max_priority = 1.;
+      /// the current max weight stored
+      double max_weight = 1.;
+      /// the tree of the exponentiated priorities holding the weights of the samples
+      SumTree< double > tree;
+   };
+
+   /// the buffer maximum number of samples to hold
+   size_t m_capacity;
+   /// the values shared by all channels. Value i belongs to leaf i of every tree.
+   ValueVec m_values;
+   /// the priority channels
+   ::std::vector< Channel > m_channels;
+   /// the counter-based random number generator for sampling
+   CounterRng m_rng;
+   /// the reused buffer of the batch exponentiations
+   ::std::vector< double > m_pow_buffer;
+
+   /**
+    * Insert @p n samples with the maximum priority into the tree of a channel.
+    * @param channel the channel to insert into.
+    * @param n the number of samples.
+    */
+   void _insert(Channel &channel, size_t n);
+   /**
+    * Recompute the maxima of a channel (once) if any of the evicted entries held them.
+    * @param channel the channel whose tree evicted the entries.
+    * @param evicted the evicted (weight, priority) tuples.
+    */
+   static void _recompute_maxima(
+      Channel &channel,
+      const ::std::vector< ::std::tuple< double, double > > &evicted);
+
+   [[nodiscard]] const Channel &_channel(size_t channel) const
+   {
+      if(channel >= m_channels.size()) {
+         throw ::std::out_of_range("Channel '" + ::std::to_string(channel) + "' out of bounds.");
+      }
+      return m_channels[channel];
+   }
+   [[nodiscard]] Channel &_channel(size_t channel)
+   {
+      return const_cast< Channel & >(::std::as_const(*this)._channel(channel));
+   }
+};
+
+template < typename ValueType >
+MultiChannelExperience< ValueType >::MultiChannelExperience(
+   size_t capacity,
+   const ::std::vector< double > &alphas,
+   const ::std::vector< double > &betas,
+   seed_type seed)
+    : m_capacity(capacity), m_values(capacity), m_rng(seed)
+{
+   if(alphas.empty()) {
+      throw ::std::invalid_argument("A MultiChannelExperience needs at least one channel.");
+   }
+   if(alphas.size() != betas.size()) {
+      throw ::std::invalid_argument("Alpha sequence and beta sequence do not match in length.");
+   }
+   m_channels.reserve(alphas.size());
+   for(size_t c = 0; c < alphas.size(); c++) {
+      m_channels.push_back(Channel{alphas[c], betas[c], 1., 1., SumTree< double >(capacity)});
+   }
+}
+
+template < typename ValueType >
+void MultiChannelExperience< ValueType >::push(value_type value)
+{
+   size_t slot = m_channels.front().tree.cursor();
+   for(auto &channel : m_channels) {
+      auto &tree = channel.tree;
+      auto deleted_entry = tree.insert(
+         /*weight=*/::std::pow(
+            channel.max_priority / tree.total() * static_cast< double >(m_capacity), channel.beta),
+         channel.max_priority);
+      if(deleted_entry.has_value()) {
+         _recompute_maxima(channel, {::std::move(deleted_entry.value())});
+      }
+   }
+   m_values[slot] = ::std::move(value);
+}
+
+template < typename ValueType >
+void MultiChannelExperience< ValueType >::push(ValueVec values)
+{
+   size_t n = values.size();
+   size_t slot = m_channels.front().tree.cursor();
+   for(auto &channel : m_channels) {
+      _insert(channel, n);
+   }
+   // only the last `capacity` values survive, as in the trees
+   size_t skip = n > m_capacity ? n - m_capacity : 0;
+   for(size_t i = skip; i < n; i++) {
+      m_values[(slot + i) % m_capacity] = ::std::move(values[i]);
+   }
+}
+
+template < typename ValueType >
+void MultiChannelExperience< ValueType >::_insert(Channel &channel, size_t n)
+{
+   auto &tree = channel.tree;
+   // the weight of each sample depends on the total priority before its insertion, which is
+   // tracked here instead of being read off the tree after every single insertion (see
+   // `PrioritizedExperience::push`).
+   double total = tree.total();
+   m_pow_buffer.resize(n);
+   for(size_t i = 0; i < n; i++) {
+      size_t slot = (tree.cursor() + i) % m_capacity;
+      double evicted_priority = 0.;
+      if(i >= m_capacity) {
+         // the leaf was written by an earlier sample of this collection
+         evicted_priority = channel.max_priority;
+      } else if(slot < tree.size()) {
+         evicted_priority = tree.priority(slot);
+      }
+      m_pow_buffer[i] = channel.max_priority / total * static_cast< double >(m_capacity);
+      total += channel.max_priority - evicted_priority;
+   }
+   pow_abs(m_pow_buffer, channel.beta);
+   _recompute_maxima(
+      channel, tree.insert(m_pow_buffer, ::std::vector< double >(n, channel.max_priority)));
+}
+
+template < typename ValueType >
+void MultiChannelExperience< ValueType >::_recompute_maxima(
+   Channel &channel,
+   const ::std::vector< ::std::tuple< double, double > > &evicted)
+{
+   auto &tree = channel.tree;
+   auto is_max = [](double value, double max) { return ::std::abs(value - max) < 1e-16; };
+   if(::std::any_of(evicted.begin(), evicted.end(), [&](const auto &entry) {
+         return is_max(::std::get< 0 >(entry), channel.max_weight);
+      })) {
+      channel.max_weight = *::std::max_element(tree.value_begin(), tree.value_end());
+   }
+   if(::std::any_of(evicted.begin(), evicted.end(), [&](const auto &entry) {
+         return is_max(::std::get< 1 >(entry), channel.max_priority);
+      })) {
+      channel.max_priority =
+         *::std::max_element(tree.priority_begin(), tree.priority_end()) * tree.scale();
+   }
+}
+
+template < typename ValueType >
+void MultiChannelExperience< ValueType >::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities,
+   size_t channel)
+{
+   if(indices.size() != priorities.size()) {
+      throw ::std::invalid_argument("Index sequence and priority sequence do not match in length.");
+   }
+   auto &chan = _channel(channel);
+   m_pow_buffer.resize(indices.size());
+   pow_abs(priorities.data(), m_pow_buffer.data(), indices.size(), chan.alpha);
+   chan.tree.update(indices, m_pow_buffer);
+}
+
+template < typename ValueType >
+template < typename Visitor >
+size_t MultiChannelExperience< ValueType >::sample_each(
+   size_t n,
+   size_t channel,
+   Visitor &&visitor)
+{
+   auto &tree = _channel(channel).tree;
+   auto n_samples = ::std::min(n, tree.size());
+   IndexVec indices;
+   ::std::vector< double > priorities;
+   indices.reserve(n_samples);
+   priorities.reserve(n_samples);
+
+   for(size_t i = 0; i < n_samples; i++) {
+      auto index = tree.find(m_rng.uniform(i));
+      priorities.emplace_back(tree.priority(index));
+      indices.emplace_back(index);
+      visitor(index, m_values[index], tree[index]);
+      // mask the already sampled elements (sample without replacement)
+      tree.update(index, 0);
+   }
+   m_rng.advance();
+   // restore the priorities
+   tree.update(indices, priorities);
+   return n_samples;
+}
+
+template < typename ValueType >
+auto MultiChannelExperience< ValueType >::sample(size_t n, size_t channel)
+   -> ::std::tuple< ValueVec, WeightVec, IndexVec >
+{
+   ValueVec values;
+   WeightVec weights;
+   IndexVec indices;
+
+   auto n_samples = ::std::min(n, size());
+   values.reserve(n_samples);
+   weights.reserve(n_samples);
+   indices.reserve(n_samples);
+
+   sample_each(n, channel, [&](size_t index, const value_type &value, double weight) {
+      values.emplace_back(value);
+      weights.emplace_back(weight);
+      indices.emplace_back(index);
+   });
+   return {values, weights, indices};
+}
+
+#ifdef PER_COMPILED_LIBRARY
+// instantiated in the compiled per++ library
+extern template class MultiChannelExperience< int >;
+extern template class MultiChannelExperience< double >;
+extern template class MultiChannelExperience< ::std::string >;
+#endif
+
+}  // namespace per
+
+#endif  // PER_MULTI_CHANNEL_HPP
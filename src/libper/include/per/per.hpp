@@ -1,8 +1,24 @@
 #ifndef PER_PER_HPP
 #define PER_PER_HPP
 
+#include "per/alias_table.hpp"
+#include "per/byte_arena.hpp"
+#include "per/compression.hpp"
 #include "per/experience_replay.hpp"
+#include "per/journal.hpp"
 #include "per/macro.hpp"
+#include "per/multi_buffer.hpp"
+#include "per/multi_channel.hpp"
+#include "per/philox.hpp"
+#include "per/prefetch.hpp"
+#include "per/rank_based.hpp"
+#include "per/rate_limiter.hpp"
+#include "per/replay_client.hpp"
+#include "per/replay_protocol.hpp"
+#include "per/replay_server.hpp"
+#include "per/shared_experience.hpp"
+#include "per/simd_math.hpp"
 #include "per/sum_tree.hpp"
+#include "per/thread_pool.hpp"
 
 #endif  // PER_EXPERIENCE_REPLAY_HPP
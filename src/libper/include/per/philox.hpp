@@ -0,0 +1,132 @@
+#ifndef PER_PHILOX_HPP
+#define PER_PHILOX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "per/macro.hpp"
+
+namespace per {
+
+/**
+ * The counter-based pseudo random bijection Philox4x32-10 as defined in \cite{philox}.
+ *
+ * Each output block is a pure function of a 128 bit counter and a 64 bit key. Hence, arbitrary
+ * blocks of the random stream can be computed independently of each other (e.g. by different
+ * threads or SIMD lanes) without any shared generator state.
+ */
+class PER_API Philox4x32 {
+  public:
+   using counter_type = ::std::array< ::std::uint32_t, 4 >;
+   using key_type = ::std::array< ::std::uint32_t, 2 >;
+   using result_type = counter_type;
+
+   /**
+    * Compute the random block pertaining to the given counter and key.
+    * @param counter the 128 bit counter.
+    * @param key the 64 bit key.
+    * @return the 128 bits of random output.
+    */
+   static constexpr result_type generate(counter_type counter, key_type key)
+   {
+      for(size_t round = 0; round < n_rounds; round++) {
+         if(round > 0) {
+            key[0] += weyl_0;
+            key[1] += weyl_1;
+         }
+         auto product_0 = static_cast< ::std::uint64_t >(multiplier_0) * counter[0];
+         auto product_1 = static_cast< ::std::uint64_t >(multiplier_1) * counter[2];
+         counter = {
+            static_cast< ::std::uint32_t >(product_1 >> 32u) ^ counter[1] ^ key[0],
+            static_cast< ::std::uint32_t >(product_1),
+            static_cast< ::std::uint32_t >(product_0 >> 32u) ^ counter[3] ^ key[1],
+            static_cast< ::std::uint32_t >(product_0)};
+      }
+      return counter;
+   }
+
+  private:
+   static constexpr size_t n_rounds = 10;
+   static constexpr ::std::uint32_t multiplier_0 = 0xD2511F53;
+   static constexpr ::std::uint32_t multiplier_1 = 0xCD9E8D57;
+   static constexpr ::std::uint32_t weyl_0 = 0x9E3779B9;
+   static constexpr ::std::uint32_t weyl_1 = 0xBB67AE85;
+};
+
+/**
+ * Reproducible source of uniform random numbers for batch sampling based on `Philox4x32`.
+ *
+ * The uniform of draw @p slot within the current batch is a pure function of (seed, counter,
+ * slot), where the counter is advanced once per sampled batch. The complete generator state
+ * consists of the two integers (seed, counter), which makes it trivially serializable.
+ */
+class PER_API CounterRng {
+  public:
+   using seed_type = ::std::uint64_t;
+
+   /**
+    * The constructor.
+    * @param seed the random seed.
+    * @param counter the number of batches drawn so far.
+    */
+   explicit CounterRng(seed_type seed, ::std::uint64_t counter = 0)
+       : m_seed(seed), m_counter(counter)
+   {
+   }
+
+   /**
+    * Compute the uniform random number in [0, 1) of the given slot in the current batch.
+    * @param slot the draw's position within the batch.
+    * @return the uniform random number.
+    */
+   [[nodiscard]] double uniform(::std::uint64_t slot) const
+   {
+      auto block = Philox4x32::generate(
+         {_low(slot), _high(slot), _low(m_counter), _high(m_counter)},
+         {_low(m_seed), _high(m_seed)});
+      auto bits = (static_cast< ::std::uint64_t >(block[0]) << 32u) | block[1];
+      // use the upper 53 bits to fill the mantissa of the double precisely
+      return static_cast< double >(bits >> 11u) * 0x1.0p-53;
+   }
+   /**
+    * Move on to the next batch.
+    */
+   void advance() { m_counter++; }
+
+   /**
+    * Getter for the seed.
+    * @return the seed.
+    */
+   [[nodiscard]] seed_type seed() const { return m_seed; }
+   /**
+    * Getter for the batch counter.
+    * @return the counter.
+    */
+   [[nodiscard]] ::std::uint64_t counter() const { return m_counter; }
+
+   bool operator==(const CounterRng &other) const
+   {
+      return m_seed == other.m_seed and m_counter == other.m_counter;
+   }
+   bool operator!=(const CounterRng &other) const { return not(*this == other); }
+
+  private:
+   /// the seed forming the Philox key
+   seed_type m_seed;
+   /// the number of batches drawn so far
+   ::std::uint64_t m_counter;
+
+   static ::std::uint32_t _low(::std::uint64_t value)
+   {
+      return static_cast< ::std::uint32_t >(value);
+   }
+   static ::std::uint32_t _high(::std::uint64_t value)
+   {
+      return static_cast< ::std::uint32_t >(value >> 32u);
+   }
+};
+
+}  // namespace per
+
+#endif  // PER_PHILOX_HPP
@@ -0,0 +1,273 @@
+#ifndef PER_PREFETCH_HPP
+#define PER_PREFETCH_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "per/experience_replay.hpp"
+#include "per/macro.hpp"
+#include "per/utils.hpp"
+
+namespace per {
+
+/**
+ * Background sampler preparing the next batches of a `PrioritizedExperience` buffer ahead of time.
+ *
+ * A worker thread draws batches of a fixed size from the buffer and places them into a bounded
+ * queue of @p n_prefetch batches, while the consumer trains on the batch it received last.
+ * Batches are only drawn once the buffer holds at least one batch worth of samples.
+ *
+ * All modifications of the buffer have to go through the sampler (`push`, `update`), since the
+ * worker and the consumer would otherwise race on the buffer. Modifications take effect for the
+ * next batch the worker draws. Batches already waiting in the queue are not redrawn, hence a batch
+ * returned by `next` reflects the priorities (and entries) of the buffer up to @p n_prefetch
+ * batches ago. In particular, its indices may already address entries that were overwritten by
+ * later pushes.
+ *
+ * Without any interleaved modifications, the sequence of prefetched batches is identical to the
+ * sequence of `sample` calls on the buffer.
+ *
+ * @tparam ValueType the data value type of the underlying buffer.
+ * @tparam SampleGuard a default constructible type, instantiated by the worker for the duration of
+ * each draw (e.g. a lock required to copy the values).
+ */
+template < typename ValueType, typename SampleGuard = NoGuard >
+class PER_API PrefetchingSampler {
+  public:
+   using BufferType = PrioritizedExperience< ValueType >;
+   using value_type = ValueType;
+   using ValueVec = typename BufferType::ValueVec;
+   using WeightVec = typename BufferType::WeightVec;
+   using IndexVec = typename BufferType::IndexVec;
+   using BatchType = ::std::tuple< ValueVec, WeightVec, IndexVec >;
+
+   /**
+    * The constructor. Starts the worker thread.
+    *
+    * @param buffer the buffer to sample from. Must outlive the sampler.
+    * @param batch_size the number of samples per batch.
+    * @param n_prefetch the maximum number of batches to prepare ahead of time.
+    */
+   PrefetchingSampler(BufferType &buffer, size_t batch_size, size_t n_prefetch = 2);
+
+   PrefetchingSampler(const PrefetchingSampler &) = delete;
+   PrefetchingSampler &operator=(const PrefetchingSampler &) = delete;
+
+   /**
+    * The destructor. Stops the worker thread.
+    */
+   ~PrefetchingSampler();
+
+   /**
+    * Retrieve the next prepared batch, waiting for the worker if none is ready yet.
+    *
+    * @return the next batch, or an empty optional if the sampler has been stopped.
+    * @throw any exception the worker encountered while drawing.
+    */
+   ::std::optional< BatchType > next();
+
+   /**
+    * Add a sample to the buffer.
+    * @param value the sample to add.
+    */
+   void push(value_type value);
+   /**
+    * Add a collection of samples to the buffer.
+    * @param values the vector of samples to add.
+    */
+   void push(const ValueVec &values);
+   /**
+    * Update the given sample indices with new priorities.
+    *
+    * The update only affects batches drawn after this call (see the class description).
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities);
+
+   /**
+    * Stop the worker thread. Pending calls to `next` return an empty optional.
+    *
+    * Batches already in the queue are discarded.
+    */
+   void stop();
+
+   /**
+    * Getter for the batch size.
+    * @return the batch size.
+    */
+   [[nodiscard]] auto batch_size() const { return m_batch_size; }
+   /**
+    * Getter for the maximum number of prefetched batches.
+    * @return the queue capacity.
+    */
+   [[nodiscard]] auto n_prefetch() const { return m_n_prefetch; }
+
+  private:
+   /// the buffer to sample from
+   BufferType &m_buffer;
+   /// the number of samples per batch
+   size_t m_batch_size;
+   /// the maximum number of prepared batches
+   size_t m_n_prefetch;
+   /// the mutex guarding any access to the buffer
+   ::std::mutex m_buffer_mutex;
+   /// the mutex guarding the queue, the flags and the error
+   ::std::mutex m_queue_mutex;
+   /// the condition the worker waits on for free queue slots (or a sufficiently filled buffer)
+   ::std::condition_variable m_not_full;
+   /// the condition consumers wait on for prepared batches
+   ::std::condition_variable m_not_empty;
+   /// the queue of prepared batches
+   ::std::deque< BatchType > m_queue;
+   /// whether the buffer holds enough samples for a full batch
+   bool m_fillable = false;
+   /// whether the sampler has been stopped
+   bool m_stop = false;
+   /// the exception the worker encountered (if any)
+   ::std::exception_ptr m_error = nullptr;
+   /// the worker thread
+   ::std::thread m_worker;
+
+   void _work();
+   void _notify_pushed();
+};
+
+template < typename ValueType, typename SampleGuard >
+PrefetchingSampler< ValueType, SampleGuard >::PrefetchingSampler(
+   BufferType &buffer,
+   size_t batch_size,
+   size_t n_prefetch)
+    : m_buffer(buffer),
+      m_batch_size(batch_size),
+      m_n_prefetch(::std::max(n_prefetch, size_t(1))),
+      m_fillable(buffer.size() >= batch_size)
+{
+   m_worker = ::std::thread([this] { _work(); });
+}
+
+template < typename ValueType, typename SampleGuard >
+PrefetchingSampler< ValueType, SampleGuard >::~PrefetchingSampler()
+{
+   stop();
+}
+
+template < typename ValueType, typename SampleGuard >
+void PrefetchingSampler< ValueType, SampleGuard >::stop()
+{
+   {
+      ::std::scoped_lock lock(m_queue_mutex);
+      m_stop = true;
+   }
+   m_not_full.notify_all();
+   m_not_empty.notify_all();
+   if(m_worker.joinable()) {
+      m_worker.join();
+   }
+}
+
+template < typename ValueType, typename SampleGuard >
+auto PrefetchingSampler< ValueType, SampleGuard >::next() -> ::std::optional< BatchType >
+{
+   ::std::unique_lock lock(m_queue_mutex);
+   m_not_empty.wait(lock, [this] { return m_stop or not m_queue.empty(); });
+   if(m_error) {
+      ::std::rethrow_exception(m_error);
+   }
+   if(m_stop) {
+      return ::std::nullopt;
+   }
+   auto batch = ::std::move(m_queue.front());
+   m_queue.pop_front();
+   lock.unlock();
+   m_not_full.notify_one();
+   return batch;
+}
+
+template < typename ValueType, typename SampleGuard >
+void PrefetchingSampler< ValueType, SampleGuard >::push(value_type value)
+{
+   {
+      ::std::scoped_lock lock(m_buffer_mutex);
+      m_buffer.push(::std::move(value));
+   }
+   _notify_pushed();
+}
+
+template < typename ValueType, typename SampleGuard >
+void PrefetchingSampler< ValueType, SampleGuard >::push(const ValueVec &values)
+{
+   {
+      ::std::scoped_lock lock(m_buffer_mutex);
+      m_buffer.push(values);
+   }
+   _notify_pushed();
+}
+
+template < typename ValueType, typename SampleGuard >
+void PrefetchingSampler< ValueType, SampleGuard >::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   ::std::scoped_lock lock(m_buffer_mutex);
+   m_buffer.update(indices, priorities);
+}
+
+template < typename ValueType, typename SampleGuard >
+void PrefetchingSampler< ValueType, SampleGuard >::_notify_pushed()
+{
+   {
+      ::std::scoped_lock lock(m_queue_mutex);
+      if(m_fillable) {
+         return;
+      }
+      ::std::scoped_lock buffer_lock(m_buffer_mutex);
+      m_fillable = m_buffer.size() >= m_batch_size;
+   }
+   m_not_full.notify_one();
+}
+
+template < typename ValueType, typename SampleGuard >
+void PrefetchingSampler< ValueType, SampleGuard >::_work()
+{
+   while(true) {
+      {
+         ::std::unique_lock lock(m_queue_mutex);
+         m_not_full.wait(lock, [this] {
+            return m_stop or (m_fillable and m_queue.size() < m_n_prefetch);
+         });
+         if(m_stop) {
+            return;
+         }
+      }
+      BatchType batch;
+      try {
+         [[maybe_unused]] SampleGuard guard;
+         ::std::scoped_lock lock(m_buffer_mutex);
+         batch = m_buffer.sample(m_batch_size);
+      } catch(...) {
+         {
+            ::std::scoped_lock lock(m_queue_mutex);
+            m_error = ::std::current_exception();
+            m_stop = true;
+         }
+         m_not_empty.notify_all();
+         return;
+      }
+      {
+         ::std::scoped_lock lock(m_queue_mutex);
+         m_queue.emplace_back(::std::move(batch));
+      }
+      m_not_empty.notify_one();
+   }
+}
+
+}  // namespace per
+
+#endif  // PER_PREFETCH_HPP
@@ -0,0 +1,445 @@
+#ifndef PER_RANK_BASED_HPP
+#define PER_RANK_BASED_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "per/macro.hpp"
+#include "per/philox.hpp"
+
+namespace per {
+
+/**
+ * Rank-based Prioritized Experience Replay buffer as defined in \cite{per}.
+ *
+ * The samples are drawn according to the rank of their priority instead of its magnitude:
+ *
+ *      \f$ \mathbb{P}(i) = \frac{\text{rank}(i)^{-\alpha}}{\sum_k k^{-\alpha}} \f$
+ *
+ * which makes the distribution insensitive to outliers of the priorities. The ranks are
+ * approximated by the positions of the samples in a binary max-heap over the priorities, which is
+ * kept in O(log n) per push and update. Every `resort_interval` modifications the heap array is
+ * sorted, which turns it into the exact rank order (a sorted array is a valid heap).
+ *
+ * A batch of n samples splits the rank distribution into n segments of equal probability mass and
+ * draws one rank from each segment by inverting the cumulative mass within the segment. The
+ * segment boundaries are computed once per (size, n) combination from the precomputed cumulative
+ * mass of the ranks, hence drawing a batch costs O(n log(size / n)), i.e. O(n) for large batches.
+ * Since the segments are disjoint, no sample is drawn twice.
+ *
+ * The buffer overwrites the oldest sample once the capacity is exhausted (FIFO). New samples enter
+ * with the maximum priority seen so far.
+ *
+ * @tparam ValueType the data value type to store.
+ */
+template < typename ValueType >
+class PER_API RankBasedExperience {
+  public:
+   using value_type = ValueType;
+   using ValueVec = ::std::vector< value_type >;
+   using WeightVec = ::std::vector< double >;
+   using IndexVec = ::std::vector< size_t >;
+   using seed_type = CounterRng::seed_type;
+
+   /**
+    * The constructor.
+    *
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param alpha the exponent of the rank distribution \f$ \text{rank}^{-\alpha} \f$.
+    * @param beta the 'temperature' parameter for the weights.
+    * @param seed the random seed for sampling.
+    * @param resort_interval the number of pushes and updates after which the heap is sorted before
+    * the next draw. 0 selects the capacity.
+    */
+   RankBasedExperience(
+      size_t capacity,
+      double alpha = 1.,
+      double beta = 1.,
+      seed_type seed = ::std::random_device{}(),
+      size_t resort_interval = 0);
+
+   /**
+    * Add a sample to the buffer with the maximum priority seen so far.
+    * @param value the sample to add.
+    */
+   void push(value_type value);
+   /**
+    * Add a collection of samples to the buffer.
+    * @param values the vector of samples to add.
+    */
+   void push(ValueVec values);
+   /**
+    * Update the given sample indices with new priorities.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    * The entries of @p indices and @p priorities are paired.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities);
+
+   /**
+    * Sample @p n samples from the buffer according to their ranks.
+    * @param n the number of samples to draw.
+    * @return a tuple of 3 vectors holding the values, weights, and indices respectively. The
+    * weights \f$ (N \cdot \mathbb{P}(i))^{-\beta} \f$ are normalized by their maximum over all
+    * ranks, i.e. they lie in (0, 1].
+    */
+   ::std::tuple< ValueVec, WeightVec, IndexVec > sample(size_t n);
+   /**
+    * Sample @p n samples from the buffer and hand each drawn entry to @p visitor.
+    * @param n the number of samples to draw.
+    * @param visitor a callable of signature (size_t index, const value_type &value, double weight).
+    * @return the number of drawn samples, i.e. the minimum of @p n and the current buffer size.
+    */
+   template < typename Visitor >
+   size_t sample_each(size_t n, Visitor &&visitor);
+
+   /**
+    * Sort the heap, so that the positions of the samples equal their exact ranks.
+    */
+   void sort();
+   /**
+    * Get the current (approximate) rank of a sample.
+    * @param index the index of the sample.
+    * @return the rank, starting at 1 for the highest priority.
+    */
+   [[nodiscard]] size_t rank(size_t index) const
+   {
+      _assert_index_in_range(index);
+      return m_position[index] + 1;
+   }
+
+   /**
+    * Setter for \f$ \alpha \f$. Recomputes the cumulative rank mass in O(capacity).
+    * @param alpha the new value.
+    */
+   void alpha(double alpha);
+   /**
+    * Setter for \f$ \beta \f$.
+    * @param beta the new value.
+    */
+   void beta(double beta) { m_beta = beta; }
+   /**
+    * Getter for \f$ \alpha \f$
+    * @return \f$ \alpha \f$.
+    */
+   [[nodiscard]] double alpha() const { return m_alpha; }
+   /**
+    * Getter for \f$ \beta \f$.
+    * @return \f$ \beta \f$.
+    */
+   [[nodiscard]] double beta() const { return m_beta; }
+   /**
+    * Getter for the capacity.
+    * @return the capacity.
+    */
+   [[nodiscard]] size_t capacity() const { return m_capacity; }
+   /**
+    * Getter for the number of currently held samples.
+    * @return the size.
+    */
+   [[nodiscard]] size_t size() const { return m_heap.size(); }
+   /**
+    * Getter for the state of the random number generator.
+    * @return the generator, i.e. its (seed, counter) state.
+    */
+   [[nodiscard]] const CounterRng &rng() const { return m_rng; }
+   /**
+    * Setter for the state of the random number generator.
+    * @param rng the generator to continue sampling with.
+    */
+   void rng(CounterRng rng) { m_rng = rng; }
+
+  private:
+   /// the buffer maximum number of samples to hold
+   size_t m_capacity;
+   /// the exponent of the rank distribution
+   double m_alpha;
+   /// the temperature parameter for the weights
+   double m_beta;
+   /// the number of modifications after which the heap is sorted
+   size_t m_resort_interval;
+   /// the counter-based random number generator for sampling
+   CounterRng m_rng;
+   /// the values of the samples
+   ValueVec m_values;
+   /// the (absolute) priority of each sample
+   ::std::vector< double > m_priorities;
+   /// the max-heap of the sample indices ordered by priority. The position is the approximate rank.
+   ::std::vector< size_t > m_heap;
+   /// the heap position of each sample index
+   ::std::vector< size_t > m_position;
+   /// the index the next pushed sample is written to
+   size_t m_cursor = 0;
+   /// the maximum priority seen so far
+   double m_max_priority = 1.;
+   /// the number of pushes and updates since the last sort
+   size_t m_n_modified = 0;
+   /// the cumulative mass \f$ \sum_{r \le k} r^{-\alpha} \f$ of the first k + 1 ranks
+   ::std::vector< double > m_rank_mass;
+   /// the cached segment boundaries (in rank positions) and the (size, n) they were computed for
+   ::std::vector< size_t > m_bounds;
+   size_t m_bounds_size = 0;
+   size_t m_bounds_n = 0;
+
+   void _set_priority(size_t index, double priority);
+   void _sift_up(size_t pos);
+   void _sift_down(size_t pos);
+   void _swap(size_t pos1, size_t pos2)
+   {
+      ::std::swap(m_heap[pos1], m_heap[pos2]);
+      m_position[m_heap[pos1]] = pos1;
+      m_position[m_heap[pos2]] = pos2;
+   }
+   [[nodiscard]] bool _higher(size_t pos1, size_t pos2) const
+   {
+      return m_priorities[m_heap[pos1]] > m_priorities[m_heap[pos2]];
+   }
+   /**
+    * Get the probability mass of the rank at the given position.
+    * @param pos the position (rank - 1).
+    * @return the unnormalized mass \f$ (pos + 1)^{-\alpha} \f$.
+    */
+   [[nodiscard]] double _mass(size_t pos) const
+   {
+      return pos == 0 ? m_rank_mass[0] : m_rank_mass[pos] - m_rank_mass[pos - 1];
+   }
+   void _compute_rank_mass();
+   /**
+    * Get the boundaries of @p n segments of equal mass over the current size.
+    * @param n the number of segments.
+    * @return the n + 1 boundaries in rank positions. Every segment holds at least one rank.
+    */
+   const ::std::vector< size_t > &_segments(size_t n);
+   void _assert_index_in_range(size_t index) const
+   {
+      if(index >= size()) {
+         throw ::std::out_of_range("Index '" + ::std::to_string(index) + "' out of bounds.");
+      }
+   }
+};
+
+template < typename ValueType >
+RankBasedExperience< ValueType >::RankBasedExperience(
+   size_t capacity,
+   double alpha,
+   double beta,
+   seed_type seed,
+   size_t resort_interval)
+    : m_capacity(capacity),
+      m_alpha(alpha),
+      m_beta(beta),
+      m_resort_interval(resort_interval == 0 ? capacity : resort_interval),
+      m_rng(seed),
+      m_values(capacity),
+      m_priorities(capacity, 0.),
+      m_position(capacity, 0)
+{
+   m_heap.reserve(capacity);
+   _compute_rank_mass();
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::_compute_rank_mass()
+{
+   m_rank_mass.resize(m_capacity);
+   double total = 0.;
+   for(size_t pos = 0; pos < m_capacity; pos++) {
+      total += ::std::pow(static_cast< double >(pos + 1), -m_alpha);
+      m_rank_mass[pos] = total;
+   }
+   m_bounds_size = 0;
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::_sift_up(size_t pos)
+{
+   // ties move up as well, such that new samples enter above older ones of the same priority
+   while(pos > 0 and not _higher((pos - 1) / 2, pos)) {
+      _swap(pos, (pos - 1) / 2);
+      pos = (pos - 1) / 2;
+   }
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::_sift_down(size_t pos)
+{
+   while(true) {
+      size_t largest = pos;
+      for(size_t child = 2 * pos + 1; child <= 2 * pos + 2 and child < m_heap.size(); child++) {
+         if(_higher(child, largest)) {
+            largest = child;
+         }
+      }
+      if(largest == pos) {
+         return;
+      }
+      _swap(pos, largest);
+      pos = largest;
+   }
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::_set_priority(size_t index, double priority)
+{
+   double old_priority = m_priorities[index];
+   m_priorities[index] = priority;
+   if(priority > old_priority) {
+      _sift_up(m_position[index]);
+   } else {
+      _sift_down(m_position[index]);
+   }
+   m_n_modified++;
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::push(value_type value)
+{
+   size_t index = m_cursor;
+   m_values[index] = ::std::move(value);
+   if(m_heap.size() < m_capacity) {
+      m_position[index] = m_heap.size();
+      m_heap.emplace_back(index);
+      m_priorities[index] = 0.;
+   }
+   _set_priority(index, m_max_priority);
+   m_cursor = (m_cursor + 1) % m_capacity;
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::push(ValueVec values)
+{
+   for(auto &value : values) {
+      push(::std::move(value));
+   }
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   if(indices.size() != priorities.size()) {
+      throw ::std::invalid_argument("Index sequence and priority sequence do not match in length.");
+   }
+   for(size_t i = 0; i < indices.size(); i++) {
+      _assert_index_in_range(indices[i]);
+      double priority = ::std::abs(priorities[i]);
+      m_max_priority = ::std::max(m_max_priority, priority);
+      _set_priority(indices[i], priority);
+   }
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::sort()
+{
+   ::std::sort(m_heap.begin(), m_heap.end(), [&](size_t index1, size_t index2) {
+      return m_priorities[index1] > m_priorities[index2];
+   });
+   for(size_t pos = 0; pos < m_heap.size(); pos++) {
+      m_position[m_heap[pos]] = pos;
+   }
+   m_n_modified = 0;
+}
+
+template < typename ValueType >
+void RankBasedExperience< ValueType >::alpha(double alpha)
+{
+   m_alpha = alpha;
+   _compute_rank_mass();
+}
+
+template < typename ValueType >
+const ::std::vector< size_t > &RankBasedExperience< ValueType >::_segments(size_t n)
+{
+   size_t size = m_heap.size();
+   if(m_bounds_size == size and m_bounds_n == n) {
+      return m_bounds;
+   }
+   m_bounds.resize(n + 1);
+   m_bounds[0] = 0;
+   m_bounds[n] = size;
+   auto first = m_rank_mass.begin();
+   auto last = first + static_cast< ::std::ptrdiff_t >(size);
+   double total = m_rank_mass[size - 1];
+   for(size_t j = 1; j < n; j++) {
+      double target = total * static_cast< double >(j) / static_cast< double >(n);
+      // the segment ends behind the first rank whose cumulative mass reaches the target
+      auto bound = static_cast< size_t >(::std::lower_bound(first, last, target) - first) + 1;
+      m_bounds[j] = ::std::clamp(bound, m_bounds[j - 1] + 1, size - (n - j));
+   }
+   m_bounds_size = size;
+   m_bounds_n = n;
+   return m_bounds;
+}
+
+template < typename ValueType >
+template < typename Visitor >
+size_t RankBasedExperience< ValueType >::sample_each(size_t n, Visitor &&visitor)
+{
+   size_t size = m_heap.size();
+   auto n_samples = ::std::min(n, size);
+   if(n_samples == 0) {
+      m_rng.advance();
+      return 0;
+   }
+   if(m_n_modified >= m_resort_interval) {
+      sort();
+   }
+   const auto &bounds = _segments(n_samples);
+   auto n_ranks = static_cast< double >(size);
+   double total = m_rank_mass[size - 1];
+   // the lowest rank has the lowest probability and hence the highest weight
+   double max_weight = ::std::pow(n_ranks * _mass(size - 1) / total, -m_beta);
+   for(size_t j = 0; j < n_samples; j++) {
+      double target = total * (static_cast< double >(j) + m_rng.uniform(j))
+                      / static_cast< double >(n_samples);
+      auto first = m_rank_mass.begin() + static_cast< ::std::ptrdiff_t >(bounds[j]);
+      auto last = m_rank_mass.begin() + static_cast< ::std::ptrdiff_t >(bounds[j + 1] - 1);
+      // the first rank of the segment whose cumulative mass exceeds the target
+      auto pos = static_cast< size_t >(
+         ::std::upper_bound(first, last, target) - m_rank_mass.begin());
+      size_t index = m_heap[pos];
+      double weight = ::std::pow(n_ranks * _mass(pos) / total, -m_beta) / max_weight;
+      visitor(index, m_values[index], weight);
+   }
+   m_rng.advance();
+   return n_samples;
+}
+
+template < typename ValueType >
+auto RankBasedExperience< ValueType >::sample(size_t n)
+   -> ::std::tuple< ValueVec, WeightVec, IndexVec >
+{
+   ValueVec values;
+   WeightVec weights;
+   IndexVec indices;
+
+   auto n_samples = ::std::min(n, size());
+   values.reserve(n_samples);
+   weights.reserve(n_samples);
+   indices.reserve(n_samples);
+
+   sample_each(n, [&](size_t index, const value_type &value, double weight) {
+      values.emplace_back(value);
+      weights.emplace_back(weight);
+      indices.emplace_back(index);
+   });
+   return {values, weights, indices};
+}
+
+#ifdef PER_COMPILED_LIBRARY
+// instantiated in the compiled per++ library
+extern template class RankBasedExperience< int >;
+extern template class RankBasedExperience< double >;
+extern template class RankBasedExperience< ::std::string >;
+#endif
+
+}  // namespace per
+
+#endif  // PER_RANK_BASED_HPP
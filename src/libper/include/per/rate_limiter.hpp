@@ -0,0 +1,449 @@
+#ifndef PER_RATE_LIMITER_HPP
+#define PER_RATE_LIMITER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "per/experience_replay.hpp"
+#include "per/macro.hpp"
+#include "per/utils.hpp"
+
+namespace per {
+
+/**
+ * Flow control policy keeping the ratio of sampled to inserted entries close to a target.
+ *
+ * The limiter tracks the difference \f$ d = \text{inserts} \cdot \text{spi} - \text{samples} \f$,
+ * with spi being the target samples-per-insert ratio. Once the minimum size is reached, inserts
+ * are only admitted while \f$ d \f$ stays below \f$ \text{spi} \cdot \text{min\_size} + e \f$ and
+ * samples only while \f$ d \f$ stays above \f$ \text{spi} \cdot \text{min\_size} - e \f$, where
+ * \f$ e \f$ is the error buffer. Before the minimum size is reached, inserts are always admitted
+ * and samples never.
+ *
+ * The limiter itself only does the bookkeeping and is not thread safe. See `RateLimitedExperience`
+ * for the blocking buffer built on top of it.
+ */
+class PER_API RateLimiter {
+  public:
+   /**
+    * The constructor.
+    *
+    * @param samples_per_insert the target number of sampled entries per inserted entry.
+    * @param min_size_to_sample the number of inserts before any sampling is admitted.
+    * @param error_buffer the tolerated deviation from the target (in sampled entries).
+    * @throw ::std::invalid_argument if the ratio is not positive or the error buffer is too small
+    * to admit a single insert after a sample.
+    */
+   RateLimiter(double samples_per_insert, size_t min_size_to_sample, double error_buffer)
+       : m_samples_per_insert(samples_per_insert),
+         m_min_size_to_sample(min_size_to_sample),
+         m_error_buffer(error_buffer)
+   {
+      if(samples_per_insert <= 0.) {
+         throw ::std::invalid_argument("The samples per insert ratio has to be positive.");
+      }
+      if(error_buffer < ::std::max(1., samples_per_insert)) {
+         throw ::std::invalid_argument(
+            "The error buffer has to be at least max(1, samples_per_insert).");
+      }
+   }
+
+   /**
+    * Check whether @p n further inserts are admitted.
+    * @param n the number of inserts.
+    * @return true if admitted, false otherwise.
+    */
+   [[nodiscard]] bool can_insert(size_t n) const
+   {
+      return m_inserts + n <= m_min_size_to_sample
+             or _diff() + static_cast< double >(n) * m_samples_per_insert <= _max_diff();
+   }
+   /**
+    * Check whether @p n further sampled entries are admitted.
+    * @param n the number of sampled entries.
+    * @return true if admitted, false otherwise.
+    */
+   [[nodiscard]] bool can_sample(size_t n) const
+   {
+      return m_inserts >= m_min_size_to_sample
+             and _diff() - static_cast< double >(n) >= _min_diff();
+   }
+   /**
+    * Check whether @p n sampled entries can be admitted at all, i.e. fit into the tolerance band.
+    * @param n the number of sampled entries.
+    * @return true if a sample of size @p n is admitted for some history of inserts.
+    */
+   [[nodiscard]] bool admissible_sample(size_t n) const
+   {
+      return static_cast< double >(n) <= 2. * m_error_buffer;
+   }
+
+   /**
+    * Record @p n inserts.
+    */
+   void inserted(size_t n) { m_inserts += n; }
+   /**
+    * Record @p n sampled entries.
+    */
+   void sampled(size_t n) { m_samples += n; }
+
+   /**
+    * Getter for the target samples-per-insert ratio.
+    * @return the ratio.
+    */
+   [[nodiscard]] double samples_per_insert() const { return m_samples_per_insert; }
+   /**
+    * Getter for the minimum number of inserts before sampling.
+    * @return the minimum size.
+    */
+   [[nodiscard]] size_t min_size_to_sample() const { return m_min_size_to_sample; }
+   /**
+    * Getter for the error buffer.
+    * @return the error buffer.
+    */
+   [[nodiscard]] double error_buffer() const { return m_error_buffer; }
+   /**
+    * Getter for the number of recorded inserts.
+    * @return the insert count.
+    */
+   [[nodiscard]] size_t inserts() const { return m_inserts; }
+   /**
+    * Getter for the number of recorded sampled entries.
+    * @return the sample count.
+    */
+   [[nodiscard]] size_t samples() const { return m_samples; }
+
+  private:
+   /// the target number of sampled entries per inserted entry
+   double m_samples_per_insert;
+   /// the number of inserts before sampling is admitted
+   size_t m_min_size_to_sample;
+   /// the tolerated deviation from the target
+   double m_error_buffer;
+   /// the number of inserts so far
+   size_t m_inserts = 0;
+   /// the number of sampled entries so far
+   size_t m_samples = 0;
+
+   [[nodiscard]] double _diff() const
+   {
+      return static_cast< double >(m_inserts) * m_samples_per_insert
+             - static_cast< double >(m_samples);
+   }
+   [[nodiscard]] double _min_diff() const
+   {
+      return static_cast< double >(m_min_size_to_sample) * m_samples_per_insert - m_error_buffer;
+   }
+   [[nodiscard]] double _max_diff() const
+   {
+      return static_cast< double >(m_min_size_to_sample) * m_samples_per_insert + m_error_buffer;
+   }
+};
+
+/**
+ * Statistics of a `RateLimitedExperience` buffer.
+ */
+struct RateLimiterStats {
+   /// the number of inserted entries
+   size_t inserts = 0;
+   /// the number of sampled entries
+   size_t samples = 0;
+   /// the accumulated time callers of `push` were blocked
+   double insert_wait_seconds = 0.;
+   /// the accumulated time callers of `sample` were blocked
+   double sample_wait_seconds = 0.;
+   /// the number of `push` calls that timed out
+   size_t insert_timeouts = 0;
+   /// the number of `sample` calls that timed out
+   size_t sample_timeouts = 0;
+};
+
+/**
+ * Thread safe access to a `PrioritizedExperience` buffer with flow control by a `RateLimiter`.
+ *
+ * Calls of `push` and `sample` block until the limiter admits them, the optional timeout expires,
+ * or the buffer is stopped. Thereby fast actors cannot overwrite entries the learner never saw and
+ * a fast learner cannot oversample a small buffer. All modifications of the buffer have to go
+ * through this class.
+ *
+ * @tparam ValueType the data value type of the underlying buffer.
+ * @tparam BufferGuard a default constructible type, instantiated for the duration of each access
+ * to the buffer (e.g. a lock required to copy the values).
+ */
+template < typename ValueType, typename BufferGuard = NoGuard >
+class PER_API RateLimitedExperience {
+  public:
+   using BufferType = PrioritizedExperience< ValueType >;
+   using value_type = ValueType;
+   using ValueVec = typename BufferType::ValueVec;
+   using WeightVec = typename BufferType::WeightVec;
+   using IndexVec = typename BufferType::IndexVec;
+   using BatchType = ::std::tuple< ValueVec, WeightVec, IndexVec >;
+
+   /**
+    * The constructor.
+    *
+    * @param buffer the buffer to limit the access to. Must outlive this object.
+    * @param limiter the rate limiting policy.
+    */
+   RateLimitedExperience(BufferType &buffer, RateLimiter limiter)
+       : m_buffer(buffer), m_limiter(limiter)
+   {
+   }
+
+   /**
+    * Add a sample to the buffer once the limiter admits it.
+    * @param value the sample to add.
+    * @param timeout the maximum time to wait in seconds. Waits indefinitely if empty.
+    * @return true if the sample was added, false if the call timed out or the buffer was stopped.
+    */
+   bool push(const value_type &value, ::std::optional< double > timeout = ::std::nullopt);
+   /**
+    * Add a collection of samples to the buffer, each one once the limiter admits it.
+    * @param values the vector of samples to add.
+    * @param timeout the maximum time to wait in seconds for the entire collection.
+    * @return the number of added samples, which is less than the collection's size if the call
+    * timed out or the buffer was stopped.
+    */
+   size_t push(const ValueVec &values, ::std::optional< double > timeout = ::std::nullopt);
+   /**
+    * Sample @p n samples from the buffer once the limiter admits it.
+    * @param n the number of samples to draw.
+    * @param timeout the maximum time to wait in seconds. Waits indefinitely if empty.
+    * @return the sampled batch, or an empty optional if the call timed out or the buffer was
+    * stopped.
+    * @throw ::std::invalid_argument if the limiter can never admit a sample of size @p n.
+    */
+   ::std::optional< BatchType >
+   sample(size_t n, ::std::optional< double > timeout = ::std::nullopt);
+   /**
+    * Update the given sample indices with new priorities. Never blocks on the limiter.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities);
+
+   /**
+    * Wake up all blocked callers and make all further blocking calls fail immediately.
+    */
+   void stop();
+
+   /**
+    * Getter for the statistics.
+    * @return a copy of the current statistics.
+    */
+   [[nodiscard]] RateLimiterStats stats() const;
+   /**
+    * Getter for the number of currently held samples.
+    * @return the size.
+    */
+   [[nodiscard]] size_t size() const;
+   /**
+    * Getter for the rate limiting policy.
+    * @return the limiter.
+    */
+   [[nodiscard]] const RateLimiter &limiter() const { return m_limiter; }
+
+  private:
+   using clock = ::std::chrono::steady_clock;
+
+   /// the rate limited buffer
+   BufferType &m_buffer;
+   /// the policy deciding which calls are admitted
+   RateLimiter m_limiter;
+   /// the statistics
+   RateLimiterStats m_stats;
+   /// whether the buffer has been stopped
+   bool m_stop = false;
+   /// the mutex guarding the buffer, the limiter and the statistics
+   mutable ::std::mutex m_mutex;
+   /// the condition blocked `push` calls wait on
+   ::std::condition_variable m_can_insert;
+   /// the condition blocked `sample` calls wait on
+   ::std::condition_variable m_can_sample;
+
+   template < typename Predicate >
+   bool _wait(
+      ::std::unique_lock< ::std::mutex > &lock,
+      ::std::condition_variable &condition,
+      ::std::optional< clock::time_point > deadline,
+      Predicate &&admitted,
+      double &wait_seconds);
+   static ::std::optional< clock::time_point > _deadline(::std::optional< double > timeout);
+};
+
+template < typename ValueType, typename BufferGuard >
+auto RateLimitedExperience< ValueType, BufferGuard >::_deadline(::std::optional< double > timeout)
+   -> ::std::optional< clock::time_point >
+{
+   if(not timeout.has_value()) {
+      return ::std::nullopt;
+   }
+   return clock::now()
+          + ::std::chrono::duration_cast< clock::duration >(
+             ::std::chrono::duration< double >(timeout.value()));
+}
+
+template < typename ValueType, typename BufferGuard >
+template < typename Predicate >
+bool RateLimitedExperience< ValueType, BufferGuard >::_wait(
+   ::std::unique_lock< ::std::mutex > &lock,
+   ::std::condition_variable &condition,
+   ::std::optional< clock::time_point > deadline,
+   Predicate &&admitted,
+   double &wait_seconds)
+{
+   auto ready = [&] { return m_stop or admitted(); };
+   if(not ready()) {
+      auto start = clock::now();
+      if(deadline.has_value()) {
+         condition.wait_until(lock, deadline.value(), ready);
+      } else {
+         condition.wait(lock, ready);
+      }
+      wait_seconds += ::std::chrono::duration< double >(clock::now() - start).count();
+   }
+   return not m_stop and admitted();
+}
+
+template < typename ValueType, typename BufferGuard >
+bool RateLimitedExperience< ValueType, BufferGuard >::push(
+   const value_type &value,
+   ::std::optional< double > timeout)
+{
+   {
+      ::std::unique_lock lock(m_mutex);
+      if(not _wait(
+            lock,
+            m_can_insert,
+            _deadline(timeout),
+            [this] { return m_limiter.can_insert(1); },
+            m_stats.insert_wait_seconds)) {
+         if(not m_stop) {
+            m_stats.insert_timeouts++;
+         }
+         return false;
+      }
+      {
+         [[maybe_unused]] BufferGuard guard;
+         m_buffer.push(value);
+      }
+      m_limiter.inserted(1);
+      m_stats.inserts++;
+   }
+   m_can_sample.notify_all();
+   return true;
+}
+
+template < typename ValueType, typename BufferGuard >
+size_t RateLimitedExperience< ValueType, BufferGuard >::push(
+   const ValueVec &values,
+   ::std::optional< double > timeout)
+{
+   auto deadline = _deadline(timeout);
+   size_t n_pushed = 0;
+   for(const auto &value : values) {
+      {
+         ::std::unique_lock lock(m_mutex);
+         if(not _wait(
+               lock,
+               m_can_insert,
+               deadline,
+               [this] { return m_limiter.can_insert(1); },
+               m_stats.insert_wait_seconds)) {
+            if(not m_stop) {
+               m_stats.insert_timeouts++;
+            }
+            break;
+         }
+         {
+            [[maybe_unused]] BufferGuard guard;
+            m_buffer.push(value);
+         }
+         m_limiter.inserted(1);
+         m_stats.inserts++;
+      }
+      m_can_sample.notify_all();
+      n_pushed++;
+   }
+   return n_pushed;
+}
+
+template < typename ValueType, typename BufferGuard >
+auto RateLimitedExperience< ValueType, BufferGuard >::sample(
+   size_t n,
+   ::std::optional< double > timeout) -> ::std::optional< BatchType >
+{
+   if(not m_limiter.admissible_sample(n)) {
+      throw ::std::invalid_argument(
+         "Sample size " + ::std::to_string(n) + " exceeds the tolerance of the rate limiter.");
+   }
+   ::std::optional< BatchType > batch = ::std::nullopt;
+   {
+      ::std::unique_lock lock(m_mutex);
+      if(not _wait(
+            lock,
+            m_can_sample,
+            _deadline(timeout),
+            [&] { return m_limiter.can_sample(n); },
+            m_stats.sample_wait_seconds)) {
+         if(not m_stop) {
+            m_stats.sample_timeouts++;
+         }
+         return ::std::nullopt;
+      }
+      {
+         [[maybe_unused]] BufferGuard guard;
+         batch = m_buffer.sample(n);
+      }
+      auto n_samples = ::std::get< 0 >(batch.value()).size();
+      m_limiter.sampled(n_samples);
+      m_stats.samples += n_samples;
+   }
+   m_can_insert.notify_all();
+   return batch;
+}
+
+template < typename ValueType, typename BufferGuard >
+void RateLimitedExperience< ValueType, BufferGuard >::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   ::std::scoped_lock lock(m_mutex);
+   m_buffer.update(indices, priorities);
+}
+
+template < typename ValueType, typename BufferGuard >
+void RateLimitedExperience< ValueType, BufferGuard >::stop()
+{
+   {
+      ::std::scoped_lock lock(m_mutex);
+      m_stop = true;
+   }
+   m_can_insert.notify_all();
+   m_can_sample.notify_all();
+}
+
+template < typename ValueType, typename BufferGuard >
+RateLimiterStats RateLimitedExperience< ValueType, BufferGuard >::stats() const
+{
+   ::std::scoped_lock lock(m_mutex);
+   return m_stats;
+}
+
+template < typename ValueType, typename BufferGuard >
+size_t RateLimitedExperience< ValueType, BufferGuard >::size() const
+{
+   ::std::scoped_lock lock(m_mutex);
+   return m_buffer.size();
+}
+
+}  // namespace per
+
+#endif  // PER_RATE_LIMITER_HPP
@@ -0,0 +1,336 @@
+#ifndef PER_REPLAY_CLIENT_HPP
+#define PER_REPLAY_CLIENT_HPP
+
+#include "per/macro.hpp"
+
+#if OS == LINUX || OS == MAC
+
+   #include <sys/socket.h>
+   #include <sys/un.h>
+   #include <unistd.h>
+
+   #include <algorithm>
+   #include <cerrno>
+   #include <cstdint>
+   #include <stdexcept>
+   #include <string>
+   #include <string_view>
+   #include <system_error>
+   #include <vector>
+
+   #include "per/replay_protocol.hpp"
+
+namespace per {
+
+/**
+ * A batch of samples received from a `ReplayServer`.
+ *
+ * The batch owns reusable receive buffers: the value bytes of all samples are stored back to back
+ * in `data` and addressed through `offsets`. Receiving into the same batch again reuses the
+ * allocated memory, so that steady-state sampling performs no allocations.
+ */
+struct ReplaySampleBatch {
+   /// the leaf indices of the samples
+   ::std::vector< ::std::uint64_t > indices;
+   /// the weights of the samples
+   ::std::vector< double > weights;
+   /// the start offset of every value in `data`, followed by the total byte size
+   ::std::vector< ::std::uint64_t > offsets;
+   /// the concatenated value bytes
+   ::std::vector< char > data;
+
+   /**
+    * Getter for the number of samples.
+    * @return the number of samples.
+    */
+   [[nodiscard]] size_t size() const { return indices.size(); }
+   /**
+    * Access the bytes of a sample.
+    * @param i the position of the sample within the batch.
+    * @return a view of the value bytes, valid until the batch is received into again.
+    */
+   [[nodiscard]] ::std::string_view value(size_t i) const
+   {
+      return {data.data() + offsets[i], offsets[i + 1] - offsets[i]};
+   }
+};
+
+/**
+ * Client connection to a `ReplayServer`.
+ *
+ * Requests can either be issued synchronously (`push`, `update`, `sample`) or pipelined: the
+ * `send_*` methods only transmit a request, while the `receive_*` methods read the next pending
+ * response. Responses arrive in request order. A failed request is reported by the `receive_*`
+ * call of its response as ::std::runtime_error carrying the server's message; the connection
+ * remains usable afterwards. So does a response of an unexpected type, whose payload is skipped.
+ * A corrupt response (invalid magic or inconsistent length) leaves the stream out of sync, hence
+ * the client rejects every later request with ::std::runtime_error.
+ */
+class PER_API ReplayClient {
+  public:
+   using IndexVec = ::std::vector< size_t >;
+
+   /**
+    * The constructor. Connects to the server.
+    * @param socket_path the file system path of the server's socket.
+    * @throw ::std::system_error if the connection fails.
+    */
+   explicit ReplayClient(const ::std::string &socket_path);
+
+   ReplayClient(const ReplayClient &) = delete;
+   ReplayClient &operator=(const ReplayClient &) = delete;
+
+   ~ReplayClient() { close(m_fd); }
+
+   /**
+    * Send a request to add samples to the buffer.
+    * @param values the bytes of the samples to add.
+    */
+   void send_push(const ::std::vector< ::std::string > &values);
+   /**
+    * Send a request to update the priorities of the given indices.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    */
+   void send_update(const IndexVec &indices, const ::std::vector< double > &priorities);
+   /**
+    * Send a request to sample @p n samples.
+    * @param n the number of samples to draw.
+    */
+   void send_sample(size_t n);
+
+   /**
+    * Receive the response of a pending push or update request.
+    * @return the number of pushed or updated entries.
+    */
+   size_t receive_ack();
+   /**
+    * Receive the response of a pending sample request directly into the buffers of @p batch.
+    * @param batch the batch to overwrite.
+    */
+   void receive_sample(ReplaySampleBatch &batch);
+
+   /**
+    * Add samples to the buffer and wait for the acknowledgement.
+    * @param values the bytes of the samples to add.
+    * @return the number of pushed entries.
+    */
+   size_t push(const ::std::vector< ::std::string > &values)
+   {
+      send_push(values);
+      return receive_ack();
+   }
+   /**
+    * Update priorities and wait for the acknowledgement.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    * @return the number of updated entries.
+    */
+   size_t update(const IndexVec &indices, const ::std::vector< double > &priorities)
+   {
+      send_update(indices, priorities);
+      return receive_ack();
+   }
+   /**
+    * Sample @p n samples into @p batch.
+    * @param n the number of samples to draw.
+    * @param batch the batch to overwrite.
+    */
+   void sample(size_t n, ReplaySampleBatch &batch)
+   {
+      send_sample(n);
+      receive_sample(batch);
+   }
+
+   /**
+    * Getter for the number of requests whose response has not been received yet.
+    * @return the number of pending responses.
+    */
+   [[nodiscard]] size_t pending() const { return m_pending; }
+
+  private:
+   /// the connected socket
+   int m_fd;
+   /// the number of requests awaiting their response
+   size_t m_pending = 0;
+   /// whether a corrupt response has left the stream out of sync
+   bool m_broken = false;
+   /// the reusable buffer for encoding requests
+   ::std::vector< char > m_request;
+
+   void _send_request();
+   ::std::uint64_t _receive_header(ReplayOp expected);
+   void _assert_usable() const;
+   void _skip(::std::uint64_t bytes);
+};
+
+inline ReplayClient::ReplayClient(const ::std::string &socket_path)
+{
+   auto address = ReplayProtocol::make_address(socket_path);
+   m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if(m_fd < 0) {
+      throw ::std::system_error(errno, ::std::generic_category(), "socket");
+   }
+   if(connect(m_fd, reinterpret_cast< sockaddr * >(&address), sizeof(address)) != 0) {
+      auto error = errno;
+      close(m_fd);
+      throw ::std::system_error(error, ::std::generic_category(), "connect " + socket_path);
+   }
+}
+
+inline void ReplayClient::_assert_usable() const
+{
+   if(m_broken) {
+      throw ::std::runtime_error("The replay connection is out of sync after a corrupt response.");
+   }
+}
+
+inline void ReplayClient::_skip(::std::uint64_t bytes)
+{
+   char discarded[4096];
+   while(bytes > 0) {
+      auto chunk = ::std::min< ::std::uint64_t >(bytes, sizeof(discarded));
+      ReplayProtocol::read_all(m_fd, discarded, chunk);
+      bytes -= chunk;
+   }
+}
+
+inline void ReplayClient::_send_request()
+{
+   _assert_usable();
+   ReplayProtocol::write_all(m_fd, m_request.data(), m_request.size());
+   m_pending++;
+}
+
+inline void ReplayClient::send_push(const ::std::vector< ::std::string > &values)
+{
+   ::std::uint64_t n = values.size();
+   ::std::uint64_t total = 0;
+   for(const auto &value : values) {
+      total += value.size();
+   }
+   m_request.clear();
+   ReplayProtocol::append(
+      m_request,
+      ReplayProtocol::make_header(
+         ReplayOp::push, sizeof(n) + (n + 1) * sizeof(::std::uint64_t) + total));
+   ReplayProtocol::append(m_request, n);
+   ::std::uint64_t offset = 0;
+   ReplayProtocol::append(m_request, offset);
+   for(const auto &value : values) {
+      offset += value.size();
+      ReplayProtocol::append(m_request, offset);
+   }
+   for(const auto &value : values) {
+      ReplayProtocol::append(m_request, value.data(), value.size());
+   }
+   _send_request();
+}
+
+inline void ReplayClient::send_update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   if(indices.size() != priorities.size()) {
+      throw ::std::invalid_argument("Index sequence and priority sequence do not match in length.");
+   }
+   ::std::uint64_t n = indices.size();
+   m_request.clear();
+   ReplayProtocol::append(
+      m_request,
+      ReplayProtocol::make_header(
+         ReplayOp::update, sizeof(n) + n * (sizeof(::std::uint64_t) + sizeof(double))));
+   ReplayProtocol::append(m_request, n);
+   for(::std::uint64_t index : indices) {
+      ReplayProtocol::append(m_request, index);
+   }
+   ReplayProtocol::append(m_request, priorities.data(), priorities.size());
+   _send_request();
+}
+
+inline void ReplayClient::send_sample(size_t n)
+{
+   m_request.clear();
+   ReplayProtocol::append(
+      m_request, ReplayProtocol::make_header(ReplayOp::sample, sizeof(::std::uint64_t)));
+   ::std::uint64_t count = n;
+   ReplayProtocol::append(m_request, count);
+   _send_request();
+}
+
+inline ::std::uint64_t ReplayClient::_receive_header(ReplayOp expected)
+{
+   if(m_pending == 0) {
+      throw ::std::logic_error("No pending replay request to receive the response of.");
+   }
+   _assert_usable();
+   ReplayMessageHeader header;
+   ReplayProtocol::read_all(m_fd, &header, sizeof(header));
+   m_pending--;
+   if(header.magic != ReplayProtocol::magic) {
+      m_broken = true;
+      throw ::std::runtime_error("Invalid replay protocol response.");
+   }
+   if(header.op == ReplayOp::error) {
+      ::std::string message(header.payload_bytes, '\0');
+      ReplayProtocol::read_all(m_fd, message.data(), message.size());
+      throw ::std::runtime_error(message);
+   }
+   if(header.op != expected) {
+      // skip the payload, so that the next response is read from its start
+      _skip(header.payload_bytes);
+      throw ::std::runtime_error("Unexpected replay response type for the pending request.");
+   }
+   return header.payload_bytes;
+}
+
+inline size_t ReplayClient::receive_ack()
+{
+   auto payload_bytes = _receive_header(ReplayOp::ack);
+   if(payload_bytes != sizeof(::std::uint64_t)) {
+      _skip(payload_bytes);
+      throw ::std::runtime_error("Inconsistent replay acknowledgement.");
+   }
+   ::std::uint64_t n = 0;
+   ReplayProtocol::read_all(m_fd, &n, sizeof(n));
+   return n;
+}
+
+inline void ReplayClient::receive_sample(ReplaySampleBatch &batch)
+{
+   auto payload_bytes = _receive_header(ReplayOp::batch);
+   constexpr ::std::uint64_t entry_bytes = 2 * sizeof(::std::uint64_t) + sizeof(double);
+   if(payload_bytes < 2 * sizeof(::std::uint64_t)) {
+      _skip(payload_bytes);
+      throw ::std::runtime_error("Inconsistent replay sample response.");
+   }
+   ::std::uint64_t n = 0;
+   ReplayProtocol::read_all(m_fd, &n, sizeof(n));
+   // the count is bounded by the payload before anything is allocated for it
+   auto remaining = payload_bytes - sizeof(n) - sizeof(::std::uint64_t);
+   if(n > remaining / entry_bytes) {
+      _skip(payload_bytes - sizeof(n));
+      throw ::std::runtime_error("Inconsistent replay sample response.");
+   }
+   // resizing keeps the capacity, hence repeated receives into the same batch don't allocate
+   batch.indices.resize(n);
+   batch.weights.resize(n);
+   batch.offsets.resize(n + 1);
+   ReplayProtocol::read_all(m_fd, batch.indices.data(), n * sizeof(::std::uint64_t));
+   ReplayProtocol::read_all(m_fd, batch.weights.data(), n * sizeof(double));
+   ReplayProtocol::read_all(m_fd, batch.offsets.data(), (n + 1) * sizeof(::std::uint64_t));
+   auto data_bytes = remaining - n * entry_bytes;
+   if(batch.offsets.back() != data_bytes
+      or not ::std::is_sorted(batch.offsets.begin(), batch.offsets.end())) {
+      _skip(data_bytes);
+      throw ::std::runtime_error("Inconsistent replay sample response.");
+   }
+   batch.data.resize(data_bytes);
+   ReplayProtocol::read_all(m_fd, batch.data.data(), batch.data.size());
+}
+
+}  // namespace per
+
+#endif  // OS == LINUX || OS == MAC
+
+#endif  // PER_REPLAY_CLIENT_HPP
@@ -0,0 +1,209 @@
+#ifndef PER_REPLAY_PROTOCOL_HPP
+#define PER_REPLAY_PROTOCOL_HPP
+
+#include "per/macro.hpp"
+
+#if OS == LINUX || OS == MAC
+
+   #include <sys/socket.h>
+   #include <sys/un.h>
+   #include <unistd.h>
+
+   #include <cerrno>
+   #include <cstdint>
+   #include <cstring>
+   #include <stdexcept>
+   #include <string>
+   #include <system_error>
+   #include <type_traits>
+   #include <vector>
+
+namespace per {
+
+/**
+ * The operation codes of the replay server protocol.
+ */
+enum class ReplayOp : ::std::uint8_t {
+   /// request: [u64 n][u64 offsets[n + 1]][value bytes]
+   push = 1,
+   /// request: [u64 n][u64 indices[n]][f64 priorities[n]]
+   update = 2,
+   /// request: [u64 n]
+   sample = 3,
+   /// response to push and update: [u64 n]
+   ack = 4,
+   /// response to sample: [u64 n][u64 indices[n]][f64 weights[n]][u64 offsets[n + 1]][value bytes]
+   batch = 5,
+   /// response to any failed request: [message bytes]
+   error = 6,
+};
+
+/**
+ * The fixed-size header preceding every message of the replay server protocol.
+ *
+ * Server and client always run on the same host, hence all integers and floats are transmitted in
+ * native byte order. Responses are sent in the order of the requests, which allows clients to
+ * pipeline several requests before reading any response.
+ */
+struct ReplayMessageHeader {
+   ::std::uint32_t magic;
+   ReplayOp op;
+   ::std::uint8_t reserved[3];
+   ::std::uint64_t payload_bytes;
+};
+static_assert(sizeof(ReplayMessageHeader) == 16, "Unexpected padding in the message header.");
+
+/**
+ * Helpers shared by the replay server and client to encode, decode and transmit messages.
+ */
+struct ReplayProtocol {
+   /// the value identifying messages of this protocol
+   static constexpr ::std::uint32_t magic = 0x52455052;  // "PERR"
+   /// the maximum payload size of any message, guarding against garbage headers
+   static constexpr ::std::uint64_t max_payload_bytes = ::std::uint64_t(1) << 32u;
+
+   static ReplayMessageHeader make_header(ReplayOp op, ::std::uint64_t payload_bytes)
+   {
+      return ReplayMessageHeader{magic, op, {0, 0, 0}, payload_bytes};
+   }
+
+   /**
+    * Append the bytes of trivially copyable objects to a byte buffer.
+    * @param out the buffer to append to.
+    * @param data the first object.
+    * @param n the number of objects.
+    */
+   template < typename T >
+   static void append(::std::vector< char > &out, const T *data, size_t n)
+   {
+      static_assert(::std::is_trivially_copyable_v< T >);
+      const auto *bytes = reinterpret_cast< const char * >(data);
+      out.insert(out.end(), bytes, bytes + n * sizeof(T));
+   }
+   template < typename T >
+   static void append(::std::vector< char > &out, const T &value)
+   {
+      append(out, &value, 1);
+   }
+
+   /**
+    * Sequential reader of a received payload.
+    */
+   class Reader {
+     public:
+      Reader(const char *begin, const char *end) : m_pos(begin), m_end(end) {}
+
+      /**
+       * Read a trivially copyable object.
+       * @throw ::std::invalid_argument if the payload is exhausted.
+       */
+      template < typename T >
+      T read()
+      {
+         T value;
+         ::std::memcpy(&value, take(sizeof(T)), sizeof(T));
+         return value;
+      }
+      /**
+       * Consume the next @p n bytes.
+       * @return a pointer to the first consumed byte.
+       * @throw ::std::invalid_argument if the payload is exhausted.
+       */
+      const char *take(::std::uint64_t n)
+      {
+         if(n > static_cast< ::std::uint64_t >(m_end - m_pos)) {
+            throw ::std::invalid_argument("Truncated replay protocol payload.");
+         }
+         const char *pos = m_pos;
+         m_pos += n;
+         return pos;
+      }
+
+     private:
+      const char *m_pos;
+      const char *m_end;
+   };
+
+   /**
+    * Write all bytes to a blocking socket.
+    * @throw ::std::system_error on failure.
+    */
+   static void write_all(int fd, const void *data, size_t size)
+   {
+      const auto *bytes = static_cast< const char * >(data);
+      while(size > 0) {
+         auto written = ::send(fd, bytes, size, send_flags);
+         if(written < 0) {
+            if(errno == EINTR) {
+               continue;
+            }
+            throw ::std::system_error(errno, ::std::generic_category(), "send");
+         }
+         bytes += written;
+         size -= static_cast< size_t >(written);
+      }
+   }
+
+   /**
+    * Read exactly @p size bytes from a blocking socket into @p data.
+    * @throw ::std::system_error on failure, ::std::runtime_error if the peer closed the connection.
+    */
+   static void read_all(int fd, void *data, size_t size)
+   {
+      auto *bytes = static_cast< char * >(data);
+      while(size > 0) {
+         auto received = ::recv(fd, bytes, size, 0);
+         if(received < 0) {
+            if(errno == EINTR) {
+               continue;
+            }
+            throw ::std::system_error(errno, ::std::generic_category(), "recv");
+         }
+         if(received == 0) {
+            throw ::std::runtime_error("Replay connection closed by peer.");
+         }
+         bytes += received;
+         size -= static_cast< size_t >(received);
+      }
+   }
+
+   /**
+    * Check whether a failed non-blocking socket operation merely has to be retried later.
+    */
+   static bool would_block(int error)
+   {
+   #if EAGAIN == EWOULDBLOCK
+      return error == EAGAIN;
+   #else
+      return error == EAGAIN or error == EWOULDBLOCK;
+   #endif
+   }
+
+   /**
+    * Build the socket address of a Unix domain socket path.
+    * @throw ::std::invalid_argument if the path is too long.
+    */
+   static sockaddr_un make_address(const ::std::string &path)
+   {
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      if(path.size() >= sizeof(address.sun_path)) {
+         throw ::std::invalid_argument("Socket path '" + path + "' is too long.");
+      }
+      ::std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+      return address;
+   }
+
+   #if defined(MSG_NOSIGNAL)
+   /// avoid SIGPIPE when writing to a connection the peer already closed
+   static constexpr int send_flags = MSG_NOSIGNAL;
+   #else
+   static constexpr int send_flags = 0;
+   #endif
+};
+
+}  // namespace per
+
+#endif  // OS == LINUX || OS == MAC
+
+#endif  // PER_REPLAY_PROTOCOL_HPP
@@ -0,0 +1,423 @@
+#ifndef PER_REPLAY_SERVER_HPP
+#define PER_REPLAY_SERVER_HPP
+
+#include "per/macro.hpp"
+
+#if OS == LINUX || OS == MAC
+
+   #include <fcntl.h>
+   #include <poll.h>
+   #include <sys/socket.h>
+   #include <sys/un.h>
+   #include <unistd.h>
+
+   #include <algorithm>
+   #include <atomic>
+   #include <cerrno>
+   #include <cstdint>
+   #include <cstring>
+   #include <random>
+   #include <string>
+   #include <system_error>
+   #include <vector>
+
+   #include "per/experience_replay.hpp"
+   #include "per/replay_protocol.hpp"
+
+namespace per {
+
+/**
+ * Standalone owner of a `PrioritizedExperience` buffer serving clients over a Unix domain socket.
+ *
+ * The server multiplexes all client connections on a single thread, so requests are applied to
+ * the buffer one at a time without further locking. Each connection may pipeline an arbitrary
+ * number of requests; their responses are sent back in request order. Values are opaque byte
+ * strings. See `ReplayOp` for the message layouts.
+ */
+class PER_API ReplayServer {
+  public:
+   using BufferType = PrioritizedExperience< ::std::string >;
+
+   /**
+    * The constructor. Binds and listens on the socket path.
+    *
+    * @param socket_path the file system path of the Unix domain socket. Must not exist yet.
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$.
+    * @param beta the 'temperature' parameter for the weights.
+    * @param seed the random seed for sampling.
+    * @throw ::std::system_error if the socket cannot be set up.
+    */
+   ReplayServer(
+      ::std::string socket_path,
+      size_t capacity,
+      double alpha = 1.,
+      double beta = 1.,
+      BufferType::seed_type seed = ::std::random_device{}());
+
+   ReplayServer(const ReplayServer &) = delete;
+   ReplayServer &operator=(const ReplayServer &) = delete;
+
+   /**
+    * The destructor. Closes all connections and removes the socket path.
+    */
+   ~ReplayServer();
+
+   /**
+    * Serve requests until `stop` is called.
+    */
+   void serve();
+   /**
+    * Make `serve` return. May be called from any thread and from signal handlers.
+    */
+   void stop();
+
+   /**
+    * Getter for the socket path.
+    * @return the path.
+    */
+   [[nodiscard]] const ::std::string &socket_path() const { return m_socket_path; }
+   /**
+    * Getter for the served buffer. Must not be modified while `serve` is running.
+    * @return the buffer.
+    */
+   [[nodiscard]] BufferType &buffer() { return m_buffer; }
+
+  private:
+   /// the state of a client connection
+   struct Connection {
+      int fd;
+      /// received bytes not yet processed
+      ::std::vector< char > input;
+      /// encoded responses not yet sent
+      ::std::vector< char > output;
+      /// the number of output bytes already sent
+      size_t output_sent = 0;
+      /// the peer shut down its sending side. The connection closes once the responses to the
+      /// received requests are sent.
+      bool eof = false;
+      bool closed = false;
+   };
+
+   /// the size of a single read from a connection
+   static constexpr size_t read_chunk = 1u << 16u;
+
+   /// the socket path
+   ::std::string m_socket_path;
+   /// the served buffer
+   BufferType m_buffer;
+   /// the listening socket
+   int m_listen_fd = -1;
+   /// the self-pipe to wake up the poll loop on `stop`
+   int m_wake_fds[2] = {-1, -1};
+   /// the stop flag
+   ::std::atomic< bool > m_stop = false;
+   /// the open client connections
+   ::std::vector< Connection > m_connections;
+
+   void _accept();
+   void _receive(Connection &connection);
+   void _send(Connection &connection);
+   void _process(Connection &connection);
+   void _handle(ReplayOp op, const char *payload, size_t size, ::std::vector< char > &out);
+   static void _set_nonblocking(int fd);
+};
+
+inline void ReplayServer::_set_nonblocking(int fd)
+{
+   int flags = fcntl(fd, F_GETFL, 0);
+   if(flags < 0 or fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+      throw ::std::system_error(errno, ::std::generic_category(), "fcntl");
+   }
+}
+
+inline ReplayServer::ReplayServer(
+   ::std::string socket_path,
+   size_t capacity,
+   double alpha,
+   double beta,
+   BufferType::seed_type seed)
+    : m_socket_path(::std::move(socket_path)), m_buffer(capacity, alpha, beta, seed)
+{
+   auto address = ReplayProtocol::make_address(m_socket_path);
+   if(pipe(m_wake_fds) != 0) {
+      throw ::std::system_error(errno, ::std::generic_category(), "pipe");
+   }
+   m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if(m_listen_fd < 0
+      or bind(m_listen_fd, reinterpret_cast< sockaddr * >(&address), sizeof(address)) != 0
+      or listen(m_listen_fd, SOMAXCONN) != 0) {
+      auto error = errno;
+      for(int fd : {m_listen_fd, m_wake_fds[0], m_wake_fds[1]}) {
+         if(fd >= 0) {
+            close(fd);
+         }
+      }
+      throw ::std::system_error(error, ::std::generic_category(), "bind " + m_socket_path);
+   }
+   _set_nonblocking(m_listen_fd);
+   _set_nonblocking(m_wake_fds[0]);
+}
+
+inline ReplayServer::~ReplayServer()
+{
+   for(auto &connection : m_connections) {
+      close(connection.fd);
+   }
+   close(m_listen_fd);
+   close(m_wake_fds[0]);
+   close(m_wake_fds[1]);
+   ::unlink(m_socket_path.c_str());
+}
+
+inline void ReplayServer::stop()
+{
+   m_stop = true;
+   char byte = 0;
+   // a full pipe already guarantees a wake up, hence the result can be ignored
+   [[maybe_unused]] auto written = write(m_wake_fds[1], &byte, 1);
+}
+
+inline void ReplayServer::serve()
+{
+   ::std::vector< pollfd > fds;
+   while(not m_stop) {
+      fds.clear();
+      fds.push_back({m_wake_fds[0], POLLIN, 0});
+      fds.push_back({m_listen_fd, POLLIN, 0});
+      for(const auto &connection : m_connections) {
+         short events = connection.eof ? 0 : POLLIN;
+         if(connection.output_sent < connection.output.size()) {
+            events |= POLLOUT;
+         }
+         fds.push_back({connection.fd, events, 0});
+      }
+      if(poll(fds.data(), fds.size(), -1) < 0) {
+         if(errno == EINTR) {
+            continue;
+         }
+         throw ::std::system_error(errno, ::std::generic_category(), "poll");
+      }
+      if(fds[0].revents & POLLIN) {
+         char drain[64];
+         while(read(m_wake_fds[0], drain, sizeof(drain)) > 0) {
+         }
+      }
+      // the connections have to be handled before accepting new ones, since accepting may
+      // reallocate the connection vector the poll results refer to by position.
+      for(size_t i = 0; i < m_connections.size(); i++) {
+         auto &connection = m_connections[i];
+         auto revents = fds[i + 2].revents;
+         if(not connection.eof and (revents & (POLLIN | POLLHUP | POLLERR))) {
+            _receive(connection);
+         }
+         if(not connection.closed) {
+            _send(connection);
+         }
+         if(connection.eof and connection.output.empty()) {
+            connection.closed = true;
+         }
+      }
+      if(fds[1].revents & POLLIN) {
+         _accept();
+      }
+      m_connections.erase(
+         ::std::remove_if(
+            m_connections.begin(),
+            m_connections.end(),
+            [](const Connection &connection) {
+               if(connection.closed) {
+                  close(connection.fd);
+               }
+               return connection.closed;
+            }),
+         m_connections.end());
+   }
+}
+
+inline void ReplayServer::_accept()
+{
+   while(true) {
+      int fd = accept(m_listen_fd, nullptr, nullptr);
+      if(fd < 0) {
+         if(errno == EINTR) {
+            continue;
+         }
+         // EAGAIN once all pending connections are accepted, other errors only affect the peer
+         return;
+      }
+      _set_nonblocking(fd);
+      m_connections.push_back(Connection{fd, {}, {}});
+   }
+}
+
+inline void ReplayServer::_receive(Connection &connection)
+{
+   while(true) {
+      auto offset = connection.input.size();
+      connection.input.resize(offset + read_chunk);
+      auto received = recv(connection.fd, connection.input.data() + offset, read_chunk, 0);
+      connection.input.resize(offset + static_cast< size_t >(::std::max(received, ssize_t(0))));
+      if(received > 0) {
+         continue;
+      }
+      if(received < 0 and errno == EINTR) {
+         continue;
+      }
+      if(received == 0) {
+         // the requests received before the shutdown are still answered
+         connection.eof = true;
+         break;
+      }
+      if(not ReplayProtocol::would_block(errno)) {
+         connection.closed = true;
+         return;
+      }
+      break;
+   }
+   _process(connection);
+}
+
+inline void ReplayServer::_process(Connection &connection)
+{
+   size_t consumed = 0;
+   auto &input = connection.input;
+   while(input.size() - consumed >= sizeof(ReplayMessageHeader)) {
+      ReplayMessageHeader header;
+      ::std::memcpy(&header, input.data() + consumed, sizeof(header));
+      if(header.magic != ReplayProtocol::magic
+         or header.payload_bytes > ReplayProtocol::max_payload_bytes) {
+         // the stream cannot be resynchronized after a protocol violation
+         connection.closed = true;
+         return;
+      }
+      if(input.size() - consumed - sizeof(header) < header.payload_bytes) {
+         break;
+      }
+      const char *payload = input.data() + consumed + sizeof(header);
+      auto output_size = connection.output.size();
+      try {
+         _handle(header.op, payload, header.payload_bytes, connection.output);
+      } catch(const ::std::exception &error) {
+         // discard any partially encoded response
+         connection.output.resize(output_size);
+         ::std::string message = error.what();
+         ReplayProtocol::append(
+            connection.output, ReplayProtocol::make_header(ReplayOp::error, message.size()));
+         ReplayProtocol::append(connection.output, message.data(), message.size());
+      }
+      consumed += sizeof(header) + header.payload_bytes;
+   }
+   input.erase(input.begin(), input.begin() + static_cast< ::std::ptrdiff_t >(consumed));
+}
+
+inline void ReplayServer::_send(Connection &connection)
+{
+   auto &output = connection.output;
+   while(connection.output_sent < output.size()) {
+      auto written = ::send(
+         connection.fd,
+         output.data() + connection.output_sent,
+         output.size() - connection.output_sent,
+         ReplayProtocol::send_flags);
+      if(written < 0) {
+         if(errno == EINTR) {
+            continue;
+         }
+         if(not ReplayProtocol::would_block(errno)) {
+            connection.closed = true;
+         }
+         return;
+      }
+      connection.output_sent += static_cast< size_t >(written);
+   }
+   output.clear();
+   connection.output_sent = 0;
+}
+
+inline void ReplayServer::_handle(
+   ReplayOp op,
+   const char *payload,
+   size_t size,
+   ::std::vector< char > &out)
+{
+   ReplayProtocol::Reader reader(payload, payload + size);
+   auto n = reader.read< ::std::uint64_t >();
+   if(op != ReplayOp::sample and n > size) {
+      // every pushed or updated entry occupies at least one byte of the payload
+      throw ::std::invalid_argument("Entry count exceeds the request payload.");
+   }
+   switch(op) {
+      case ReplayOp::push: {
+         const auto *offsets = reader.take((n + 1) * sizeof(::std::uint64_t));
+         ::std::vector< ::std::uint64_t > bounds(n + 1);
+         ::std::memcpy(bounds.data(), offsets, bounds.size() * sizeof(::std::uint64_t));
+         const char *data = reader.take(bounds[n]);
+         for(size_t i = 0; i < n; i++) {
+            if(bounds[i] > bounds[i + 1]) {
+               throw ::std::invalid_argument("Decreasing value offsets in push request.");
+            }
+         }
+         ::std::vector< ::std::string > values;
+         values.reserve(n);
+         for(size_t i = 0; i < n; i++) {
+            values.emplace_back(data + bounds[i], data + bounds[i + 1]);
+         }
+         m_buffer.push(::std::move(values));
+         ReplayProtocol::append(out, ReplayProtocol::make_header(ReplayOp::ack, sizeof(n)));
+         ReplayProtocol::append(out, n);
+         break;
+      }
+      case ReplayOp::update: {
+         const auto *index_bytes = reader.take(n * sizeof(::std::uint64_t));
+         const auto *priority_bytes = reader.take(n * sizeof(double));
+         ::std::vector< ::std::uint64_t > indices(n);
+         ::std::vector< double > priorities(n);
+         ::std::memcpy(indices.data(), index_bytes, n * sizeof(::std::uint64_t));
+         ::std::memcpy(priorities.data(), priority_bytes, n * sizeof(double));
+         m_buffer.update({indices.begin(), indices.end()}, priorities);
+         ReplayProtocol::append(out, ReplayProtocol::make_header(ReplayOp::ack, sizeof(n)));
+         ReplayProtocol::append(out, n);
+         break;
+      }
+      case ReplayOp::sample: {
+         // the fixed-size arrays are reserved upfront and the value bytes are appended directly
+         // behind them while the buffer is visited, avoiding any intermediate copies.
+         ::std::uint64_t count = ::std::min< ::std::uint64_t >(n, m_buffer.size());
+         auto header_pos = out.size();
+         ReplayProtocol::append(out, ReplayProtocol::make_header(ReplayOp::batch, 0));
+         auto payload_pos = out.size();
+         ReplayProtocol::append(out, count);
+         auto indices_pos = out.size();
+         auto weights_pos = indices_pos + count * sizeof(::std::uint64_t);
+         auto offsets_pos = weights_pos + count * sizeof(double);
+         out.resize(offsets_pos + (count + 1) * sizeof(::std::uint64_t));
+         auto put = [&out](size_t pos, const auto &value) {
+            ::std::memcpy(out.data() + pos, &value, sizeof(value));
+         };
+         ::std::uint64_t offset = 0;
+         put(offsets_pos, offset);
+         size_t slot = 0;
+         m_buffer.sample_each(
+            count, [&](size_t index, const ::std::string &value, double weight) {
+               ::std::uint64_t leaf = index;
+               offset += value.size();
+               put(indices_pos + slot * sizeof(::std::uint64_t), leaf);
+               put(weights_pos + slot * sizeof(double), weight);
+               put(offsets_pos + (slot + 1) * sizeof(::std::uint64_t), offset);
+               out.insert(out.end(), value.begin(), value.end());
+               slot++;
+            });
+         auto header = ReplayProtocol::make_header(ReplayOp::batch, out.size() - payload_pos);
+         ::std::memcpy(out.data() + header_pos, &header, sizeof(header));
+         break;
+      }
+      default: throw ::std::invalid_argument("Unknown replay request.");
+   }
+}
+
+}  // namespace per
+
+#endif  // OS == LINUX || OS == MAC
+
+#endif  // PER_REPLAY_SERVER_HPP
@@ -0,0 +1,542 @@
+#ifndef PER_SHARED_EXPERIENCE_HPP
+#define PER_SHARED_EXPERIENCE_HPP
+
+#include "per/macro.hpp"
+
+#if OS == LINUX || OS == MAC
+
+   #include <fcntl.h>
+   #include <pthread.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+
+   #include <algorithm>
+   #include <cerrno>
+   #include <cmath>
+   #include <cstdint>
+   #include <cstring>
+   #include <limits>
+   #include <random>
+   #include <stdexcept>
+   #include <string>
+   #include <string_view>
+   #include <system_error>
+   #include <tuple>
+   #include <vector>
+
+   #include "per/philox.hpp"
+   #include "per/sum_tree.hpp"
+
+namespace per {
+
+/**
+ * Prioritized Experience Replay buffer living in a named POSIX shared-memory segment.
+ *
+ * The sum tree, the ring cursor, the weights and fixed-size value slots are all placed in the
+ * segment, so that several processes can push into and sample from the same buffer without
+ * serializing the entries to each other. Values are raw byte sequences of at most `slot_size`
+ * bytes. All operations are synchronized through a process-shared mutex within the segment.
+ *
+ * On Linux the mutex is robust: if a process dies while holding it, the next process to lock it
+ * restores the leaves a dying sampler had masked, recomputes the maximum priority and rebuilds the
+ * inner tree nodes from the leaf priorities before continuing. macOS does not support
+ * robust mutexes, hence there a process dying while holding the mutex blocks all other attached
+ * processes on their next operation.
+ *
+ * Sampling follows the same procedure and random stream as `PrioritizedExperience`, i.e. with equal
+ * seed and operations both buffers draw the same entries.
+ *
+ * One process creates the segment (the owner), any other process attaches to it by name. The
+ * owner removes the name again on destruction, the memory itself is released once every process
+ * has detached.
+ */
+class PER_API SharedPrioritizedExperience {
+  public:
+   using value_type = ::std::string;
+   using ValueVec = ::std::vector< value_type >;
+   using WeightVec = ::std::vector< double >;
+   using IndexVec = ::std::vector< size_t >;
+   using seed_type = CounterRng::seed_type;
+
+   /**
+    * Create a new shared buffer.
+    *
+    * @param name the name of the shared-memory segment. A leading '/' is added if missing.
+    * @param capacity the maximum numbers of samples to be held at any point in time.
+    * @param slot_size the maximum number of bytes per sample.
+    * @param alpha the degree of uniformity in the distribution \f$ p_i^\alpha \f$.
+    * @param beta the 'temperature' parameter for the weights.
+    * @param seed the random seed for sampling.
+    * @throw ::std::system_error if the segment cannot be created (e.g. the name is taken).
+    */
+   SharedPrioritizedExperience(
+      ::std::string name,
+      size_t capacity,
+      size_t slot_size,
+      double alpha = 1.,
+      double beta = 1.,
+      seed_type seed = ::std::random_device{}());
+   /**
+    * Attach to an existing shared buffer.
+    *
+    * @param name the name of the shared-memory segment.
+    * @throw ::std::system_error if the segment cannot be opened.
+    * @throw ::std::runtime_error if the segment does not hold an initialized buffer.
+    */
+   explicit SharedPrioritizedExperience(::std::string name);
+
+   SharedPrioritizedExperience(const SharedPrioritizedExperience &) = delete;
+   SharedPrioritizedExperience &operator=(const SharedPrioritizedExperience &) = delete;
+
+   ~SharedPrioritizedExperience();
+
+   /**
+    * Add a sample to the buffer.
+    * @param value the bytes of the sample to add.
+    * @throw ::std::invalid_argument if the value exceeds the slot size.
+    */
+   void push(::std::string_view value);
+   /**
+    * Add a collection of samples to the buffer under a single lock.
+    * @param values the vector of samples to add.
+    * @throw ::std::invalid_argument if any value exceeds the slot size. No value is added then.
+    */
+   void push(const ValueVec &values);
+   /**
+    * Update the given sample indices with new priorities.
+    * @param indices the vector of indices to address.
+    * @param priorities the vector of priorities to emplace.
+    */
+   void update(const IndexVec &indices, const ::std::vector< double > &priorities);
+   /**
+    * Sample @p n samples from the buffer according to the PER method.
+    * @param n the number of samples to draw.
+    * @return a tuple of 3 vectors holding the values, weights, and indices respectively.
+    */
+   ::std::tuple< ValueVec, WeightVec, IndexVec > sample(size_t n);
+
+   /**
+    * Remove the segment's name, so that no further process can attach to it.
+    */
+   void unlink();
+
+   [[nodiscard]] double alpha() const { return m_header->alpha; }
+   [[nodiscard]] double beta() const { return m_header->beta; }
+   [[nodiscard]] size_t capacity() const { return m_header->capacity; }
+   [[nodiscard]] size_t slot_size() const { return m_header->slot_size; }
+   [[nodiscard]] const ::std::string &name() const { return m_name; }
+   /**
+    * Whether this handle created the segment.
+    * @return the ownership flag.
+    */
+   [[nodiscard]] bool owner() const { return m_owner; }
+   /**
+    * Getter for the number of currently held samples.
+    * @return the size.
+    */
+   [[nodiscard]] size_t size() const;
+
+  private:
+   /// the bookkeeping data at the start of the segment
+   struct Header {
+      ::std::uint64_t magic;
+      ::std::uint64_t capacity;
+      ::std::uint64_t slot_size;
+      ::std::uint64_t first_leaf;
+      ::std::uint64_t tree_size;
+      ::std::uint64_t size;
+      ::std::uint64_t leaf_pos;
+      double alpha;
+      double beta;
+      double max_priority;
+      /// the number of leaves currently masked by a sampler (see `Masked`)
+      ::std::uint64_t n_masked;
+      ::std::uint64_t rng_seed;
+      ::std::uint64_t rng_counter;
+      pthread_mutex_t mutex;
+   };
+
+   /// a leaf masked while sampling, recorded in the segment to restore it if the sampler dies
+   struct Masked {
+      ::std::uint64_t index;
+      double priority;
+   };
+
+   /// RAII lock of the segment's mutex which repairs the tree after a previous owner died
+   class Lock {
+     public:
+      explicit Lock(const SharedPrioritizedExperience &buffer);
+      Lock(const Lock &) = delete;
+      Lock &operator=(const Lock &) = delete;
+      ~Lock() { pthread_mutex_unlock(&m_header->mutex); }
+
+     private:
+      Header *m_header;
+   };
+
+   /// the value identifying an initialized segment
+   static constexpr ::std::uint64_t magic = 0x5045525348415245;  // "PERSHARE"
+   /// the alignment of every region within the segment
+   static constexpr size_t alignment = 64;
+
+   /// the name of the segment
+   ::std::string m_name;
+   /// whether this handle created the segment
+   bool m_owner;
+   /// the mapped segment
+   void *m_memory = MAP_FAILED;
+   /// the size of the mapped segment in bytes
+   size_t m_bytes = 0;
+   /// views into the segment
+   Header *m_header = nullptr;
+   double *m_tree = nullptr;
+   double *m_weights = nullptr;
+   Masked *m_masked = nullptr;
+   ::std::uint32_t *m_lengths = nullptr;
+   char *m_slots = nullptr;
+
+   static size_t _align(size_t offset) { return (offset + alignment - 1) / alignment * alignment; }
+   static ::std::string _normalize(::std::string name);
+   static size_t _segment_bytes(size_t tree_size, size_t capacity, size_t slot_size);
+
+   void _map(int fd, size_t bytes);
+   void _assign_views();
+   void _push(::std::string_view value);
+   void _set_priority(size_t index, double priority);
+   void _set_masked(size_t n_masked);
+   void _recompute_max_priority();
+   [[nodiscard]] size_t _find(double target) const;
+   void _rebuild();
+};
+
+inline ::std::string SharedPrioritizedExperience::_normalize(::std::string name)
+{
+   if(name.empty() or name.front() != '/') {
+      name.insert(name.begin(), '/');
+   }
+   return name;
+}
+
+inline size_t SharedPrioritizedExperience::_segment_bytes(
+   size_t tree_size,
+   size_t capacity,
+   size_t slot_size)
+{
+   return _align(sizeof(Header)) + _align(tree_size * sizeof(double))
+          + _align(capacity * sizeof(double)) + _align(capacity * sizeof(Masked))
+          + _align(capacity * sizeof(::std::uint32_t))
+          + _align(capacity * slot_size);
+}
+
+inline SharedPrioritizedExperience::SharedPrioritizedExperience(
+   ::std::string name,
+   size_t capacity,
+   size_t slot_size,
+   double alpha,
+   double beta,
+   seed_type seed)
+    : m_name(_normalize(::std::move(name))), m_owner(true)
+{
+   if(capacity == 0 or slot_size > ::std::numeric_limits< ::std::uint32_t >::max()) {
+      throw ::std::invalid_argument("Invalid capacity or slot size for a shared buffer.");
+   }
+   // the same tree layout as in the SumTree
+   auto leaf_level = SumTree< value_type >::leaf_level_of(capacity);
+   auto tree_size = (size_t(1) << leaf_level) - 1;
+
+   int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+   if(fd < 0) {
+      throw ::std::system_error(errno, ::std::generic_category(), "shm_open " + m_name);
+   }
+   auto bytes = _segment_bytes(tree_size, capacity, slot_size);
+   if(ftruncate(fd, static_cast< off_t >(bytes)) != 0) {
+      auto error = errno;
+      close(fd);
+      shm_unlink(m_name.c_str());
+      throw ::std::system_error(error, ::std::generic_category(), "ftruncate " + m_name);
+   }
+   try {
+      _map(fd, bytes);
+   } catch(...) {
+      shm_unlink(m_name.c_str());
+      throw;
+   }
+   // the freshly truncated segment is zero-filled, hence only non-zero fields need setting
+   m_header->capacity = capacity;
+   m_header->slot_size = slot_size;
+   m_header->first_leaf = (size_t(1) << (leaf_level - 1)) - 1;
+   m_header->tree_size = tree_size;
+   m_header->alpha = alpha;
+   m_header->beta = beta;
+   m_header->max_priority = 1.;
+   m_header->rng_seed = seed;
+
+   pthread_mutexattr_t attributes;
+   pthread_mutexattr_init(&attributes);
+   pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+   #if OS == LINUX
+   // macOS lacks robust mutexes (see the class documentation)
+   pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+   #endif
+   pthread_mutex_init(&m_header->mutex, &attributes);
+   pthread_mutexattr_destroy(&attributes);
+
+   _assign_views();
+   // publish the initialized segment to attaching processes last
+   __atomic_store_n(&m_header->magic, magic, __ATOMIC_RELEASE);
+}
+
+inline SharedPrioritizedExperience::SharedPrioritizedExperience(::std::string name)
+    : m_name(_normalize(::std::move(name))), m_owner(false)
+{
+   int fd = shm_open(m_name.c_str(), O_RDWR, 0600);
+   if(fd < 0) {
+      throw ::std::system_error(errno, ::std::generic_category(), "shm_open " + m_name);
+   }
+   struct stat status {};
+   if(fstat(fd, &status) != 0 or static_cast< size_t >(status.st_size) < sizeof(Header)) {
+      close(fd);
+      throw ::std::runtime_error("Shared segment '" + m_name + "' holds no replay buffer.");
+   }
+   _map(fd, static_cast< size_t >(status.st_size));
+   if(__atomic_load_n(&m_header->magic, __ATOMIC_ACQUIRE) != magic
+      or _segment_bytes(m_header->tree_size, m_header->capacity, m_header->slot_size) > m_bytes) {
+      munmap(m_memory, m_bytes);
+      throw ::std::runtime_error("Shared segment '" + m_name + "' holds no replay buffer.");
+   }
+   _assign_views();
+}
+
+inline SharedPrioritizedExperience::~SharedPrioritizedExperience()
+{
+   if(m_owner) {
+      unlink();
+   }
+   if(m_memory != MAP_FAILED) {
+      munmap(m_memory, m_bytes);
+   }
+}
+
+inline void SharedPrioritizedExperience::unlink()
+{
+   shm_unlink(m_name.c_str());
+   m_owner = false;
+}
+
+inline void SharedPrioritizedExperience::_map(int fd, size_t bytes)
+{
+   m_memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   auto error = errno;
+   close(fd);
+   if(m_memory == MAP_FAILED) {
+      throw ::std::system_error(error, ::std::generic_category(), "mmap " + m_name);
+   }
+   m_bytes = bytes;
+   m_header = static_cast< Header * >(m_memory);
+}
+
+inline void SharedPrioritizedExperience::_assign_views()
+{
+   auto *base = static_cast< char * >(m_memory);
+   size_t offset = _align(sizeof(Header));
+   m_tree = reinterpret_cast< double * >(base + offset);
+   offset += _align(m_header->tree_size * sizeof(double));
+   m_weights = reinterpret_cast< double * >(base + offset);
+   offset += _align(m_header->capacity * sizeof(double));
+   m_masked = reinterpret_cast< Masked * >(base + offset);
+   offset += _align(m_header->capacity * sizeof(Masked));
+   m_lengths = reinterpret_cast< ::std::uint32_t * >(base + offset);
+   offset += _align(m_header->capacity * sizeof(::std::uint32_t));
+   m_slots = base + offset;
+}
+
+inline SharedPrioritizedExperience::Lock::Lock(const SharedPrioritizedExperience &buffer)
+    : m_header(buffer.m_header)
+{
+   int result = pthread_mutex_lock(&m_header->mutex);
+   #if OS == LINUX
+   if(result == EOWNERDEAD) {
+      // the previous holder died mid-operation, the leaves might be masked and the inner nodes
+      // inconsistent
+      const_cast< SharedPrioritizedExperience & >(buffer)._rebuild();
+      pthread_mutex_consistent(&m_header->mutex);
+      result = 0;
+   }
+   #endif
+   if(result != 0) {
+      throw ::std::system_error(result, ::std::generic_category(), "pthread_mutex_lock");
+   }
+}
+
+inline size_t SharedPrioritizedExperience::size() const
+{
+   Lock lock(*this);
+   return m_header->size;
+}
+
+inline void SharedPrioritizedExperience::_push(::std::string_view value)
+{
+   auto &header = *m_header;
+   auto pos = header.leaf_pos;
+   double evicted_priority = pos < header.size ? m_tree[header.first_leaf + pos] : 0.;
+   header.size = ::std::min(header.size + 1, header.capacity);
+   // the weight follows the computation of PrioritizedExperience::push
+   m_weights[pos] = ::std::pow(
+      header.max_priority / m_tree[0] * static_cast< double >(header.capacity), header.beta);
+   m_lengths[pos] = static_cast< ::std::uint32_t >(value.size());
+   ::std::memcpy(m_slots + pos * header.slot_size, value.data(), value.size());
+   _set_priority(pos, header.max_priority);
+   header.leaf_pos = (pos + 1) % header.capacity;
+   // as in PrioritizedExperience, evicting the holder of the maximum recomputes it
+   if(::std::abs(evicted_priority - header.max_priority) < 1e-16) {
+      _recompute_max_priority();
+   }
+}
+
+inline void SharedPrioritizedExperience::push(::std::string_view value)
+{
+   if(value.size() > m_header->slot_size) {
+      throw ::std::invalid_argument(
+         "Value of " + ::std::to_string(value.size()) + " bytes exceeds the slot size of "
+         + ::std::to_string(m_header->slot_size) + " bytes.");
+   }
+   Lock lock(*this);
+   _push(value);
+}
+
+inline void SharedPrioritizedExperience::push(const ValueVec &values)
+{
+   for(const auto &value : values) {
+      if(value.size() > m_header->slot_size) {
+         throw ::std::invalid_argument(
+            "Value of " + ::std::to_string(value.size()) + " bytes exceeds the slot size of "
+            + ::std::to_string(m_header->slot_size) + " bytes.");
+      }
+   }
+   Lock lock(*this);
+   for(const auto &value : values) {
+      _push(value);
+   }
+}
+
+inline void SharedPrioritizedExperience::update(
+   const IndexVec &indices,
+   const ::std::vector< double > &priorities)
+{
+   if(indices.size() != priorities.size()) {
+      throw ::std::invalid_argument("Index sequence and priority sequence do not match in length.");
+   }
+   Lock lock(*this);
+   for(size_t i = 0; i < indices.size(); i++) {
+      if(indices[i] >= m_header->size) {
+         throw ::std::out_of_range("Index '" + ::std::to_string(indices[i]) + "' out of bounds.");
+      }
+      _set_priority(indices[i], ::std::pow(::std::abs(priorities[i]), m_header->alpha));
+   }
+}
+
+inline auto SharedPrioritizedExperience::sample(size_t n)
+   -> ::std::tuple< ValueVec, WeightVec, IndexVec >
+{
+   ValueVec values;
+   WeightVec weights;
+   IndexVec indices;
+   ::std::vector< double > priorities;
+
+   Lock lock(*this);
+   auto n_samples = ::std::min< size_t >(n, m_header->size);
+   values.reserve(n_samples);
+   weights.reserve(n_samples);
+   indices.reserve(n_samples);
+   priorities.reserve(n_samples);
+
+   CounterRng rng(m_header->rng_seed, m_header->rng_counter);
+   m_header->rng_counter++;
+
+   for(size_t i = 0; i < n_samples; i++) {
+      auto index = _find(rng.uniform(i));
+      priorities.emplace_back(m_tree[m_header->first_leaf + index]);
+      indices.emplace_back(index);
+      weights.emplace_back(m_weights[index]);
+      values.emplace_back(m_slots + index * m_header->slot_size, m_lengths[index]);
+      // mask the already sampled elements. The masked leaf is recorded first, so that it can be
+      // restored if this process dies before the end of the sampling.
+      m_masked[i] = Masked{index, priorities.back()};
+      _set_masked(i + 1);
+      _set_priority(index, 0.);
+   }
+   // restore the priorities. Once the remaining mass is zero (all entries left have priority 0), a
+   // masked entry may be drawn again. Restoring in reverse hands it back its original priority.
+   for(size_t i = n_samples; i > 0; i--) {
+      _set_priority(indices[i - 1], priorities[i - 1]);
+      _set_masked(i - 1);
+   }
+   return {::std::move(values), ::std::move(weights), ::std::move(indices)};
+}
+
+inline void SharedPrioritizedExperience::_set_priority(size_t index, double priority)
+{
+   index += m_header->first_leaf;
+   double delta = priority - m_tree[index];
+   m_tree[index] = priority;
+   while(index > 0) {
+      index = (index - 1) / 2;
+      m_tree[index] += delta;
+   }
+}
+
+inline void SharedPrioritizedExperience::_set_masked(size_t n_masked)
+{
+   // the count must not be reordered with the writes of the leaves, since a process dying in
+   // between leaves them as they are in memory
+   __atomic_signal_fence(__ATOMIC_SEQ_CST);
+   m_header->n_masked = n_masked;
+   __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+inline void SharedPrioritizedExperience::_recompute_max_priority()
+{
+   auto *leaves = m_tree + m_header->first_leaf;
+   m_header->max_priority = *::std::max_element(leaves, leaves + m_header->size);
+}
+
+inline size_t SharedPrioritizedExperience::_find(double target) const
+{
+   target *= m_tree[0];
+   size_t index = 0;
+   while(index < m_header->first_leaf) {
+      size_t left_idx = 2 * index + 1;
+      // as in SumTree::find, subtrees without any priority mass (e.g. masked or unfilled leaves)
+      // are never entered, even if rounding errors of the inner sums point towards them
+      if(target <= m_tree[left_idx] or m_tree[left_idx + 1] <= 0.) {
+         index = left_idx;
+      } else {
+         target -= m_tree[left_idx];
+         index = left_idx + 1;
+      }
+   }
+   return index - m_header->first_leaf;
+}
+
+inline void SharedPrioritizedExperience::_rebuild()
+{
+   // restoring in reverse hands leaves masked twice back their original priority (see `sample`).
+   // The inner nodes are recomputed below, hence only the leaves are written.
+   for(size_t i = m_header->n_masked; i > 0; i--) {
+      m_tree[m_header->first_leaf + m_masked[i - 1].index] = m_masked[i - 1].priority;
+   }
+   m_header->n_masked = 0;
+   if(m_header->size > 0) {
+      _recompute_max_priority();
+   }
+   for(size_t index = m_header->first_leaf; index > 0; index--) {
+      m_tree[index - 1] = m_tree[2 * index - 1] + m_tree[2 * index];
+   }
+}
+
+}  // namespace per
+
+#endif  // OS == LINUX || OS == MAC
+
+#endif  // PER_SHARED_EXPERIENCE_HPP
@@ -3,16 +3,38 @@
 #define PER_SUM_TREE_HPP
 
 #include <algorithm>
+#include <array>
 #include <cppitertools/itertools.hpp>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <optional>
 #include <sstream>
 
 #include "per/macro.hpp"
+#include "per/philox.hpp"
 #include "per/utils.hpp"
 
 namespace per {
 
+/**
+ * The strategies to choose the element to overwrite once a `SumTree` is at capacity.
+ */
+enum class EvictionPolicy {
+   /// overwrite the oldest element (ring buffer)
+   fifo,
+   /// overwrite the element of lowest priority
+   lowest_priority,
+   /// reservoir sampling: the n-th inserted element is kept with probability capacity / n and
+   /// then overwrites a uniformly chosen element, otherwise it is discarded
+   reservoir,
+};
+
+/**
+ * The capacity template argument of a `SumTree` whose capacity is chosen at runtime.
+ */
+inline constexpr size_t dynamic_capacity = 0;
+
 /**
  * Class providing a sum-tree structure for data of differing priority.
  *
@@ -23,9 +45,13 @@ namespace per {
  * Repeating until the root spans the tree.
  *
  * @tparam ValueType the data type to hold. The ValueType must be movable.
+ * @tparam Capacity the capacity fixed at compile time, or `dynamic_capacity` (the default) if it is
+ * provided at runtime. A fixed capacity stores the tree inline in `std::array`s and fully unrolls
+ * the root-to-leaf descent and the leaf-to-root propagation, since the tree depth is known. Such a
+ * tree lives wherever its owner does, so large ones belong on the heap.
  */
-template < typename ValueType >
-class SumTree {
+template < typename ValueType, size_t Capacity = dynamic_capacity >
+class PER_API SumTree {
   public:
    // Every sample entered into the buffer is copied (as is done for e.g. std::vector). Within the
    // buffer the sample may be moved (e.g. when updated).
@@ -34,35 +60,151 @@ class SumTree {
       "The ValueType of the SumTree must be copy constructible and move assignable.");
 
    using value_type = ValueType;
+   using generation_type = ::std::uint64_t;
+
+   /// whether the capacity is fixed at compile time
+   static constexpr bool is_fixed = Capacity != dynamic_capacity;
+
+   /**
+    * Compute the level at which the leaves of a tree of the given capacity are.
+    * @param capacity the number of leaves.
+    * @return the leaf level (starts counting from 1).
+    */
+   static constexpr size_t leaf_level_of(size_t capacity)
+   {
+      size_t level = 1;
+      while((size_t(1) << (level - 1)) < capacity) {
+         level++;
+      }
+      return level;
+   }
+
+   /// the leaf level of a fixed capacity tree
+   static constexpr size_t fixed_leaf_level = leaf_level_of(Capacity);
+
+   template < typename T, size_t N >
+   using storage_type = ::std::conditional_t< is_fixed, ::std::array< T, N >, ::std::vector< T > >;
+   using priority_storage = storage_type< double, (size_t(1) << fixed_leaf_level) - 1 >;
+   using value_storage = storage_type< value_type, Capacity >;
+   using generation_storage = storage_type< generation_type, Capacity >;
 
    /**
     * The constructor.
     *
     * Defaults all values but the capacity which is provided.
-    * @param capacity the maximum nr of samples to hold.
+    * @param capacity the maximum nr of samples to hold. Must equal `Capacity` if it is fixed.
+    * @param policy the strategy to choose the element to overwrite once the capacity is exhausted.
+    * @param seed the random seed of the reservoir policy.
     */
-   SumTree(size_t capacity);
+   SumTree(
+      size_t capacity,
+      EvictionPolicy policy = EvictionPolicy::fifo,
+      CounterRng::seed_type seed = 0);
 
    /**
     * Getter for the total sum priority.
     * @return the root's priority.
     */
-   [[nodiscard]] inline double total() const { return m_prioritree[0]; }
+   [[nodiscard]] inline double total() const { return m_prioritree[0] * m_scale; }
+
+   /**
+    * Multiply all priorities by @p factor in O(1), e.g. to decay them over time.
+    *
+    * The tree stores every priority divided by a global scale factor, which is multiplied by
+    * @p factor instead of the priorities themselves. Later inserts and updates are divided by the
+    * scale factor before they are stored. Once the scale factor leaves [1e-100, 1e100], the stored
+    * priorities are renormalized in O(n) to avoid their under- or overflow.
+    * @param factor the positive and finite factor.
+    * @throw ::std::invalid_argument if the factor is not positive and finite.
+    */
+   void scale_priorities(double factor);
+   /**
+    * Multiply the stored priorities by the scale factor and reset the latter to 1.
+    */
+   void renormalize();
+   /**
+    * Getter for the global scale factor of the stored priorities.
+    * @return the scale factor.
+    */
+   [[nodiscard]] double scale() const { return m_scale; }
 
    /**
     * Getter for the number of currently contained elements.
     * @return the size of the tree.
     */
    [[nodiscard]] inline size_t size() const { return m_size; }
+   /**
+    * Getter for the maximum number of elements.
+    * @return the capacity of the tree.
+    */
+   [[nodiscard]] inline size_t capacity() const { return m_capacity; }
+
+   /**
+    * Change the capacity of the tree.
+    *
+    * If the leaf level stays the same and the held elements occupy the leading leaves in insertion
+    * order, the leaf level merely grows or shrinks in place. Otherwise the elements are relinked in
+    * O(n) into a new tree, oldest first, such that the insertion cursor points past the newest
+    * element. Shrinking below the size evicts the oldest elements. Priorities, the insertion order,
+    * the scale factor and the min-tree are preserved. A relink writes every leaf, hence it
+    * increments all leaf generations beyond their previous maximum.
+    * @param capacity the new capacity.
+    * @return the evicted elements, oldest first.
+    * @throw ::std::invalid_argument if @p capacity is 0.
+    * @throw ::std::logic_error if the capacity is fixed at compile time.
+    */
+   ::std::vector< ::std::tuple< value_type, double > > resize(size_t capacity);
+   /**
+    * Grow the capacity of the tree to at least @p capacity. Never evicts elements.
+    * @param capacity the minimal capacity.
+    */
+   void reserve(size_t capacity)
+   {
+      if(capacity > m_capacity) {
+         resize(capacity);
+      }
+   }
+   /**
+    * Replace all elements of the tree by the given leaves in a single O(n) rebuild.
+    *
+    * Leaf i receives the i-th element and priority. Since the leaves are filled in order, the
+    * cursor has to point behind the last element unless the tree is filled to capacity, in which
+    * case it addresses the oldest element. The scale factor is reset to 1. Every leaf is written,
+    * hence all leaf generations are incremented beyond their previous maximum.
+    * @param values the elements of the leading leaves.
+    * @param priorities the elements' associated priorities.
+    * @param cursor the position of the next FIFO insertion.
+    * @throw ::std::invalid_argument if the lengths do not match, exceed the capacity or the cursor
+    * is inconsistent with the number of elements.
+    */
+   void assign(
+      ::std::vector< value_type > values,
+      const ::std::vector< double >& priorities,
+      size_t cursor);
 
    /**
     * Insert an element into the tree together with its priority.
     * @param value the element to emplace.
     * @param priority the element's associated priority.
     * @return the optional element that had to be overwritten if the capacity was exceeded.
-    * Otherwise returns an empty optinal.
+    * Otherwise returns an empty optinal. If the reservoir policy discards @p value, the tree
+    * remains unchanged and an empty optional is returned as well.
     */
    ::std::optional< ::std::tuple< value_type, double > > insert(value_type value, double priority);
+   /**
+    * Insert a collection of elements into the tree together with their priorities.
+    *
+    * The elements are moved into a contiguous (possibly wrapping) range of leaves, after which only
+    * the internal nodes above this range are recomputed level by level. The result is the same as
+    * inserting the elements one by one, but avoids a leaf-to-root walk per element. Elements that
+    * would be overwritten by later elements of the same collection are skipped. Policies other
+    * than FIFO insert the elements one by one.
+    * @param values the elements to emplace.
+    * @param priorities the elements' associated priorities.
+    * @return the previously held elements which had to be overwritten, in leaf order of the writes.
+    */
+   ::std::vector< ::std::tuple< value_type, double > >
+   insert(::std::vector< value_type > values, const ::std::vector< double >& priorities);
    /**
     * Update the value at the given index with the provided priority.
     *
@@ -101,7 +243,55 @@ class SumTree {
     * @return a tuple of leaf index, element, element's priority.
     */
    ::std::tuple< size_t, value_type, double > get(double priority, bool percentage = true);
+   /**
+    * Find the leaf index pertaining to a given priority.
+    *
+    * Performs the same root-to-leaf descent as `get`, but only returns the leaf index. This allows
+    * callers to access the element by reference instead of receiving a copy of it.
+    *
+    * @param priority the starting priority to serch for.
+    * @param percentage boolean switch to indicate whether the priority is relative to the total
+    * priority or absolute.
+    * @return the leaf index of the found element.
+    */
+   [[nodiscard]] size_t find(double priority, bool percentage = true) const;
+   /**
+    * Find the leaf indices pertaining to an ascending sequence of priorities in one traversal.
+    *
+    * The result equals (up to rounding) calling `find` for every priority, but the priorities are
+    * resolved jointly in a single in-order traversal, which splits the sorted sequence at every
+    * node it enters. Each node is visited at most once, hence the costs are bounded by
+    * O(min(n log k, n + k)) for n priorities and k leaves instead of O(n log k).
+    *
+    * @param priorities the ascending priorities to search for.
+    * @param percentage boolean switch to indicate whether the priorities are relative to the total
+    * priority or absolute.
+    * @return the ascending leaf indices of the found elements.
+    */
+   [[nodiscard]] ::std::vector< size_t > find_sorted(
+      const ::std::vector< double >& priorities,
+      bool percentage = true) const;
    double priority(size_t index);
+   /**
+    * Getter for the generation of the leaf at the given index.
+    *
+    * The generation counts how often the leaf has been written by `insert`. It allows to detect
+    * whether an index obtained earlier still refers to the same element.
+    * @param index the index of the leaf.
+    * @return the generation of the leaf, 0 if it has never been written.
+    */
+   [[nodiscard]] generation_type generation(size_t index) const { return m_generations[index]; }
+   /**
+    * Getter for the leaf index the next inserted element is written to under the FIFO policy (or
+    * any policy while the tree is not yet full).
+    * @return the position of the insertion cursor.
+    */
+   [[nodiscard]] size_t cursor() const { return m_leaf_pos; }
+   /**
+    * Getter for the eviction policy.
+    * @return the policy.
+    */
+   [[nodiscard]] EvictionPolicy policy() const { return m_policy; }
 
    /**
     * Access the leaf element at the given index.
@@ -116,22 +306,25 @@ class SumTree {
     * Getter of the entire value vector.
     * @return a const reference to the values collection.
     */
-   const ::std::vector< value_type >& values() const { return &m_values; }
+   const value_storage& values() const { return m_values; }
    /**
     * Begin iterator for the priorities collection.
+    *
+    * The iterators yield the stored priorities, i.e. the priorities divided by `scale()`. They
+    * coincide with the priorities after a call to `renormalize`.
     * @return the iterator pointing at the start of the priorities.
     */
-   [[nodiscard]] ::std::vector< double >::const_iterator priority_begin() const;
+   [[nodiscard]] typename priority_storage::const_iterator priority_begin() const;
    /**
     * End iterator for the priorities collection.
     * @return the iterator pointing at the end of the priorities.
     */
-   [[nodiscard]] ::std::vector< double >::const_iterator priority_end() const;
+   [[nodiscard]] typename priority_storage::const_iterator priority_end() const;
    /**
     * Begin iterator for the values collection.
     * @return the iterator pointing at the start of the values.
     */
-   [[nodiscard]] typename ::std::vector< value_type >::const_iterator value_begin() const
+   [[nodiscard]] typename value_storage::const_iterator value_begin() const
    {
       return m_values.begin();
    }
@@ -139,7 +332,7 @@ class SumTree {
     * End iterator for the values collection.
     * @return the iterator pointing at the end of the values.
     */
-   [[nodiscard]] typename ::std::vector< value_type >::const_iterator value_end() const
+   [[nodiscard]] typename value_storage::const_iterator value_end() const
    {
       auto offset = static_cast<
          typename std::iterator_traits< decltype(m_prioritree.begin()) >::difference_type >(m_size);
@@ -182,19 +375,116 @@ class SumTree {
    /// the level at which the leaves are (starts counting from 1)
    size_t m_leaf_level;
    /// the priority tree collection
-   ::std::vector< double > m_prioritree;
+   priority_storage m_prioritree;
    /// the value collection
-   ::std::vector< value_type > m_values;
+   value_storage m_values;
+   /// the number of insertions into each leaf
+   generation_storage m_generations;
+   /// the strategy to choose the element to overwrite
+   EvictionPolicy m_policy;
+   /// the tree of minimal priorities of each subtree, only maintained for the lowest priority
+   /// policy. Unused leaves hold infinity.
+   ::std::vector< double > m_mintree;
+   /// the total number of inserted elements (including discarded ones)
+   size_t m_n_inserted = 0;
+   /// the random stream of the reservoir policy. Draw k depends only on (seed, k).
+   CounterRng m_rng;
+   /// the global factor by which all stored priorities are to be multiplied
+   double m_scale = 1.;
+
+   /**
+    * Choose the leaf the next inserted element is written to.
+    * @return the leaf index or the capacity, if the element is to be discarded.
+    */
+   [[nodiscard]] size_t _insert_slot() const;
+   /**
+    * Find the leaf of lowest priority by descending the min-tree.
+    * @return the leaf index.
+    */
+   [[nodiscard]] size_t _lowest_priority_leaf() const;
 
    /**
     * Get the first index pertaining to a given level.
     * @param level the level in question (starts counting from 1).
     * @return the first index of this level
     */
-   [[nodiscard]] size_t _first_index_at_level(size_t level) const
+   [[nodiscard]] static constexpr size_t _first_index_at_level(size_t level)
    {
-      return static_cast< size_t >(::std::exp2(level - 1)) - 1;
+      return (size_t(1) << (level - 1)) - 1;
    }
+   /**
+    * Get the tree index of the first leaf.
+    * @return the first index of the leaf level.
+    */
+   [[nodiscard]] size_t _first_leaf() const
+   {
+      if constexpr(is_fixed) {
+         return _first_index_at_level(fixed_leaf_level);
+      } else {
+         return _first_index_at_level(m_leaf_level);
+      }
+   }
+   /**
+    * Call @p step once per edge on a root-to-leaf path, i.e. leaf level - 1 times.
+    *
+    * Fixed capacity trees unroll these calls.
+    * @param step the function advancing a descent or propagation by one level.
+    */
+   template < typename Function >
+   void _for_each_level(Function&& step) const
+   {
+      if constexpr(is_fixed) {
+         unroll< fixed_leaf_level - 1 >(step);
+      } else {
+         for(size_t level = 1; level < m_leaf_level; level++) {
+            step();
+         }
+      }
+   }
+   /**
+    * Create a storage collection of the given size with all elements set to @p value.
+    * @param size the number of elements (ignored for fixed capacity arrays).
+    * @param value the value to fill in.
+    * @return the storage collection.
+    */
+   template < typename Storage, typename T >
+   static Storage _make_storage([[maybe_unused]] size_t size, const T& value)
+   {
+      if constexpr(is_fixed) {
+         Storage storage;
+         storage.fill(value);
+         return storage;
+      } else {
+         return Storage(size, value);
+      }
+   }
+   /**
+    * Recompute all internal nodes above the leaf range [@p first, @p last).
+    * @param first the first leaf index of the range.
+    * @param last the leaf index past the end of the range.
+    */
+   void _recompute_range(size_t first, size_t last);
+   /**
+    * Resolve the ascending stored priorities [@p first, @p last) in the subtree of @p node.
+    * @param node the tree index of the subtree's root.
+    * @param first the first priority of the range.
+    * @param last the priority past the end of the range.
+    * @param offset the priority mass left of the subtree.
+    * @param priorities the priorities in units of the stored tree.
+    * @param leaves the leaf index of each priority.
+    */
+   void _find_sorted(
+      size_t node,
+      size_t first,
+      size_t last,
+      double offset,
+      const ::std::vector< double >& priorities,
+      ::std::vector< size_t >& leaves) const;
+   /**
+    * Propagate the priority of the given tree node up the min-tree.
+    * @param index the tree index of the node.
+    */
+   void _update_min(size_t index);
    /**
     * Check if the index lies within the bounds of the values collection.
     * @param index the index to check.
@@ -235,9 +525,9 @@ class SumTree {
 #include <sstream>
 #include <utility>
 
-template < typename ValueType >
+template < typename ValueType, size_t Capacity >
 template < typename T1, typename T2, typename Allocator1, typename Allocator2 >
-void SumTree< ValueType >::_assert_length_eq(
+void SumTree< ValueType, Capacity >::_assert_length_eq(
    const ::std::vector< T1, Allocator1 >& values,
    const ::std::vector< T2, Allocator2 >& priorities)
 {
@@ -246,35 +536,324 @@ void SumTree< ValueType >::_assert_length_eq(
    }
 }
 
-template < typename ValueType >
-SumTree< ValueType >::SumTree(size_t capacity)
+template < typename ValueType, size_t Capacity >
+SumTree< ValueType, Capacity >::SumTree(
+   size_t capacity,
+   EvictionPolicy policy,
+   CounterRng::seed_type seed)
     : m_capacity(capacity),
-      m_leaf_level(static_cast< size_t >(::std::ceil(::std::log2(capacity) + 1))),
-      m_prioritree(static_cast< size_t >(::std::exp2(m_leaf_level)) - 1, 0),
-      m_values(capacity)
+      m_leaf_level(leaf_level_of(capacity)),
+      m_prioritree(_make_storage< priority_storage >((size_t(1) << m_leaf_level) - 1, 0.)),
+      m_values(_make_storage< value_storage >(capacity, value_type{})),
+      m_generations(_make_storage< generation_storage >(capacity, generation_type(0))),
+      m_policy(policy),
+      m_mintree(
+         policy == EvictionPolicy::lowest_priority ? m_prioritree.size() : 0,
+         ::std::numeric_limits< double >::infinity()),
+      // the reservoir draws use the last counter to stay apart from the batch streams of buffers
+      // sharing the seed
+      m_rng(seed, ::std::numeric_limits< ::std::uint64_t >::max())
+{
+   if constexpr(is_fixed) {
+      if(capacity != Capacity) {
+         throw ::std::invalid_argument(
+            "Capacity '" + ::std::to_string(capacity) + "' differs from the fixed capacity '"
+            + ::std::to_string(Capacity) + "'.");
+      }
+   }
+}
+
+template < typename ValueType, size_t Capacity >
+size_t SumTree< ValueType, Capacity >::_insert_slot() const
 {
+   if(m_size < m_capacity) {
+      return m_leaf_pos;
+   }
+   switch(m_policy) {
+      case EvictionPolicy::lowest_priority: return _lowest_priority_leaf();
+      case EvictionPolicy::reservoir: {
+         // keep the element with probability capacity / (n + 1) by drawing a uniform position
+         // among all n + 1 elements seen so far
+         auto position = static_cast< size_t >(
+            m_rng.uniform(m_n_inserted) * static_cast< double >(m_n_inserted + 1));
+         return ::std::min(position, m_capacity);
+      }
+      default: return m_leaf_pos;
+   }
 }
 
-template < typename ValueType >
-::std::optional< ::std::tuple< ValueType, double > > SumTree< ValueType >::insert(
+template < typename ValueType, size_t Capacity >
+size_t SumTree< ValueType, Capacity >::_lowest_priority_leaf() const
+{
+   size_t index = 0;
+   _for_each_level([&] {
+      size_t left_idx = 2 * index + 1;
+      index = m_mintree[left_idx] <= m_mintree[left_idx + 1] ? left_idx : left_idx + 1;
+   });
+   return index - _first_leaf();
+}
+
+template < typename ValueType, size_t Capacity >
+::std::optional< ::std::tuple< ValueType, double > > SumTree< ValueType, Capacity >::insert(
    ValueType value,
    double priority)
 {
    ::std::optional< ::std::tuple< ValueType, double > > old_pair = ::std::nullopt;
    using iter_diff_t = typename decltype(m_prioritree)::difference_type;
-   if(m_size == m_capacity) {
+   size_t slot = _insert_slot();
+   m_n_inserted++;
+   if(slot == m_capacity) {
+      // discarded by the reservoir
+      return old_pair;
+   }
+   bool full = m_size == m_capacity;
+   if(full) {
       old_pair = {
-         m_values[m_leaf_pos], *(priority_begin() + static_cast< iter_diff_t >(m_leaf_pos))};
+         m_values[slot], *(priority_begin() + static_cast< iter_diff_t >(slot)) * m_scale};
    }
    m_size = ::std::min(m_size + 1, m_capacity);
-   update(m_leaf_pos, priority, ::std::move(value));
+   update(slot, priority, ::std::move(value));
+   m_generations[slot]++;
 
-   m_leaf_pos = (m_leaf_pos + 1) % m_capacity;
+   if(not full or m_policy == EvictionPolicy::fifo) {
+      m_leaf_pos = (m_leaf_pos + 1) % m_capacity;
+   }
    return old_pair;
 }
 
-template < typename ValueType >
-void SumTree< ValueType >::update(
+template < typename ValueType, size_t Capacity >
+::std::vector< ::std::tuple< ValueType, double > > SumTree< ValueType, Capacity >::insert(
+   ::std::vector< ValueType > values,
+   const ::std::vector< double >& priorities)
+{
+   _assert_length_eq(values, priorities);
+   ::std::vector< ::std::tuple< ValueType, double > > evicted;
+   size_t n = values.size();
+   if(m_policy != EvictionPolicy::fifo) {
+      // the overwritten leaves are not contiguous
+      for(size_t i = 0; i < n; i++) {
+         auto old_pair = insert(::std::move(values[i]), priorities[i]);
+         if(old_pair.has_value()) {
+            evicted.emplace_back(::std::move(old_pair.value()));
+         }
+      }
+      return evicted;
+   }
+   if(n == 0) {
+      return evicted;
+   }
+   // only the last `capacity` elements survive the insertion. The skipped ones still count as
+   // writes to their leaves.
+   size_t skip = n > m_capacity ? n - m_capacity : 0;
+   for(size_t i = 0; i < skip; i++) {
+      m_generations[(m_leaf_pos + i) % m_capacity]++;
+   }
+   size_t start = (m_leaf_pos + skip) % m_capacity;
+   size_t n_written = n - skip;
+   size_t first_leaf = _first_leaf();
+   for(size_t i = 0; i < n_written; i++) {
+      size_t slot = (start + i) % m_capacity;
+      // the leaves are filled in order, hence a leaf is occupied iff it lies below the size
+      if(slot < m_size) {
+         evicted.emplace_back(
+            ::std::move(m_values[slot]), m_prioritree[first_leaf + slot] * m_scale);
+      }
+      m_values[slot] = ::std::move(values[skip + i]);
+      m_prioritree[first_leaf + slot] = priorities[skip + i] / m_scale;
+      m_generations[slot]++;
+   }
+   size_t end = start + n_written;
+   if(end <= m_capacity) {
+      _recompute_range(start, end);
+   } else {
+      _recompute_range(start, m_capacity);
+      _recompute_range(0, end - m_capacity);
+   }
+   m_size = ::std::min(m_size + n, m_capacity);
+   m_leaf_pos = end % m_capacity;
+   m_n_inserted += n;
+   return evicted;
+}
+
+template < typename ValueType, size_t Capacity >
+::std::vector< ::std::tuple< ValueType, double > > SumTree< ValueType, Capacity >::resize(
+   size_t capacity)
+{
+   ::std::vector< ::std::tuple< ValueType, double > > evicted;
+   if constexpr(is_fixed) {
+      throw ::std::logic_error("The capacity of a fixed capacity SumTree cannot be changed.");
+   } else {
+      if(capacity == 0) {
+         throw ::std::invalid_argument("The capacity of a SumTree must be positive.");
+      }
+      if(capacity == m_capacity) {
+         return evicted;
+      }
+      size_t leaf_level = leaf_level_of(capacity);
+      // the leaves hold the elements in insertion order iff the oldest element is in leaf 0
+      bool ordered = m_size < m_capacity or m_leaf_pos == 0;
+      if(leaf_level == m_leaf_level and ordered and capacity >= m_size) {
+         // the leaves behind the size are empty, hence the tree above them remains valid
+         m_values.resize(capacity);
+         m_generations.resize(capacity, 0);
+         m_capacity = capacity;
+         m_leaf_pos = m_size % m_capacity;
+         return evicted;
+      }
+      // the leaves in insertion order start at the oldest element
+      size_t oldest = m_size == m_capacity ? m_leaf_pos : 0;
+      size_t n_evicted = m_size > capacity ? m_size - capacity : 0;
+      size_t n_kept = m_size - n_evicted;
+      size_t first_leaf = _first_leaf();
+      evicted.reserve(n_evicted);
+      for(size_t i = 0; i < n_evicted; i++) {
+         size_t slot = (oldest + i) % m_capacity;
+         evicted.emplace_back(
+            ::std::move(m_values[slot]), m_prioritree[first_leaf + slot] * m_scale);
+      }
+
+      value_storage values(capacity);
+      priority_storage prioritree((size_t(1) << leaf_level) - 1, 0.);
+      size_t new_first_leaf = _first_index_at_level(leaf_level);
+      for(size_t i = 0; i < n_kept; i++) {
+         size_t slot = (oldest + n_evicted + i) % m_capacity;
+         values[i] = ::std::move(m_values[slot]);
+         // the priorities remain relative to the scale factor
+         prioritree[new_first_leaf + i] = m_prioritree[first_leaf + slot];
+      }
+      generation_type generation = 0;
+      if(m_size > 0) {
+         generation = *::std::max_element(m_generations.begin(), m_generations.end()) + 1;
+      }
+
+      m_values = ::std::move(values);
+      m_prioritree = ::std::move(prioritree);
+      m_generations.assign(capacity, generation);
+      m_capacity = capacity;
+      m_size = n_kept;
+      m_leaf_pos = n_kept % capacity;
+      m_leaf_level = leaf_level;
+      if(n_kept > 0) {
+         _recompute_range(0, n_kept);
+      }
+      if(m_policy == EvictionPolicy::lowest_priority) {
+         m_mintree.assign(m_prioritree.size(), ::std::numeric_limits< double >::infinity());
+         for(size_t i = 0; i < n_kept; i++) {
+            m_mintree[new_first_leaf + i] = m_prioritree[new_first_leaf + i];
+         }
+         for(size_t node = new_first_leaf; node > 0; node--) {
+            m_mintree[node - 1] = ::std::min(m_mintree[2 * node - 1], m_mintree[2 * node]);
+         }
+      }
+   }
+   return evicted;
+}
+
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::assign(
+   ::std::vector< ValueType > values,
+   const ::std::vector< double >& priorities,
+   size_t cursor)
+{
+   _assert_length_eq(values, priorities);
+   size_t n = values.size();
+   if(n > m_capacity) {
+      throw ::std::invalid_argument(
+         "Number of elements '" + ::std::to_string(n) + "' exceeds the capacity '"
+         + ::std::to_string(m_capacity) + "'.");
+   }
+   if(n < m_capacity ? cursor != n : cursor >= m_capacity) {
+      throw ::std::invalid_argument(
+         "Cursor '" + ::std::to_string(cursor) + "' does not fit " + ::std::to_string(n)
+         + " elements.");
+   }
+   generation_type generation = 0;
+   if(m_size > 0) {
+      generation = *::std::max_element(m_generations.begin(), m_generations.end()) + 1;
+   }
+   size_t first_leaf = _first_leaf();
+   ::std::fill(m_prioritree.begin(), m_prioritree.end(), 0.);
+   for(size_t i = 0; i < m_capacity; i++) {
+      m_values[i] = i < n ? ::std::move(values[i]) : value_type{};
+      m_generations[i] = generation;
+   }
+   for(size_t i = 0; i < n; i++) {
+      m_prioritree[first_leaf + i] = priorities[i];
+   }
+   m_scale = 1.;
+   m_size = n;
+   m_leaf_pos = cursor;
+   m_n_inserted = n;
+   if(n > 0) {
+      _recompute_range(0, n);
+   }
+   if(m_policy == EvictionPolicy::lowest_priority) {
+      ::std::fill(m_mintree.begin(), m_mintree.end(), ::std::numeric_limits< double >::infinity());
+      for(size_t i = 0; i < n; i++) {
+         m_mintree[first_leaf + i] = m_prioritree[first_leaf + i];
+      }
+      for(size_t node = first_leaf; node > 0; node--) {
+         m_mintree[node - 1] = ::std::min(m_mintree[2 * node - 1], m_mintree[2 * node]);
+      }
+   }
+}
+
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::_recompute_range(size_t first, size_t last)
+{
+   size_t low = _first_leaf() + first;
+   size_t high = _first_leaf() + last - 1;
+   while(low > 0) {
+      low = (low - 1) / 2;
+      high = (high - 1) / 2;
+      for(size_t node = low; node <= high; node++) {
+         m_prioritree[node] = m_prioritree[2 * node + 1] + m_prioritree[2 * node + 2];
+      }
+   }
+}
+
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::scale_priorities(double factor)
+{
+   if(not(factor > 0.) or ::std::isinf(factor)) {
+      throw ::std::invalid_argument(
+         "Scale factor '" + ::std::to_string(factor) + "' is not positive and finite.");
+   }
+   m_scale *= factor;
+   if(m_scale < 1e-100 or m_scale > 1e100) {
+      renormalize();
+   }
+}
+
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::renormalize()
+{
+   if(m_scale == 1.) {
+      return;
+   }
+   // scaling every node by the same factor keeps the sums intact. The min-tree stays valid, since
+   // a positive factor preserves the order.
+   for(auto& node : m_prioritree) {
+      node *= m_scale;
+   }
+   for(auto& node : m_mintree) {
+      node *= m_scale;
+   }
+   m_scale = 1.;
+}
+
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::_update_min(size_t index)
+{
+   m_mintree[index] = m_prioritree[index];
+   _for_each_level([&] {
+      index = (index - 1) / 2;
+      m_mintree[index] = ::std::min(m_mintree[2 * index + 1], m_mintree[2 * index + 2]);
+   });
+}
+
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::update(
    size_t index,
    double priority,
    ::std::optional< ValueType > value_opt)
@@ -283,17 +862,21 @@ void SumTree< ValueType >::update(
    if(value_opt.has_value()) {
       m_values[index] = ::std::move(value_opt.value());
    }
-   index += _first_index_at_level(m_leaf_level);
+   index += _first_leaf();
+   priority /= m_scale;
    double delta = priority - m_prioritree[index];
    m_prioritree[index] = priority;
-   while(index > 0) {
+   if(m_policy == EvictionPolicy::lowest_priority) {
+      _update_min(index);
+   }
+   _for_each_level([&] {
       index = (index - 1) / 2;
       m_prioritree[index] += delta;
-   }
+   });
 }
 
-template < typename ValueType >
-void SumTree< ValueType >::update(
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::update(
    const ::std::vector< size_t >& index,
    const ::std::vector< double >& priority,
    const ::std::optional< ::std::vector< ::std::optional< ValueType > > >& value)
@@ -314,35 +897,44 @@ void SumTree< ValueType >::update(
    }
 }
 
-template < typename ValueType >
-double SumTree< ValueType >::priority(size_t index)
+template < typename ValueType, size_t Capacity >
+double SumTree< ValueType, Capacity >::priority(size_t index)
 {
    _assert_index_in_range(index);
-   return m_prioritree[_first_index_at_level(m_leaf_level) + index];
+   return m_prioritree[_first_leaf() + index] * m_scale;
 }
 
-template < typename ValueType >
-auto SumTree< ValueType >::get(double priority, bool percentage)
+template < typename ValueType, size_t Capacity >
+auto SumTree< ValueType, Capacity >::get(double priority, bool percentage)
    -> ::std::tuple< size_t, ValueType, double >
+{
+   auto index = find(priority, percentage);
+   return {index, m_values[index], m_prioritree[_first_leaf() + index] * m_scale};
+}
+
+template < typename ValueType, size_t Capacity >
+size_t SumTree< ValueType, Capacity >::find(double priority, bool percentage) const
 {
    if(percentage) {
       priority *= m_prioritree[0];
+   } else {
+      priority /= m_scale;
    }
    size_t index = 0;
-   // the breaking index is the FIRST leaf level index. The tree enumerates elements by starting
-   // with 0 at the root, yet the levels starting from 1. This means that, in order to not
-   // overcount, the leaf_level's first index is at 2^(m_max_level - 1) with -1 since starting
-   // from 0. And then one subtracts -1 to reach the first index. An example tree with leaf level
-   // 4 is:
+   // the descent takes one step per level below the root (see `_for_each_level`), hence it ends
+   // on the leaf level. The tree enumerates its nodes level by level starting with 0 at the root,
+   // while the levels are counted from 1. The first leaf is therefore at 2^(m_leaf_level - 1) - 1
+   // and its index is subtracted at the end. An example tree with leaf level 4 is:
    // 0
    // 1 2
    // 3 4 5 6
    // 7 8 9 10 11 12 13 14
    // To reach the first leaf index 7, one computes 2**(4-1) - 1 = 2**3 -1 = 8 - 1 = 7
-   auto breaking_index = static_cast< size_t >(::std::exp2(m_leaf_level - 1) - 1);
-   while(true) {
+   _for_each_level([&] {
       size_t left_idx = 2 * index + 1;
-      if(priority <= m_prioritree[left_idx]) {
+      // rounding errors accumulated in the internal sums may lead the search towards a subtree
+      // without any priority mass (e.g. the unfilled leaves). Such subtrees are never entered.
+      if(priority <= m_prioritree[left_idx] or m_prioritree[left_idx + 1] <= 0.) {
          index = left_idx;  // the left child's index
       } else {
          index = left_idx + 1;  // the right child's index
@@ -351,17 +943,63 @@ auto SumTree< ValueType >::get(double priority, bool percentage)
          // less than that subtree's root, otherwise the logic would never finish.
          priority -= m_prioritree[left_idx];
       }
-      // once we have reached a leaf index, we have found the corresponding element.
-      if(long long value_idx = static_cast< long long >(index)
-                               - static_cast< long long >(breaking_index);
-         value_idx >= 0) {
-         return {value_idx, m_values[static_cast< size_t >(value_idx)], m_prioritree[index]};
-      }
+   });
+   // after leaf level - 1 steps we have reached a leaf index, i.e. the corresponding element.
+   return index - _first_leaf();
+}
+
+template < typename ValueType, size_t Capacity >
+::std::vector< size_t > SumTree< ValueType, Capacity >::find_sorted(
+   const ::std::vector< double >& priorities,
+   bool percentage) const
+{
+   ::std::vector< double > stored(priorities.size());
+   for(size_t i = 0; i < priorities.size(); i++) {
+      stored[i] = percentage ? priorities[i] * m_prioritree[0] : priorities[i] / m_scale;
    }
+   ::std::vector< size_t > leaves(priorities.size());
+   _find_sorted(0, 0, stored.size(), 0., stored, leaves);
+   return leaves;
 }
 
-template < typename ValueType >
-::std::string SumTree< ValueType >::as_str() const
+template < typename ValueType, size_t Capacity >
+void SumTree< ValueType, Capacity >::_find_sorted(
+   size_t node,
+   size_t first,
+   size_t last,
+   double offset,
+   const ::std::vector< double >& priorities,
+   ::std::vector< size_t >& leaves) const
+{
+   if(first == last) {
+      return;
+   }
+   if(node >= _first_leaf()) {
+      ::std::fill(
+         leaves.begin() + static_cast< ::std::ptrdiff_t >(first),
+         leaves.begin() + static_cast< ::std::ptrdiff_t >(last),
+         node - _first_leaf());
+      return;
+   }
+   size_t left_idx = 2 * node + 1;
+   double left = m_prioritree[left_idx];
+   // the same decision as in `find`: the priorities not exceeding the left mass enter the left
+   // subtree, all of them do if the right subtree holds no mass
+   size_t split = last;
+   if(m_prioritree[left_idx + 1] > 0.) {
+      split = static_cast< size_t >(
+         ::std::partition_point(
+            priorities.begin() + static_cast< ::std::ptrdiff_t >(first),
+            priorities.begin() + static_cast< ::std::ptrdiff_t >(last),
+            [&](double priority) { return priority - offset <= left; })
+         - priorities.begin());
+   }
+   _find_sorted(left_idx, first, split, offset, priorities, leaves);
+   _find_sorted(left_idx + 1, split, last, offset + left, priorities, leaves);
+}
+
+template < typename ValueType, size_t Capacity >
+::std::string SumTree< ValueType, Capacity >::as_str() const
 {
    ::std::vector< double > prios;
    prios.reserve(m_capacity);
@@ -374,7 +1012,7 @@ template < typename ValueType >
    size_t level = 1;
    auto curr_elems = static_cast< size_t >(::std::exp2(level - 1));
    for(size_t i = 0; i < m_prioritree.size(); i++) {
-      prios.emplace_back(m_prioritree[i]);
+      prios.emplace_back(m_prioritree[i] * m_scale);
       if(i + 1 == curr_elems) {
          shape_vec.emplace_back(prios.size());
          level++;
@@ -398,21 +1036,30 @@ template < typename ValueType >
    return ss.str();
 }
 
-template < typename ValueType >
-::std::vector< double >::const_iterator SumTree< ValueType >::priority_begin() const
+template < typename ValueType, size_t Capacity >
+auto SumTree< ValueType, Capacity >::priority_begin() const
+   -> typename priority_storage::const_iterator
 {
    using iter_diff_t = typename decltype(m_prioritree)::difference_type;
-   return m_prioritree.begin() + static_cast< iter_diff_t >(_first_index_at_level(m_leaf_level));
+   return m_prioritree.begin() + static_cast< iter_diff_t >(_first_leaf());
 }
 
-template < typename ValueType >
-::std::vector< double >::const_iterator SumTree< ValueType >::priority_end() const
+template < typename ValueType, size_t Capacity >
+auto SumTree< ValueType, Capacity >::priority_end() const
+   -> typename priority_storage::const_iterator
 {
    using iter_diff_t = typename decltype(m_prioritree)::difference_type;
-   return m_prioritree.begin()
-          + static_cast< iter_diff_t >(_first_index_at_level(m_leaf_level) + m_size);
+   return m_prioritree.begin() + static_cast< iter_diff_t >(_first_leaf() + m_size);
 }
 
+#ifdef PER_COMPILED_LIBRARY
+// instantiated in the compiled per++ library
+extern template class SumTree< int >;
+extern template class SumTree< double >;
+extern template class SumTree< size_t >;
+extern template class SumTree< ::std::string >;
+#endif
+
 }  // namespace per
 
 #endif  // PER_SUM_TREE_HPP
@@ -0,0 +1,126 @@
+#ifndef PER_THREAD_POOL_HPP
+#define PER_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "per/macro.hpp"
+
+namespace per {
+
+/**
+ * A minimal fixed-size pool of worker threads executing submitted tasks in FIFO order.
+ *
+ * The pool is meant for short, independent jobs (e.g. decoding single entries of a batch) that
+ * should overlap with work on the submitting thread. Pending tasks are still executed when the
+ * pool is destroyed.
+ */
+class PER_API ThreadPool {
+  public:
+   /**
+    * The constructor.
+    *
+    * @param n_threads the number of worker threads to spawn.
+    */
+   explicit ThreadPool(size_t n_threads);
+
+   ThreadPool(const ThreadPool &) = delete;
+   ThreadPool &operator=(const ThreadPool &) = delete;
+
+   ~ThreadPool();
+
+   /**
+    * Enqueue a task for execution by one of the workers.
+    *
+    * @tparam Callable the task type. Must be invocable without arguments.
+    * @param task the task to execute.
+    * @return a future holding the task's result (or the exception it threw).
+    */
+   template < typename Callable >
+   auto submit(Callable &&task) -> ::std::future< ::std::invoke_result_t< Callable > >;
+
+   /**
+    * Getter for the number of worker threads.
+    * @return the number of workers.
+    */
+   [[nodiscard]] size_t size() const { return m_workers.size(); }
+
+  private:
+   /// the worker threads
+   ::std::vector< ::std::thread > m_workers;
+   /// the queue of pending tasks
+   ::std::queue< ::std::function< void() > > m_tasks;
+   /// the mutex guarding the task queue and the stop flag
+   ::std::mutex m_mutex;
+   /// the condition the workers wait on for new tasks
+   ::std::condition_variable m_condition;
+   /// the flag signaling the workers to shut down once the queue is drained
+   bool m_stop = false;
+
+   void _work();
+};
+
+inline ThreadPool::ThreadPool(size_t n_threads)
+{
+   m_workers.reserve(n_threads);
+   for(size_t i = 0; i < n_threads; i++) {
+      m_workers.emplace_back([this] { _work(); });
+   }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+   {
+      ::std::scoped_lock lock(m_mutex);
+      m_stop = true;
+   }
+   m_condition.notify_all();
+   for(auto &worker : m_workers) {
+      worker.join();
+   }
+}
+
+template < typename Callable >
+auto ThreadPool::submit(Callable &&task) -> ::std::future< ::std::invoke_result_t< Callable > >
+{
+   using result_type = ::std::invoke_result_t< Callable >;
+   // std::function requires copyable targets, hence the packaged task is shared
+   auto packaged = ::std::make_shared< ::std::packaged_task< result_type() > >(
+      ::std::forward< Callable >(task));
+   auto future = packaged->get_future();
+   {
+      ::std::scoped_lock lock(m_mutex);
+      m_tasks.emplace([packaged] { (*packaged)(); });
+   }
+   m_condition.notify_one();
+   return future;
+}
+
+inline void ThreadPool::_work()
+{
+   while(true) {
+      ::std::function< void() > task;
+      {
+         ::std::unique_lock lock(m_mutex);
+         m_condition.wait(lock, [this] { return m_stop or not m_tasks.empty(); });
+         if(m_tasks.empty()) {
+            // only reachable when stopping
+            return;
+         }
+         task = ::std::move(m_tasks.front());
+         m_tasks.pop();
+      }
+      task();
+   }
+}
+
+}  // namespace per
+
+#endif  // PER_THREAD_POOL_HPP
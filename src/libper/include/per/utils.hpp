@@ -3,6 +3,7 @@
 
 #include <iterator>
 #include <type_traits>
+#include <utility>
 
 namespace per {
 
@@ -23,12 +24,36 @@ class ConstView {
    Iter m_end;
 };
 
-template <typename Iter>
-auto advance(Iter&& iter, typename Iter::difference_type n) {
-   Iter it = std::move(iter);
+/**
+ * A guard type which does nothing. Serves as default for the guard template parameters of the
+ * concurrent buffer wrappers.
+ */
+struct NoGuard {
+};
+
+template < typename Iter >
+auto advance(Iter&& iter, typename std::iterator_traits< std::decay_t< Iter > >::difference_type n)
+{
+   std::decay_t< Iter > it = std::move(iter);
    std::advance(it, n);
    return it;
 }
 
+template < typename Function, size_t... Is >
+inline void unroll_impl(Function&& f, std::index_sequence< Is... >)
+{
+   (((void) Is, f()), ...);
+}
+
+/**
+ * Call @p f exactly @p N times. The calls are expanded at compile time, hence the loop is fully
+ * unrolled.
+ */
+template < size_t N, typename Function >
+inline void unroll(Function&& f)
+{
+   unroll_impl(std::forward< Function >(f), std::make_index_sequence< N >{});
+}
+
 }  // namespace per
 #endif  // PER_UTILS_HPP
@@ -1 +1,29 @@
-from ._pyper import SumTree, PrioritizedExperience
\ No newline at end of file
+from ._pyper import (
+    EvictionPolicy,
+    SumTree,
+    PrioritizedExperience,
+    SampleHandle,
+    CompressedPrioritizedExperience,
+    CompressionStats,
+    ArenaPrioritizedExperience,
+    MultiBuffer,
+    MultiBufferView,
+    MultiChannelExperience,
+    RankBasedExperience,
+    PrefetchingSampler,
+    RateLimiter,
+    RateLimiterStats,
+    RateLimitedExperience,
+)
+
+try:
+    # only available on POSIX systems
+    from ._pyper import (
+        SharedPrioritizedExperience,
+        ReplayServer,
+        ReplayClient,
+        ReplaySampleBatch,
+        JournaledPrioritizedExperience,
+    )
+except ImportError:
+    pass
@@ -0,0 +1,278 @@
+"""End-to-end actor/learner throughput benchmark of the python bindings.
+
+Actors push transitions into a `PrioritizedExperience` buffer while a learner repeatedly samples a
+batch, performs a fake train step and updates the priorities of the batch. The benchmark sweeps
+over capacities, batch sizes, value types and alphas and reports per configuration
+
+- the pushed transitions per second,
+- the p50 and p99 latency of `sample`,
+- the GIL hold time, i.e. the share of the wall time for which the binding calls held the GIL.
+
+The bindings of the buffer never release the GIL, hence a call holds it whenever it runs. A thread
+waiting for the GIL on the other hand sleeps. The CPU time of the calling thread during a call is
+therefore its GIL hold time, whereas its wall time would include the wait for the GIL as well.
+
+Run it with
+
+    python -m pyper.benchmark --actors 4 --capacities 10000 100000 --batch-sizes 32 256
+
+Actors are either threads pushing directly into the buffer or processes, whose transitions are
+forwarded by a feeder thread (`--mode process`).
+"""
+
+import argparse
+import itertools
+import json
+import multiprocessing
+import queue
+import random
+import statistics
+import threading
+import time
+from dataclasses import dataclass, field, asdict
+from typing import List
+
+import pyper
+
+VALUE_TYPES = {
+    "int": lambda i: i,
+    "tuple": lambda i: (i, float(i), i % 2 == 0, (i, i)),
+    "bytes": lambda i: bytes(256),
+}
+
+
+@dataclass
+class Config:
+    capacity: int
+    batch_size: int
+    value_type: str
+    alpha: float
+
+
+@dataclass
+class Result:
+    config: Config
+    transitions_per_sec: float
+    samples_per_sec: float
+    sample_p50_ms: float
+    sample_p99_ms: float
+    gil_hold: float
+    gil_hold_push: float
+    gil_hold_sample: float
+    gil_hold_update: float
+
+
+@dataclass
+class _Timer:
+    """Accumulates the GIL hold time of binding calls. Each thread owns its own timer.
+
+    The hold time is the thread's CPU time during the call. The recorded call latencies are wall
+    times, i.e. they include the wait for the GIL.
+    """
+
+    total: float = 0.
+    calls: List[float] = field(default_factory=list)
+    record: bool = False
+
+    def __call__(self, func, *args):
+        start = time.perf_counter()
+        start_cpu = time.thread_time()
+        result = func(*args)
+        self.total += time.thread_time() - start_cpu
+        if self.record:
+            self.calls.append(time.perf_counter() - start)
+        return result
+
+
+# the number of transitions an actor process sends to the feeder at once
+_PROCESS_CHUNK = 64
+
+
+def _percentile(values, q):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+
+def _actor_process(transitions, value_type, chunk, offset, stop):
+    make = VALUE_TYPES[value_type]
+    i = offset
+    while not stop.is_set():
+        transitions.put([make(i + k) for k in range(chunk)])
+        i += chunk
+
+
+def run(config, n_actors=2, mode="thread", duration=2., train_time=1e-3, seed=0):
+    """Benchmark a single configuration.
+
+    @param config the buffer configuration.
+    @param n_actors the number of actors pushing transitions.
+    @param mode either 'thread' or 'process'.
+    @param duration the wall time in seconds to run for (after the warm-up).
+    @param train_time the duration of the fake train step in seconds. The step sleeps, i.e. it
+    releases the GIL like a train step on an accelerator would.
+    @param seed the random seed of the buffer.
+    @return the `Result`.
+    """
+    buffer = pyper.PrioritizedExperience(config.capacity, alpha=config.alpha, seed=seed)
+    make = VALUE_TYPES[config.value_type]
+    # warm up until the learner can sample full batches
+    buffer.push([make(i) for i in range(config.batch_size)])
+
+    stop = threading.Event()
+    push_timers = [_Timer() for _ in range(n_actors if mode == "thread" else 1)]
+    pushed = [0] * len(push_timers)
+
+    def thread_actor(a):
+        i = a * 10 ** 9
+        while not stop.is_set():
+            push_timers[a](buffer.push, make(i))
+            pushed[a] += 1
+            i += 1
+
+    processes = []
+    if mode == "thread":
+        actors = [threading.Thread(target=thread_actor, args=(a,)) for a in range(n_actors)]
+    elif mode == "process":
+        context = multiprocessing.get_context("spawn")
+        transitions = context.Queue(maxsize=64 * n_actors)
+        process_stop = context.Event()
+        processes = [
+            context.Process(
+                target=_actor_process,
+                args=(transitions, config.value_type, _PROCESS_CHUNK, a * 10 ** 9, process_stop),
+                daemon=True,
+            )
+            for a in range(n_actors)
+        ]
+
+        def feeder():
+            while not stop.is_set():
+                try:
+                    batch = transitions.get(timeout=0.05)
+                except queue.Empty:
+                    continue
+                push_timers[0](buffer.push, batch)
+                pushed[0] += len(batch)
+
+        actors = [threading.Thread(target=feeder)]
+    else:
+        raise ValueError(f"Unknown actor mode '{mode}'.")
+
+    sample_timer = _Timer(record=True)
+    update_timer = _Timer()
+    rng = random.Random(seed)
+    n_batches = 0
+
+    for process in processes:
+        process.start()
+    start = time.perf_counter()
+    for actor in actors:
+        actor.start()
+    while time.perf_counter() - start < duration:
+        values, weights, indices = sample_timer(buffer.sample, config.batch_size)
+        time.sleep(train_time)
+        update_timer(buffer.update, indices, [rng.random() for _ in indices])
+        n_batches += 1
+    stop.set()
+    elapsed = time.perf_counter() - start
+    for actor in actors:
+        actor.join()
+    if processes:
+        process_stop.set()
+        # drain the queue, otherwise the actors may block on exit
+        while any(process.is_alive() for process in processes):
+            try:
+                transitions.get(timeout=0.05)
+            except queue.Empty:
+                pass
+        for process in processes:
+            process.join()
+
+    push_time = sum(timer.total for timer in push_timers)
+    return Result(
+        config=config,
+        transitions_per_sec=sum(pushed) / elapsed,
+        samples_per_sec=n_batches * config.batch_size / elapsed,
+        sample_p50_ms=1e3 * statistics.median(sample_timer.calls),
+        sample_p99_ms=1e3 * _percentile(sample_timer.calls, 0.99),
+        gil_hold=(push_time + sample_timer.total + update_timer.total) / elapsed,
+        gil_hold_push=push_time / elapsed,
+        gil_hold_sample=sample_timer.total / elapsed,
+        gil_hold_update=update_timer.total / elapsed,
+    )
+
+
+def sweep(capacities, batch_sizes, value_types, alphas, **kwargs):
+    """Benchmark the cartesian product of the given parameters.
+
+    @param kwargs the remaining arguments of `run`.
+    @return the list of `Result`s.
+    """
+    return [
+        run(Config(*params), **kwargs)
+        for params in itertools.product(capacities, batch_sizes, value_types, alphas)
+    ]
+
+
+def _format(results):
+    header = (
+        f"{'capacity':>10} {'batch':>6} {'value':>6} {'alpha':>6} {'trans/s':>12} "
+        f"{'samples/s':>12} {'p50 ms':>8} {'p99 ms':>8} {'GIL':>6} {'push':>6} "
+        f"{'sample':>6} {'update':>6}"
+    )
+    lines = [header, "-" * len(header)]
+    for r in results:
+        c = r.config
+        lines.append(
+            f"{c.capacity:>10} {c.batch_size:>6} {c.value_type:>6} {c.alpha:>6.2f} "
+            f"{r.transitions_per_sec:>12.0f} {r.samples_per_sec:>12.0f} "
+            f"{r.sample_p50_ms:>8.3f} {r.sample_p99_ms:>8.3f} {r.gil_hold:>6.1%} "
+            f"{r.gil_hold_push:>6.1%} {r.gil_hold_sample:>6.1%} {r.gil_hold_update:>6.1%}"
+        )
+    return "\n".join(lines)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        prog="python -m pyper.benchmark",
+        description="Actor/learner throughput benchmark of the PrioritizedExperience bindings.",
+    )
+    parser.add_argument("--capacities", type=int, nargs="+", default=[10_000, 100_000])
+    parser.add_argument("--batch-sizes", type=int, nargs="+", default=[32, 256])
+    parser.add_argument(
+        "--value-types", nargs="+", default=["int", "tuple"], choices=sorted(VALUE_TYPES)
+    )
+    parser.add_argument("--alphas", type=float, nargs="+", default=[0.6])
+    parser.add_argument("--actors", type=int, default=2, help="the number of actors")
+    parser.add_argument("--mode", choices=["thread", "process"], default="thread")
+    parser.add_argument(
+        "--duration", type=float, default=2., help="seconds to run each configuration"
+    )
+    parser.add_argument(
+        "--train-time", type=float, default=1e-3, help="seconds of the fake train step"
+    )
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--json", action="store_true", help="print the results as json")
+    args = parser.parse_args(argv)
+
+    results = sweep(
+        args.capacities,
+        args.batch_sizes,
+        args.value_types,
+        args.alphas,
+        n_actors=args.actors,
+        mode=args.mode,
+        duration=args.duration,
+        train_time=args.train_time,
+        seed=args.seed,
+    )
+    if args.json:
+        print(json.dumps([asdict(r) for r in results], indent=2))
+    else:
+        print(_format(results))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/byte_arena.hpp"
+
+namespace py = pybind11;
+
+void init_byte_arena(py::module_& m)
+{
+   // payloads are passed as python bytes objects and copied straight into the arena
+   auto to_view = [](const py::bytes& bytes) {
+      char* buffer = nullptr;
+      Py_ssize_t length = 0;
+      if(PyBytes_AsStringAndSize(bytes.ptr(), &buffer, &length) != 0) {
+         throw py::error_already_set();
+      }
+      return std::string_view(buffer, static_cast< size_t >(length));
+   };
+
+   py::class_< per::ArenaExperience > ae(m, "ArenaPrioritizedExperience");
+
+   ae.def(
+      py::init< size_t, size_t, double, double, per::ArenaExperience::seed_type >(),
+      py::arg("capacity"),
+      py::arg("arena_bytes"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}());
+
+   ae.def(
+      "push",
+      [to_view](per::ArenaExperience& self, const py::bytes& value) {
+         self.push(to_view(value));
+      },
+      py::arg("value"));
+
+   ae.def(
+      "push",
+      [to_view](per::ArenaExperience& self, const std::vector< py::bytes >& values) {
+         for(const auto& value : values) {
+            self.push(to_view(value));
+         }
+      },
+      py::arg("value"));
+
+   ae.def("update", &per::ArenaExperience::update, py::arg("indices"), py::arg("priorities"));
+
+   ae.def(
+      "sample",
+      [](per::ArenaExperience& self, size_t n) {
+         auto [payloads, weights, indices] = self.sample(n);
+         py::list py_values;
+         for(const auto& payload : payloads) {
+            py_values.append(py::bytes(payload.data(), payload.size()));
+         }
+         return py::make_tuple(py_values, py::cast(weights), py::cast(indices));
+      },
+      py::arg("n"));
+
+   ae.def(
+      "payload",
+      [](const per::ArenaExperience& self, size_t index) {
+         auto payload = self.payload(index);
+         return py::bytes(payload.data(), payload.size());
+      },
+      py::arg("index"));
+
+   ae.def_property_readonly("capacity", &per::ArenaExperience::capacity);
+   ae.def_property_readonly("n_live", &per::ArenaExperience::n_live);
+   ae.def_property_readonly(
+      "arena_bytes", [](const per::ArenaExperience& self) { return self.arena().capacity(); });
+   ae.def_property_readonly(
+      "used_bytes", [](const per::ArenaExperience& self) { return self.arena().used(); });
+
+   ae.def("__len__", &per::ArenaExperience::size);
+}
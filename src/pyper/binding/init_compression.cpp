@@ -0,0 +1,97 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/compression.hpp"
+
+namespace py = pybind11;
+
+void init_compression(py::module_& m)
+{
+   using PyCompressedExperience = per::CompressedExperience< per::DeltaRLECodec< std::uint8_t > >;
+   using value_type = PyCompressedExperience::value_type;
+
+   // payloads are passed as python bytes objects (e.g. `numpy.ndarray.tobytes()`)
+   auto to_value = [](const py::bytes& bytes) {
+      char* buffer = nullptr;
+      Py_ssize_t length = 0;
+      if(PyBytes_AsStringAndSize(bytes.ptr(), &buffer, &length) != 0) {
+         throw py::error_already_set();
+      }
+      const auto* data = reinterpret_cast< const std::uint8_t* >(buffer);
+      return value_type(data, data + length);
+   };
+
+   py::class_< per::CompressionStats > stats(m, "CompressionStats");
+
+   stats.def_readonly("raw_bytes", &per::CompressionStats::raw_bytes);
+   stats.def_readonly("encoded_bytes", &per::CompressionStats::encoded_bytes);
+   stats.def_readonly("encode_seconds", &per::CompressionStats::encode_seconds);
+   stats.def_readonly("decode_wait_seconds", &per::CompressionStats::decode_wait_seconds);
+   stats.def_property_readonly("ratio", &per::CompressionStats::ratio);
+
+   py::class_< PyCompressedExperience > cpe(m, "CompressedPrioritizedExperience");
+
+   cpe.def(
+      py::init< size_t, double, double, PyCompressedExperience::BufferType::seed_type, size_t >(),
+      py::arg("capacity"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}(),
+      py::arg("n_threads") = 2);
+
+   cpe.def(
+      "push",
+      [to_value](PyCompressedExperience& self, const py::bytes& value) {
+         self.push(to_value(value));
+      },
+      py::arg("value"));
+
+   cpe.def(
+      "push",
+      [to_value](PyCompressedExperience& self, const std::vector< py::bytes >& values) {
+         PyCompressedExperience::ValueVec converted;
+         converted.reserve(values.size());
+         for(const auto& value : values) {
+            converted.emplace_back(to_value(value));
+         }
+         py::gil_scoped_release release;
+         self.push(converted);
+      },
+      py::arg("value"));
+
+   cpe.def(
+      "update", &PyCompressedExperience::update, py::arg("indices"), py::arg("priorities"));
+
+   cpe.def(
+      "sample",
+      [](PyCompressedExperience& self, size_t n) {
+         auto [values, weights, indices] = [&] {
+            py::gil_scoped_release release;
+            return self.sample(n);
+         }();
+         py::list py_values;
+         for(const auto& value : values) {
+            py_values.append(
+               py::bytes(reinterpret_cast< const char* >(value.data()), value.size()));
+         }
+         return py::make_tuple(py_values, py::cast(weights), py::cast(indices));
+      },
+      py::arg("n"));
+
+   cpe.def_property(
+      "alpha",
+      py::overload_cast<>(&PyCompressedExperience::alpha, py::const_),
+      py::overload_cast< double >(&PyCompressedExperience::alpha));
+
+   cpe.def_property(
+      "beta",
+      py::overload_cast<>(&PyCompressedExperience::beta, py::const_),
+      py::overload_cast< double >(&PyCompressedExperience::beta));
+
+   cpe.def_property_readonly("capacity", &PyCompressedExperience::capacity);
+
+   cpe.def("__len__", &PyCompressedExperience::size);
+
+   cpe.def_property_readonly(
+      "stats", [](const PyCompressedExperience& self) { return self.stats(); });
+}
@@ -1,6 +1,8 @@
+#include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "instantiations.hpp"
 #include "per/per.hpp"
 
 namespace py = pybind11;
@@ -9,33 +11,106 @@ void init_experience_replay(py::module_& m)
 {
    using PyPrioritizedExperience = per::PrioritizedExperience< py::object >;
 
+   py::class_< per::SampleHandle > handle(m, "SampleHandle");
+
+   handle.def(py::init< size_t, std::uint64_t >(), py::arg("index"), py::arg("generation"));
+   handle.def_readonly("index", &per::SampleHandle::index);
+   handle.def_readonly("generation", &per::SampleHandle::generation);
+   handle.def(py::self == py::self);
+   handle.def(py::self != py::self);
+   handle.def("__hash__", [](const per::SampleHandle& self) {
+      return py::hash(py::make_tuple(self.index, self.generation));
+   });
+   handle.def("__repr__", [](const per::SampleHandle& self) {
+      return "SampleHandle(index=" + std::to_string(self.index)
+             + ", generation=" + std::to_string(self.generation) + ")";
+   });
+
    py::class_< PyPrioritizedExperience > pe(m, "PrioritizedExperience");
 
    pe.def(
-      py::init< size_t, double, double, std::mt19937_64::result_type >(),
+      py::init< size_t, double, double, PyPrioritizedExperience::seed_type, per::EvictionPolicy >(),
       py::arg("capacity"),
       py::arg("alpha") = 1.,
       py::arg("beta") = 1.,
-      py::arg("seed") = std::random_device{}());
+      py::arg("seed") = std::random_device{}(),
+      py::arg("policy") = per::EvictionPolicy::fifo);
 
+   // overloads are tried in order of registration and the object overload accepts anything, hence a
+   // list has to be matched first to be pushed as a collection. Other sequences, e.g. transition
+   // tuples, remain single values.
    pe.def(
       "push",
-      py::overload_cast< PyPrioritizedExperience::value_type >(&PyPrioritizedExperience::push),
+      [](PyPrioritizedExperience& self, const py::list& values) {
+         self.push(values.cast< PyPrioritizedExperience::ValueVec >());
+      },
       py::arg("value"));
 
    pe.def(
       "push",
-      py::overload_cast< const PyPrioritizedExperience::ValueVec& >(&PyPrioritizedExperience::push),
+      py::overload_cast< PyPrioritizedExperience::value_type >(&PyPrioritizedExperience::push),
       py::arg("value"));
 
    pe.def("update", &PyPrioritizedExperience::update, py::arg("indices"), py::arg("priorities"));
 
+   // updates through handles skip all samples that have been overwritten since they were drawn
+   pe.def(
+      "update",
+      &PyPrioritizedExperience::update_handles,
+      py::arg("handles"),
+      py::arg("priorities"));
+
+   pe.def(
+      "decay_priorities",
+      &PyPrioritizedExperience::decay_priorities,
+      py::arg("factor"));
+
+   pe.def("resize", &PyPrioritizedExperience::resize, py::arg("capacity"));
+
+   pe.def("reserve", &PyPrioritizedExperience::reserve, py::arg("capacity"));
+
    pe.def("sample", &PyPrioritizedExperience::sample, py::arg("n"));
 
+   pe.def("sample_handles", &PyPrioritizedExperience::sample_handles, py::arg("n"));
+
+   // O(1) draws (with replacement) from a frozen alias table of the priorities
+   pe.def(
+      "build_snapshot",
+      &PyPrioritizedExperience::build_snapshot,
+      py::arg("n_threads") = 0);
+
+   pe.def("invalidate_snapshot", &PyPrioritizedExperience::invalidate_snapshot);
+
+   pe.def_property_readonly("has_snapshot", &PyPrioritizedExperience::has_snapshot);
+
+   pe.def("sample_snapshot", &PyPrioritizedExperience::sample_snapshot, py::arg("n"));
+
    pe.def_property(
       "alpha",
       py::overload_cast<>(&PyPrioritizedExperience::alpha, py::const_),
       py::overload_cast< double >(&PyPrioritizedExperience::alpha));
 
+   // batches above this fraction of the size (and of at least `sweep_min_batch` samples) are drawn
+   // stratified in a single sweep of the tree. Disabled by default.
+   pe.def_property(
+      "sweep_threshold",
+      py::overload_cast<>(&PyPrioritizedExperience::sweep_threshold, py::const_),
+      py::overload_cast< double >(&PyPrioritizedExperience::sweep_threshold));
+
    pe.def_property_readonly("capacity", &PyPrioritizedExperience::capacity);
+
+   pe.def_property_readonly("total", &PyPrioritizedExperience::total);
+
+   pe.def("__len__", &PyPrioritizedExperience::size);
+
+   // the generator state (seed, counter) allows to store and restore the sampling stream
+   pe.def_property(
+      "rng_state",
+      [](const PyPrioritizedExperience& self) {
+         return std::make_tuple(self.rng().seed(), self.rng().counter());
+      },
+      [](PyPrioritizedExperience& self,
+         const std::tuple< PyPrioritizedExperience::seed_type, std::uint64_t >& state) {
+         self.rng(per::CounterRng{std::get< 0 >(state), std::get< 1 >(state)});
+      });
 }
\ No newline at end of file
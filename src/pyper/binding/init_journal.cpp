@@ -0,0 +1,76 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/journal.hpp"
+
+namespace py = pybind11;
+
+void init_journal(py::module_& m)
+{
+#if OS == LINUX || OS == MAC
+   // the journal encodes the values, hence python values are journaled as bytes objects
+   using JournaledExperience = per::JournaledExperience< std::string >;
+
+   py::class_< JournaledExperience > je(m, "JournaledPrioritizedExperience");
+
+   je.def(
+      py::init<
+         std::string,
+         size_t,
+         double,
+         double,
+         JournaledExperience::seed_type,
+         double,
+         size_t >(),
+      py::arg("path"),
+      py::arg("capacity"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}(),
+      py::arg("commit_interval") = 1.,
+      py::arg("compact_bytes") = size_t(1) << 28u);
+
+   je.def(
+      "push",
+      [](JournaledExperience& self, std::string value) { self.push(std::move(value)); },
+      py::arg("value"));
+   je.def(
+      "push",
+      [](JournaledExperience& self, std::vector< std::string > values) {
+         self.push(std::move(values));
+      },
+      py::arg("value"));
+   je.def("update", &JournaledExperience::update, py::arg("indices"), py::arg("priorities"));
+   je.def(
+      "sample",
+      [](JournaledExperience& self, size_t n) {
+         py::list values;
+         std::vector< double > weights;
+         std::vector< size_t > indices;
+         self.sample_each(n, [&](size_t index, const std::string& value, double weight) {
+            values.append(py::bytes(value));
+            weights.emplace_back(weight);
+            indices.emplace_back(index);
+         });
+         return py::make_tuple(values, py::cast(weights), py::cast(indices));
+      },
+      py::arg("n"));
+
+   je.def("flush", &JournaledExperience::flush, py::call_guard< py::gil_scoped_release >());
+   je.def("compact", &JournaledExperience::compact);
+
+   je.def_property(
+      "alpha",
+      py::overload_cast<>(&JournaledExperience::alpha, py::const_),
+      py::overload_cast< double >(&JournaledExperience::alpha));
+   je.def_property(
+      "beta",
+      py::overload_cast<>(&JournaledExperience::beta, py::const_),
+      py::overload_cast< double >(&JournaledExperience::beta));
+   je.def_property_readonly("capacity", &JournaledExperience::capacity);
+   je.def_property_readonly("journal_bytes", &JournaledExperience::journal_bytes);
+   je.def_property_readonly("epoch", &JournaledExperience::epoch);
+
+   je.def("__len__", &JournaledExperience::size);
+#endif
+}
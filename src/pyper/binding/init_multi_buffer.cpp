@@ -0,0 +1,88 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "instantiations.hpp"
+#include "per/per.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+using PyMultiBuffer = per::MultiBuffer< py::object >;
+
+/// a read-only view of a sub-buffer of a MultiBuffer
+struct SubBufferView {
+   const PyMultiBuffer::BufferType* buffer;
+};
+
+}  // namespace
+
+void init_multi_buffer(py::module_& m)
+{
+   py::class_< SubBufferView > view(m, "MultiBufferView");
+   view.def_property_readonly(
+      "alpha", [](const SubBufferView& self) { return self.buffer->alpha(); });
+   view.def_property_readonly(
+      "beta", [](const SubBufferView& self) { return self.buffer->beta(); });
+   view.def_property_readonly(
+      "capacity", [](const SubBufferView& self) { return self.buffer->capacity(); });
+   view.def_property_readonly(
+      "total", [](const SubBufferView& self) { return self.buffer->total(); });
+   view.def("__len__", [](const SubBufferView& self) { return self.buffer->size(); });
+
+   py::class_< PyMultiBuffer > mb(m, "MultiBuffer");
+
+   mb.def(
+      py::init< size_t, size_t, double, double, PyMultiBuffer::seed_type, per::EvictionPolicy >(),
+      py::arg("n_buffers"),
+      py::arg("capacity"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}(),
+      py::arg("policy") = per::EvictionPolicy::fifo);
+
+   // a list is pushed as a collection, hence its overload has to precede the object overload
+   mb.def(
+      "push",
+      [](PyMultiBuffer& self, size_t buffer, const py::list& values) {
+         self.push(buffer, values.cast< PyMultiBuffer::ValueVec >());
+      },
+      py::arg("buffer"),
+      py::arg("value"));
+
+   mb.def(
+      "push",
+      py::overload_cast< size_t, PyMultiBuffer::value_type >(&PyMultiBuffer::push),
+      py::arg("buffer"),
+      py::arg("value"));
+
+   mb.def(
+      "update",
+      &PyMultiBuffer::update,
+      py::arg("buffers"),
+      py::arg("indices"),
+      py::arg("priorities"));
+
+   mb.def("decay_priorities", &PyMultiBuffer::decay_priorities, py::arg("factor"));
+
+   mb.def("sample", &PyMultiBuffer::sample, py::arg("n"));
+
+   mb.def_property(
+      "mixing_weights",
+      py::overload_cast<>(&PyMultiBuffer::mixing_weights, py::const_),
+      py::overload_cast< std::vector< double > >(&PyMultiBuffer::mixing_weights));
+
+   // all modifications have to go through the MultiBuffer, hence the sub-buffers are exposed
+   // through a read-only view of their getters
+   mb.def(
+      "buffer",
+      [](const PyMultiBuffer& self, size_t buffer) { return SubBufferView{&self.buffer(buffer)}; },
+      py::arg("buffer"),
+      py::keep_alive< 0, 1 >());
+
+   mb.def_property_readonly("n_buffers", &PyMultiBuffer::n_buffers);
+
+   mb.def_property_readonly("total", &PyMultiBuffer::total);
+
+   mb.def("__len__", &PyMultiBuffer::size);
+}
@@ -0,0 +1,59 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "instantiations.hpp"
+#include "per/per.hpp"
+
+namespace py = pybind11;
+
+void init_multi_channel(py::module_& m)
+{
+   using PyMultiChannel = per::MultiChannelExperience< py::object >;
+
+   py::class_< PyMultiChannel > mc(m, "MultiChannelExperience");
+
+   mc.def(
+      py::init<
+         size_t,
+         const std::vector< double >&,
+         const std::vector< double >&,
+         PyMultiChannel::seed_type >(),
+      py::arg("capacity"),
+      py::arg("alphas"),
+      py::arg("betas"),
+      py::arg("seed") = std::random_device{}());
+
+   // a list is pushed as a collection, hence its overload has to precede the object overload
+   mc.def(
+      "push",
+      [](PyMultiChannel& self, const py::list& values) {
+         self.push(values.cast< PyMultiChannel::ValueVec >());
+      },
+      py::arg("value"));
+
+   mc.def(
+      "push",
+      py::overload_cast< PyMultiChannel::value_type >(&PyMultiChannel::push),
+      py::arg("value"));
+
+   mc.def(
+      "update",
+      &PyMultiChannel::update,
+      py::arg("indices"),
+      py::arg("priorities"),
+      py::arg("channel"));
+
+   mc.def("sample", &PyMultiChannel::sample, py::arg("n"), py::arg("channel"));
+
+   mc.def("alpha", &PyMultiChannel::alpha, py::arg("channel"));
+
+   mc.def("beta", &PyMultiChannel::beta, py::arg("channel"));
+
+   mc.def("total", &PyMultiChannel::total, py::arg("channel"));
+
+   mc.def_property_readonly("n_channels", &PyMultiChannel::n_channels);
+
+   mc.def_property_readonly("capacity", &PyMultiChannel::capacity);
+
+   mc.def("__len__", &PyMultiChannel::size);
+}
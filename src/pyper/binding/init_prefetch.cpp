@@ -0,0 +1,69 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/prefetch.hpp"
+
+namespace py = pybind11;
+
+void init_prefetch(py::module_& m)
+{
+   // the worker has to hold the GIL while it copies the sampled python objects
+   using PyPrefetchingSampler = per::PrefetchingSampler< py::object, py::gil_scoped_acquire >;
+   using PyPrioritizedExperience = PyPrefetchingSampler::BufferType;
+
+   // the worker might be waiting for the GIL, hence it has to be released while stopping the worker
+   struct StoppingDeleter {
+      void operator()(PyPrefetchingSampler* sampler) const
+      {
+         {
+            py::gil_scoped_release release;
+            sampler->stop();
+         }
+         delete sampler;
+      }
+   };
+
+   py::class_< PyPrefetchingSampler, std::unique_ptr< PyPrefetchingSampler, StoppingDeleter > >
+      sampler(m, "PrefetchingSampler");
+
+   sampler.def(
+      py::init< PyPrioritizedExperience&, size_t, size_t >(),
+      py::arg("buffer"),
+      py::arg("batch_size"),
+      py::arg("n_prefetch") = 2,
+      py::keep_alive< 1, 2 >());
+
+   // a list is pushed as a collection, hence its overload has to precede the object overload
+   sampler.def(
+      "push",
+      [](PyPrefetchingSampler& self, const py::list& values) {
+         self.push(values.cast< PyPrefetchingSampler::ValueVec >());
+      },
+      py::arg("value"));
+
+   sampler.def(
+      "push",
+      py::overload_cast< PyPrefetchingSampler::value_type >(&PyPrefetchingSampler::push),
+      py::arg("value"));
+
+   sampler.def("update", &PyPrefetchingSampler::update, py::arg("indices"), py::arg("priorities"));
+
+   sampler.def("__iter__", [](py::object self) { return self; });
+
+   sampler.def("__next__", [](PyPrefetchingSampler& self) {
+      auto batch = [&] {
+         py::gil_scoped_release release;
+         return self.next();
+      }();
+      if(not batch.has_value()) {
+         throw py::stop_iteration();
+      }
+      return std::move(batch.value());
+   });
+
+   sampler.def("close", &PyPrefetchingSampler::stop, py::call_guard< py::gil_scoped_release >());
+
+   sampler.def_property_readonly("batch_size", &PyPrefetchingSampler::batch_size);
+
+   sampler.def_property_readonly("n_prefetch", &PyPrefetchingSampler::n_prefetch);
+}
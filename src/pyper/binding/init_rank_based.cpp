@@ -0,0 +1,57 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "instantiations.hpp"
+#include "per/per.hpp"
+
+namespace py = pybind11;
+
+void init_rank_based(py::module_& m)
+{
+   using PyRankBasedExperience = per::RankBasedExperience< py::object >;
+
+   py::class_< PyRankBasedExperience > rbe(m, "RankBasedExperience");
+
+   rbe.def(
+      py::init< size_t, double, double, PyRankBasedExperience::seed_type, size_t >(),
+      py::arg("capacity"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}(),
+      py::arg("resort_interval") = 0);
+
+   // a list is pushed as a collection, hence its overload has to precede the object overload
+   rbe.def(
+      "push",
+      [](PyRankBasedExperience& self, const py::list& values) {
+         self.push(values.cast< PyRankBasedExperience::ValueVec >());
+      },
+      py::arg("value"));
+
+   rbe.def(
+      "push",
+      py::overload_cast< PyRankBasedExperience::value_type >(&PyRankBasedExperience::push),
+      py::arg("value"));
+
+   rbe.def("update", &PyRankBasedExperience::update, py::arg("indices"), py::arg("priorities"));
+
+   rbe.def("sample", &PyRankBasedExperience::sample, py::arg("n"));
+
+   rbe.def("sort", &PyRankBasedExperience::sort);
+
+   rbe.def("rank", &PyRankBasedExperience::rank, py::arg("index"));
+
+   rbe.def_property(
+      "alpha",
+      py::overload_cast<>(&PyRankBasedExperience::alpha, py::const_),
+      py::overload_cast< double >(&PyRankBasedExperience::alpha));
+
+   rbe.def_property(
+      "beta",
+      py::overload_cast<>(&PyRankBasedExperience::beta, py::const_),
+      py::overload_cast< double >(&PyRankBasedExperience::beta));
+
+   rbe.def_property_readonly("capacity", &PyRankBasedExperience::capacity);
+
+   rbe.def("__len__", &PyRankBasedExperience::size);
+}
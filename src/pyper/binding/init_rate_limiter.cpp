@@ -0,0 +1,86 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/rate_limiter.hpp"
+
+namespace py = pybind11;
+
+void init_rate_limiter(py::module_& m)
+{
+   // every call releases the GIL before it may block on the limiter and reacquires it only for the
+   // duration of the buffer access, in which the python objects are copied
+   using PyRateLimitedExperience = per::RateLimitedExperience< py::object, py::gil_scoped_acquire >;
+   using PyPrioritizedExperience = PyRateLimitedExperience::BufferType;
+
+   py::class_< per::RateLimiter > limiter(m, "RateLimiter");
+
+   limiter.def(
+      py::init< double, size_t, double >(),
+      py::arg("samples_per_insert"),
+      py::arg("min_size_to_sample"),
+      py::arg("error_buffer"));
+
+   limiter.def_property_readonly("samples_per_insert", &per::RateLimiter::samples_per_insert);
+   limiter.def_property_readonly("min_size_to_sample", &per::RateLimiter::min_size_to_sample);
+   limiter.def_property_readonly("error_buffer", &per::RateLimiter::error_buffer);
+
+   py::class_< per::RateLimiterStats > stats(m, "RateLimiterStats");
+
+   stats.def_readonly("inserts", &per::RateLimiterStats::inserts);
+   stats.def_readonly("samples", &per::RateLimiterStats::samples);
+   stats.def_readonly("insert_wait_seconds", &per::RateLimiterStats::insert_wait_seconds);
+   stats.def_readonly("sample_wait_seconds", &per::RateLimiterStats::sample_wait_seconds);
+   stats.def_readonly("insert_timeouts", &per::RateLimiterStats::insert_timeouts);
+   stats.def_readonly("sample_timeouts", &per::RateLimiterStats::sample_timeouts);
+
+   py::class_< PyRateLimitedExperience > rle(m, "RateLimitedExperience");
+
+   rle.def(
+      py::init< PyPrioritizedExperience&, per::RateLimiter >(),
+      py::arg("buffer"),
+      py::arg("limiter"),
+      py::keep_alive< 1, 2 >());
+
+   // a list is pushed as a collection, hence its overload has to precede the object overload. The
+   // list is converted before the GIL is released.
+   rle.def(
+      "push",
+      [](PyRateLimitedExperience& self, const py::list& values, std::optional< double > timeout) {
+         auto converted = values.cast< PyRateLimitedExperience::ValueVec >();
+         py::gil_scoped_release release;
+         return self.push(converted, timeout);
+      },
+      py::arg("value"),
+      py::arg("timeout") = py::none());
+
+   rle.def(
+      "push",
+      py::overload_cast< const PyRateLimitedExperience::value_type&, std::optional< double > >(
+         &PyRateLimitedExperience::push),
+      py::arg("value"),
+      py::arg("timeout") = py::none(),
+      py::call_guard< py::gil_scoped_release >());
+
+   rle.def(
+      "sample",
+      &PyRateLimitedExperience::sample,
+      py::arg("n"),
+      py::arg("timeout") = py::none(),
+      py::call_guard< py::gil_scoped_release >());
+
+   rle.def(
+      "update",
+      &PyRateLimitedExperience::update,
+      py::arg("indices"),
+      py::arg("priorities"),
+      py::call_guard< py::gil_scoped_release >());
+
+   rle.def("stop", &PyRateLimitedExperience::stop, py::call_guard< py::gil_scoped_release >());
+
+   rle.def("__len__", &PyRateLimitedExperience::size, py::call_guard< py::gil_scoped_release >());
+
+   rle.def_property_readonly(
+      "stats", &PyRateLimitedExperience::stats, py::call_guard< py::gil_scoped_release >());
+
+   rle.def_property_readonly("limiter", &PyRateLimitedExperience::limiter);
+}
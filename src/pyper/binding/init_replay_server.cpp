@@ -0,0 +1,118 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/replay_client.hpp"
+#include "per/replay_server.hpp"
+
+namespace py = pybind11;
+
+void init_replay_server(py::module_& m)
+{
+#if OS == LINUX || OS == MAC
+   using per::ReplayClient;
+   using per::ReplaySampleBatch;
+   using per::ReplayServer;
+
+   py::class_< ReplayServer > server(m, "ReplayServer");
+
+   server.def(
+      py::init< std::string, size_t, double, double, ReplayServer::BufferType::seed_type >(),
+      py::arg("socket_path"),
+      py::arg("capacity"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}());
+
+   server.def("serve", &ReplayServer::serve, py::call_guard< py::gil_scoped_release >());
+   server.def("stop", &ReplayServer::stop);
+   server.def_property_readonly("socket_path", &ReplayServer::socket_path);
+
+   py::class_< ReplaySampleBatch > batch(m, "ReplaySampleBatch");
+
+   batch.def(py::init<>());
+   batch.def("__len__", &ReplaySampleBatch::size);
+   batch.def(
+      "__getitem__",
+      [](const ReplaySampleBatch& self, size_t i) {
+         if(i >= self.size()) {
+            throw py::index_error("Sample index out of range.");
+         }
+         return py::bytes(self.value(i).data(), self.value(i).size());
+      },
+      py::arg("i"));
+   batch.def_property_readonly(
+      "values",
+      [](const ReplaySampleBatch& self) {
+         py::list values;
+         for(size_t i = 0; i < self.size(); i++) {
+            values.append(py::bytes(self.value(i).data(), self.value(i).size()));
+         }
+         return values;
+      });
+   batch.def_readonly("weights", &ReplaySampleBatch::weights);
+   batch.def_readonly("indices", &ReplaySampleBatch::indices);
+
+   py::class_< ReplayClient > client(m, "ReplayClient");
+
+   client.def(py::init< std::string >(), py::arg("socket_path"));
+
+   client.def(
+      "push",
+      &ReplayClient::push,
+      py::arg("values"),
+      py::call_guard< py::gil_scoped_release >());
+   client.def(
+      "update",
+      &ReplayClient::update,
+      py::arg("indices"),
+      py::arg("priorities"),
+      py::call_guard< py::gil_scoped_release >());
+   client.def(
+      "sample",
+      [](ReplayClient& self, size_t n) {
+         ReplaySampleBatch batch;
+         {
+            py::gil_scoped_release release;
+            self.sample(n, batch);
+         }
+         py::list values;
+         for(size_t i = 0; i < batch.size(); i++) {
+            values.append(py::bytes(batch.value(i).data(), batch.value(i).size()));
+         }
+         return py::make_tuple(values, py::cast(batch.weights), py::cast(batch.indices));
+      },
+      py::arg("n"));
+   client.def(
+      "sample_into",
+      &ReplayClient::sample,
+      py::arg("n"),
+      py::arg("batch"),
+      py::call_guard< py::gil_scoped_release >());
+
+   client.def(
+      "send_push",
+      &ReplayClient::send_push,
+      py::arg("values"),
+      py::call_guard< py::gil_scoped_release >());
+   client.def(
+      "send_update",
+      &ReplayClient::send_update,
+      py::arg("indices"),
+      py::arg("priorities"),
+      py::call_guard< py::gil_scoped_release >());
+   client.def(
+      "send_sample",
+      &ReplayClient::send_sample,
+      py::arg("n"),
+      py::call_guard< py::gil_scoped_release >());
+   client.def(
+      "receive_ack", &ReplayClient::receive_ack, py::call_guard< py::gil_scoped_release >());
+   client.def(
+      "receive_sample",
+      &ReplayClient::receive_sample,
+      py::arg("batch"),
+      py::call_guard< py::gil_scoped_release >());
+
+   client.def_property_readonly("pending", &ReplayClient::pending);
+#endif
+}
@@ -0,0 +1,89 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "per/shared_experience.hpp"
+
+namespace py = pybind11;
+
+void init_shared_experience(py::module_& m)
+{
+#if OS == LINUX || OS == MAC
+   using PySharedExperience = per::SharedPrioritizedExperience;
+
+   py::class_< PySharedExperience > spe(m, "SharedPrioritizedExperience");
+
+   spe.def(
+      py::init< std::string, size_t, size_t, double, double, PySharedExperience::seed_type >(),
+      py::arg("name"),
+      py::arg("capacity"),
+      py::arg("slot_size"),
+      py::arg("alpha") = 1.,
+      py::arg("beta") = 1.,
+      py::arg("seed") = std::random_device{}());
+
+   spe.def(py::init< std::string >(), py::arg("name"));
+
+   spe.def(
+      "push",
+      [](PySharedExperience& self, const py::bytes& value) {
+         char* buffer = nullptr;
+         Py_ssize_t length = 0;
+         if(PyBytes_AsStringAndSize(value.ptr(), &buffer, &length) != 0) {
+            throw py::error_already_set();
+         }
+         // the bytes object is immutable and kept alive by the caller while the GIL is released
+         py::gil_scoped_release release;
+         self.push(std::string_view(buffer, static_cast< size_t >(length)));
+      },
+      py::arg("value"));
+
+   spe.def(
+      "push",
+      [](PySharedExperience& self, const std::vector< std::string >& values) {
+         py::gil_scoped_release release;
+         self.push(values);
+      },
+      py::arg("value"));
+
+   spe.def(
+      "update",
+      &PySharedExperience::update,
+      py::arg("indices"),
+      py::arg("priorities"),
+      py::call_guard< py::gil_scoped_release >());
+
+   spe.def(
+      "sample",
+      [](PySharedExperience& self, size_t n) {
+         auto [values, weights, indices] = [&] {
+            py::gil_scoped_release release;
+            return self.sample(n);
+         }();
+         py::list py_values;
+         for(const auto& value : values) {
+            py_values.append(py::bytes(value));
+         }
+         return py::make_tuple(py_values, py::cast(weights), py::cast(indices));
+      },
+      py::arg("n"));
+
+   spe.def("unlink", &PySharedExperience::unlink);
+
+   spe.def("__len__", &PySharedExperience::size, py::call_guard< py::gil_scoped_release >());
+
+   spe.def_property_readonly("name", &PySharedExperience::name);
+   spe.def_property_readonly("owner", &PySharedExperience::owner);
+   spe.def_property_readonly("alpha", &PySharedExperience::alpha);
+   spe.def_property_readonly("beta", &PySharedExperience::beta);
+   spe.def_property_readonly("capacity", &PySharedExperience::capacity);
+   spe.def_property_readonly("slot_size", &PySharedExperience::slot_size);
+
+   // pickling transfers the segment's name only, unpickling attaches to the same segment. This
+   // allows to hand the buffer to `multiprocessing` workers.
+   spe.def(py::pickle(
+      [](const PySharedExperience& self) { return py::make_tuple(self.name()); },
+      [](const py::tuple& state) {
+         return std::make_unique< PySharedExperience >(state[0].cast< std::string >());
+      }));
+#endif
+}
@@ -1,6 +1,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "instantiations.hpp"
 #include "per/sum_tree.hpp"
 
 namespace py = pybind11;
@@ -8,8 +9,20 @@ namespace py = pybind11;
 void init_sumtree(py::module_& m)
 {
    using PySumTree = per::SumTree< py::object >;
+
+   py::enum_< per::EvictionPolicy >(m, "EvictionPolicy")
+      .value("fifo", per::EvictionPolicy::fifo)
+      .value("lowest_priority", per::EvictionPolicy::lowest_priority)
+      .value("reservoir", per::EvictionPolicy::reservoir);
+
    py::class_< PySumTree > sumtree(m, "SumTree");
-   sumtree.def(py::init< size_t >(), py::arg("capacity"));
+   sumtree.def(
+      py::init< size_t, per::EvictionPolicy, per::CounterRng::seed_type >(),
+      py::arg("capacity"),
+      py::arg("policy") = per::EvictionPolicy::fifo,
+      py::arg("seed") = 0);
+
+   sumtree.def_property_readonly("policy", &PySumTree::policy);
 
    sumtree.def("__len__", &PySumTree::size);
 
@@ -19,7 +32,28 @@ void init_sumtree(py::module_& m)
 
    sumtree.def_property_readonly("total", &PySumTree::total);
 
-   sumtree.def("insert", &PySumTree::insert, py::arg("value"), py::arg("priority"));
+   sumtree.def("scale_priorities", &PySumTree::scale_priorities, py::arg("factor"));
+
+   sumtree.def_property_readonly("scale", &PySumTree::scale);
+
+   sumtree.def_property_readonly("capacity", &PySumTree::capacity);
+
+   sumtree.def("resize", &PySumTree::resize, py::arg("capacity"));
+
+   sumtree.def("reserve", &PySumTree::reserve, py::arg("capacity"));
+
+   sumtree.def(
+      "insert",
+      py::overload_cast< PySumTree::value_type, double >(&PySumTree::insert),
+      py::arg("value"),
+      py::arg("priority"));
+
+   sumtree.def(
+      "insert",
+      py::overload_cast< std::vector< PySumTree::value_type >, const std::vector< double >& >(
+         &PySumTree::insert),
+      py::arg("values"),
+      py::arg("priorities"));
 
    sumtree.def(
       "update",
@@ -42,8 +76,14 @@ void init_sumtree(py::module_& m)
 
    sumtree.def("get", &PySumTree::get, py::arg("priority"), py::arg("percentage") = true);
 
+   // the tree stores the priorities divided by its scale factor, hence the iterators yield copies
+   // of the scaled priorities instead of the stored ones
    sumtree.def("priority_iter", [](const PySumTree& tree) {
-      return py::make_iterator(tree.priority_begin(), tree.priority_end());
+      py::list priorities;
+      for(auto priority = tree.priority_begin(); priority != tree.priority_end(); ++priority) {
+         priorities.append(*priority * tree.scale());
+      }
+      return py::iter(priorities);
    });
 
    sumtree.def("value_iter", [](const PySumTree& tree) {
@@ -51,6 +91,11 @@ void init_sumtree(py::module_& m)
    });
 
    sumtree.def("__iter__", [](const PySumTree& tree) {
-      return py::make_iterator(tree.begin(), tree.end());
+      py::list entries;
+      auto priority = tree.priority_begin();
+      for(auto value = tree.value_begin(); value != tree.value_end(); ++value, ++priority) {
+         entries.append(py::make_tuple(*value, *priority * tree.scale()));
+      }
+      return py::iter(entries);
    });
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#include "instantiations.hpp"
+
+namespace per {
+
+template class SumTree< pybind11::object >;
+template class SumTree< ::std::pair< pybind11::object, double > >;
+template class PrioritizedExperience< pybind11::object >;
+template class MultiBuffer< pybind11::object >;
+template class MultiChannelExperience< pybind11::object >;
+template class RankBasedExperience< pybind11::object >;
+
+}  // namespace per
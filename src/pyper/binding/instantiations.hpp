@@ -0,0 +1,21 @@
+#ifndef PYPER_INSTANTIATIONS_HPP
+#define PYPER_INSTANTIATIONS_HPP
+
+#include <pybind11/pybind11.h>
+
+#include "per/per.hpp"
+
+// the python object instantiations are compiled once in instantiations.cpp instead of in every
+// binding translation unit
+namespace per {
+
+extern template class SumTree< pybind11::object >;
+extern template class SumTree< ::std::pair< pybind11::object, double > >;
+extern template class PrioritizedExperience< pybind11::object >;
+extern template class MultiBuffer< pybind11::object >;
+extern template class MultiChannelExperience< pybind11::object >;
+extern template class RankBasedExperience< pybind11::object >;
+
+}  // namespace per
+
+#endif  // PYPER_INSTANTIATIONS_HPP
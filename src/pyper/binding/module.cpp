@@ -6,13 +6,33 @@
 
 namespace py = pybind11;
 
+void init_byte_arena(py::module_ &);
+void init_compression(py::module_ &);
 void init_experience_replay(py::module_ &);
+void init_journal(py::module_ &);
+void init_multi_buffer(py::module_ &);
+void init_multi_channel(py::module_ &);
+void init_prefetch(py::module_ &);
+void init_rank_based(py::module_ &);
+void init_rate_limiter(py::module_ &);
+void init_replay_server(py::module_ &);
+void init_shared_experience(py::module_ &);
 void init_sumtree(py::module_ &);
 
 PYBIND11_MODULE(_pyper, m)
 {
    init_sumtree(m);
    init_experience_replay(m);
+   init_compression(m);
+   init_byte_arena(m);
+   init_journal(m);
+   init_multi_buffer(m);
+   init_multi_channel(m);
+   init_rank_based(m);
+   init_prefetch(m);
+   init_rate_limiter(m);
+   init_shared_experience(m);
+   init_replay_server(m);
 }
 
 #endif  // PER_MODULE_NAME_HPP
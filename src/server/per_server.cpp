@@ -0,0 +1,81 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "per/replay_server.hpp"
+
+namespace {
+
+per::ReplayServer* active_server = nullptr;
+
+void handle_signal(int)
+{
+   if(active_server != nullptr) {
+      active_server->stop();
+   }
+}
+
+void print_usage(const char* program)
+{
+   std::cerr << "usage: " << program
+             << " --socket PATH --capacity N [--alpha A] [--beta B] [--seed S]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+   std::string socket_path;
+   size_t capacity = 0;
+   double alpha = 1.;
+   double beta = 1.;
+   per::ReplayServer::BufferType::seed_type seed = std::random_device{}();
+
+   for(int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if(i + 1 >= argc) {
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+      std::string value = argv[++i];
+      try {
+         if(arg == "--socket") {
+            socket_path = value;
+         } else if(arg == "--capacity") {
+            capacity = std::stoul(value);
+         } else if(arg == "--alpha") {
+            alpha = std::stod(value);
+         } else if(arg == "--beta") {
+            beta = std::stod(value);
+         } else if(arg == "--seed") {
+            seed = std::stoull(value);
+         } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+         }
+      } catch(const std::logic_error&) {
+         // std::invalid_argument and std::out_of_range of the number conversions
+         std::cerr << "invalid value '" << value << "' for " << arg << "\n";
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   if(socket_path.empty() or capacity == 0) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   per::ReplayServer server(socket_path, capacity, alpha, beta, seed);
+   active_server = &server;
+   std::signal(SIGINT, handle_signal);
+   std::signal(SIGTERM, handle_signal);
+   std::cout << "Serving replay buffer of capacity " << capacity << " on " << socket_path
+             << std::endl;
+   server.serve();
+   active_server = nullptr;
+   std::cout << "Replay buffer holds " << server.buffer().size() << " samples on shutdown."
+             << std::endl;
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "per/replay_client.hpp"
+#include "per/replay_server.hpp"
+
+namespace {
+
+struct BenchmarkConfig {
+   size_t n_clients = 4;
+   size_t capacity = 1u << 16u;
+   size_t batch_size = 64;
+   size_t value_bytes = 256;
+   size_t pipeline_depth = 4;
+   size_t iterations = 1000;
+};
+
+struct ClientResult {
+   size_t transitions = 0;
+   std::vector< double > sample_latencies;
+};
+
+void run_client(const std::string& socket_path, const BenchmarkConfig& config, ClientResult& result)
+{
+   using clock = std::chrono::steady_clock;
+   per::ReplayClient client(socket_path);
+   per::ReplaySampleBatch batch;
+   std::vector< std::string > values(config.batch_size, std::string(config.value_bytes, 'x'));
+   std::vector< size_t > indices;
+   std::vector< double > priorities;
+   std::vector< clock::time_point > sent;
+   client.push(values);
+   result.sample_latencies.reserve(config.iterations);
+
+   for(size_t iteration = 0; iteration < config.iterations;) {
+      // a round of pipelined sample requests, followed by the updates of their samples
+      size_t depth = std::min(config.pipeline_depth, config.iterations - iteration);
+      // the latency of each request is measured from its own send
+      sent.clear();
+      for(size_t k = 0; k < depth; k++) {
+         sent.push_back(clock::now());
+         client.send_sample(config.batch_size);
+      }
+      for(size_t k = 0; k < depth; k++) {
+         client.receive_sample(batch);
+         auto elapsed = std::chrono::duration< double >(clock::now() - sent[k]).count();
+         result.sample_latencies.push_back(elapsed);
+         result.transitions += batch.size();
+         indices.assign(batch.indices.begin(), batch.indices.end());
+         priorities.assign(batch.weights.begin(), batch.weights.end());
+         client.send_update(indices, priorities);
+      }
+      client.send_push(values);
+      for(size_t k = 0; k < depth + 1; k++) {
+         client.receive_ack();
+      }
+      result.transitions += values.size();
+      iteration += depth;
+   }
+}
+
+double percentile(std::vector< double >& values, double q)
+{
+   if(values.empty()) {
+      return 0.;
+   }
+   auto position = static_cast< size_t >(q * static_cast< double >(values.size() - 1));
+   std::nth_element(
+      values.begin(), values.begin() + static_cast< std::ptrdiff_t >(position), values.end());
+   return values[position];
+}
+
+void print_usage(const char* program)
+{
+   std::cerr << "usage: " << program
+             << " [--clients K] [--capacity N] [--batch B] [--value-bytes V]"
+                " [--pipeline D] [--iterations I]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+   BenchmarkConfig config;
+   if(argc % 2 == 0) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+   for(int i = 1; i + 1 < argc; i += 2) {
+      std::string arg = argv[i];
+      size_t value = 0;
+      try {
+         value = std::stoul(argv[i + 1]);
+      } catch(const std::logic_error&) {
+         // std::invalid_argument and std::out_of_range of the number conversion
+         std::cerr << "invalid value '" << argv[i + 1] << "' for " << arg << "\n";
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+      if(arg == "--clients") {
+         config.n_clients = value;
+      } else if(arg == "--capacity") {
+         config.capacity = value;
+      } else if(arg == "--batch") {
+         config.batch_size = value;
+      } else if(arg == "--value-bytes") {
+         config.value_bytes = value;
+      } else if(arg == "--pipeline") {
+         config.pipeline_depth = std::max< size_t >(value, 1);
+      } else if(arg == "--iterations") {
+         config.iterations = value;
+      } else {
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+
+   auto socket_path = "/tmp/per_server_bench_" + std::to_string(getpid()) + ".sock";
+   per::ReplayServer server(socket_path, config.capacity, 0.6, 0.4, 0);
+   std::thread server_thread([&] { server.serve(); });
+
+   std::vector< ClientResult > results(config.n_clients);
+   std::vector< std::thread > clients;
+   auto start = std::chrono::steady_clock::now();
+   for(auto& result : results) {
+      clients.emplace_back([&] { run_client(socket_path, config, result); });
+   }
+   for(auto& client : clients) {
+      client.join();
+   }
+   auto elapsed = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+   server.stop();
+   server_thread.join();
+
+   size_t transitions = 0;
+   std::vector< double > latencies;
+   for(auto& result : results) {
+      transitions += result.transitions;
+      latencies.insert(
+         latencies.end(), result.sample_latencies.begin(), result.sample_latencies.end());
+   }
+   std::cout << "clients: " << config.n_clients << ", batch: " << config.batch_size
+             << ", pipeline: " << config.pipeline_depth << ", value bytes: " << config.value_bytes
+             << "\n";
+   std::cout << "throughput: " << static_cast< double >(transitions) / elapsed
+             << " transitions/s\n";
+   std::cout << "sample latency p50: " << percentile(latencies, 0.5) * 1e6 << " us, p99: "
+             << percentile(latencies, 0.99) * 1e6 << " us\n";
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+namespace {
+
+std::vector< double > draw_frequencies(const per::AliasTable& table, size_t n_draws)
+{
+   per::CounterRng rng(0);
+   std::vector< double > frequencies(table.size(), 0.);
+   for(size_t i = 0; i < n_draws; i++) {
+      auto index = table.draw(rng.uniform(2 * i), rng.uniform(2 * i + 1));
+      frequencies[index] += 1. / static_cast< double >(n_draws);
+   }
+   return frequencies;
+}
+
+}  // namespace
+
+TEST(AliasTable, matches_weights)
+{
+   std::vector< double > weights{1., 0., 3., 0.5, 2.5, 0., 1.};
+   per::AliasTable table;
+   table.build(weights.begin(), weights.end());
+   ASSERT_EQ(table.size(), weights.size());
+   ASSERT_EQ(table.n_chunks(), 1);
+   auto frequencies = draw_frequencies(table, 200000);
+   for(size_t i = 0; i < weights.size(); i++) {
+      ASSERT_NEAR(frequencies[i], weights[i] / 8., 0.005);
+   }
+}
+
+TEST(AliasTable, parallel_build)
+{
+   size_t n = 4 * per::AliasTable::min_chunk_size;
+   std::vector< double > weights(n);
+   for(size_t i = 0; i < n; i++) {
+      // the mass is concentrated in the last chunk
+      weights[i] = i < 3 * n / 4 ? 1. : 3.;
+   }
+   per::ThreadPool pool(4);
+   per::AliasTable table;
+   table.build(weights.begin(), weights.end(), &pool);
+   ASSERT_EQ(table.n_chunks(), 4);
+   auto frequencies = draw_frequencies(table, 400000);
+   double last_quarter = 0.;
+   for(size_t i = 3 * n / 4; i < n; i++) {
+      last_quarter += frequencies[i];
+   }
+   ASSERT_NEAR(last_quarter, 0.5, 0.005);
+}
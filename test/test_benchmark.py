@@ -0,0 +1,13 @@
+from pyper import benchmark
+
+
+def test_benchmark_smoke():
+    results = benchmark.sweep(
+        [100], [8], ["int", "tuple"], [0.6], n_actors=2, duration=0.2, train_time=0.
+    )
+    assert len(results) == 2
+    for result in results:
+        assert result.transitions_per_sec > 0
+        assert result.samples_per_sec > 0
+        assert result.sample_p50_ms <= result.sample_p99_ms
+        assert 0 < result.gil_hold <= 1
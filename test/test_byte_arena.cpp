@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(ByteArena, fifo_reclaim)
+{
+   per::ByteArena arena(10);
+   auto a = arena.allocate(4);
+   auto b = arena.allocate(4);
+   ASSERT_TRUE(a.has_value() and b.has_value());
+   ASSERT_EQ(b->offset, 4);
+   // 2 bytes are left at the end and the front is still taken
+   ASSERT_FALSE(arena.allocate(3).has_value());
+   ASSERT_THROW(arena.release(*b), std::logic_error);
+
+   arena.release(*a);
+   // wraps around to the front
+   auto c = arena.allocate(3);
+   ASSERT_TRUE(c.has_value());
+   ASSERT_EQ(c->offset, 0);
+   ASSERT_FALSE(arena.allocate(2).has_value());
+   ASSERT_EQ(arena.used(), 7);
+
+   arena.release(*b);
+   // the unused end is skipped, the free space now lies behind c
+   auto d = arena.allocate(7);
+   ASSERT_TRUE(d.has_value());
+   ASSERT_EQ(d->offset, 3);
+   arena.release(*c);
+   arena.release(*d);
+   ASSERT_EQ(arena.count(), 0);
+   ASSERT_EQ(arena.allocate(10)->offset, 0);
+}
+
+TEST(ByteArena, empty_allocations)
+{
+   per::ByteArena arena(10);
+   auto a = arena.allocate(3);
+   auto b = arena.allocate(5);
+   auto empty = arena.allocate(0);
+   ASSERT_TRUE(a.has_value() and b.has_value() and empty.has_value());
+   ASSERT_EQ(arena.count(), 3);
+   arena.release(*a);
+   // wraps around to the front
+   auto c = arena.allocate(3);
+   ASSERT_TRUE(c.has_value());
+   ASSERT_EQ(c->offset, 0);
+   // releasing b passes the wrap-around point, the empty allocation is unaffected
+   arena.release(*b);
+   arena.release(*empty);
+   arena.release(*c);
+   ASSERT_EQ(arena.count(), 0);
+   ASSERT_EQ(arena.used(), 0);
+}
+
+TEST(ArenaExperience, payloads_and_eviction)
+{
+   per::ArenaExperience buffer(4, 16, 1., 1., 0);
+   ASSERT_THROW(buffer.push(std::string(17, 'x')), std::invalid_argument);
+
+   buffer.push("aaaaa");
+   buffer.push("bbbbbb");
+   buffer.push("cc");
+   ASSERT_EQ(buffer.size(), 3);
+   ASSERT_EQ(buffer.n_live(), 3);
+   ASSERT_EQ(buffer.payload(1), "bbbbbb");
+
+   // the arena is too small to hold the 4th payload next to the others, hence the oldest is
+   // evicted early, although the buffer is not full yet.
+   buffer.push("ddddd");
+   ASSERT_EQ(buffer.size(), 4);
+   ASSERT_EQ(buffer.n_live(), 3);
+   ASSERT_EQ(buffer.payload(3), "ddddd");
+
+   auto [payloads, weights, indices] = buffer.sample(4);
+   ASSERT_EQ(payloads.size(), 3);
+   for(size_t i = 0; i < payloads.size(); i++) {
+      ASSERT_NE(indices[i], 0);
+      ASSERT_EQ(payloads[i], buffer.payload(indices[i]));
+   }
+   // the update of the evicted entry is ignored
+   buffer.update({0, 1}, {5., 2.});
+   std::tie(payloads, weights, indices) = buffer.sample(4);
+   ASSERT_EQ(std::count(indices.begin(), indices.end(), 0), 0);
+
+   // overwriting the evicted slot only releases the arena space behind it
+   for(int i = 0; i < 20; i++) {
+      auto payload = std::string(static_cast< size_t >(1 + i % 5), static_cast< char >('e' + i));
+      buffer.push(payload);
+      ASSERT_EQ(buffer.payload((3 + 1 + static_cast< size_t >(i)) % 4), payload);
+      ASSERT_LE(buffer.arena().used(), 16);
+      std::tie(payloads, weights, indices) = buffer.sample(4);
+      ASSERT_EQ(payloads.size(), buffer.n_live());
+      for(size_t k = 0; k < payloads.size(); k++) {
+         ASSERT_EQ(payloads[k], buffer.payload(indices[k]));
+      }
+   }
+}
+
+TEST(ArenaExperience, empty_payloads)
+{
+   per::ArenaExperience buffer(100, 10, 1., 1., 0);
+   buffer.push("aaa");
+   buffer.push("bbbbb");
+   buffer.push("");
+   ASSERT_EQ(buffer.payload(2), "");
+   for(int i = 0; i < 10; i++) {
+      buffer.push("ccc");
+   }
+   ASSERT_EQ(buffer.size(), 13);
+   ASSERT_LE(buffer.arena().used(), 10);
+   // the payloads of early evicted entries are rejected
+   ASSERT_THROW(static_cast< void >(buffer.payload(0)), std::out_of_range);
+   ASSERT_THROW(static_cast< void >(buffer.payload(2)), std::out_of_range);
+   ASSERT_EQ(buffer.payload(12), "ccc");
+}
@@ -0,0 +1,15 @@
+import pyper
+
+
+def test_arena_per():
+    buffer = pyper.ArenaPrioritizedExperience(8, arena_bytes=64, seed=0)
+    payloads = [bytes([v]) * (1 + v % 12) for v in range(30)]
+    for p in payloads:
+        buffer.push(p)
+
+    assert len(buffer) == 8
+    assert buffer.used_bytes <= buffer.arena_bytes == 64
+    values, weights, indices = buffer.sample(8)
+    assert len(values) == buffer.n_live
+    assert all(value == buffer.payload(index) for value, index in zip(values, indices))
+    assert all(value in payloads[-8:] for value in values)
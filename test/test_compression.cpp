@@ -0,0 +1,79 @@
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+using ByteCodec = per::DeltaRLECodec< std::uint8_t >;
+
+TEST(DeltaRLECodec, roundtrip)
+{
+   std::vector< std::vector< std::uint8_t > > payloads{
+      {},
+      {42},
+      {1, 2, 3, 4, 5, 6, 7, 8},
+      std::vector< std::uint8_t >(1000, 7),
+      {0, 255, 0, 255, 3, 3, 3, 3, 3, 9, 200, 17, 17},
+   };
+   // a long, mostly constant image-like payload with a few steps
+   std::vector< std::uint8_t > image(84 * 84, 0);
+   for(size_t i = 0; i < image.size(); i++) {
+      image[i] = static_cast< std::uint8_t >(i / 500);
+   }
+   payloads.emplace_back(image);
+
+   for(const auto& payload : payloads) {
+      ASSERT_EQ(ByteCodec::decode(ByteCodec::encode(payload)), payload);
+   }
+   ASSERT_LT(ByteCodec::encode(image).size() * 10, image.size());
+}
+
+TEST(DeltaRLECodec, roundtrip_wide_types)
+{
+   std::vector< float > floats{0.f, -1.5f, 3.25f, 3.25f, 3.25f, 1e30f, -0.f};
+   ASSERT_EQ(
+      per::DeltaRLECodec< float >::decode(per::DeltaRLECodec< float >::encode(floats)), floats);
+
+   std::vector< std::int64_t > ints(300);
+   for(size_t i = 0; i < ints.size(); i++) {
+      ints[i] = static_cast< std::int64_t >(i) * -3;
+   }
+   ASSERT_EQ(
+      per::DeltaRLECodec< std::int64_t >::decode(per::DeltaRLECodec< std::int64_t >::encode(ints)),
+      ints);
+}
+
+TEST(DeltaRLECodec, corrupt_input)
+{
+   ASSERT_THROW(ByteCodec::decode({1, 2}), std::invalid_argument);
+   auto encoded = ByteCodec::encode(std::vector< std::uint8_t >(100, 1));
+   encoded.pop_back();
+   ASSERT_THROW(ByteCodec::decode(encoded), std::invalid_argument);
+   // a count beyond what the encoded bytes can hold is rejected before allocating for it
+   std::vector< std::uint8_t > huge_count{0, 0, 0, 0, 0, 0, 0, 16, 129, 7};
+   ASSERT_THROW(ByteCodec::decode(huge_count), std::invalid_argument);
+   ASSERT_THROW(per::DeltaRLECodec< double >::decode(huge_count), std::invalid_argument);
+}
+
+TEST(CompressedExperience, sample_matches_uncompressed)
+{
+   for(size_t n_threads : std::vector< size_t >{0, 1, 3}) {
+      per::CompressedExperience< ByteCodec > compressed(20, 1., 1., 0, n_threads);
+      per::PrioritizedExperience< std::vector< std::uint8_t > > plain(20, 1., 1., 0);
+
+      std::vector< std::vector< std::uint8_t > > values;
+      for(size_t v = 0; v < 30; v++) {
+         values.emplace_back(256, static_cast< std::uint8_t >(v));
+      }
+      compressed.push(values);
+      plain.push(values);
+      compressed.update({1, 4}, {3., 5.});
+      plain.update({1, 4}, {3., 5.});
+
+      ASSERT_EQ(compressed.size(), 20);
+      for(int i = 0; i < 5; i++) {
+         ASSERT_EQ(compressed.sample(8), plain.sample(8));
+      }
+      ASSERT_GT(compressed.stats().ratio(), 10.);
+   }
+}
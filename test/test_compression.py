@@ -0,0 +1,21 @@
+import pyper
+
+
+def test_compressed_per():
+    payloads = [bytes([v]) * 512 for v in range(20)]
+    cpe1, cpe2, cpe3 = (
+        pyper.CompressedPrioritizedExperience(10, seed=0),
+        pyper.CompressedPrioritizedExperience(10, seed=0, n_threads=0),
+        pyper.CompressedPrioritizedExperience(10, seed=1)
+    )
+    cpe1.push(payloads)
+    for p in payloads:
+        cpe2.push(p)
+        cpe3.push(p)
+
+    assert len(cpe1) == 10
+    sample1, sample2 = cpe1.sample(5), cpe2.sample(5)
+    assert sample1 == sample2
+    assert sample1 != cpe3.sample(5)
+    assert all(value in payloads[10:] for value in sample1[0])
+    assert cpe1.stats.ratio > 10
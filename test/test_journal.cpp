@@ -0,0 +1,146 @@
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+namespace {
+
+/// a journal path in the temporary directory whose files are removed before and after the test
+struct TemporaryJournal {
+   std::string path;
+
+   explicit TemporaryJournal(const std::string& stem)
+       : path(
+          ::testing::TempDir() + "per_test_" + stem + "_" + std::to_string(getpid()) + ".journal")
+   {
+      remove();
+   }
+   ~TemporaryJournal() { remove(); }
+
+   void remove() const
+   {
+      std::remove(path.c_str());
+      std::remove((path + ".base").c_str());
+   }
+};
+
+template < typename ValueType >
+void expect_same_state(
+   const per::PrioritizedExperience< ValueType >& buffer,
+   const per::PrioritizedExperience< ValueType >& expected)
+{
+   auto state = buffer.state();
+   auto expected_state = expected.state();
+   EXPECT_EQ(state.values, expected_state.values);
+   // the rebuilt tree sums up the priorities in a different order, which may round the weights of
+   // later pushes differently
+   ASSERT_EQ(state.weights.size(), expected_state.weights.size());
+   for(size_t i = 0; i < state.weights.size(); i++) {
+      EXPECT_TRUE(
+         state.weights[i] == expected_state.weights[i]
+         or std::abs(state.weights[i] - expected_state.weights[i])
+               < 1e-12 * expected_state.weights[i]);
+   }
+   EXPECT_EQ(state.priorities, expected_state.priorities);
+   EXPECT_EQ(state.cursor, expected_state.cursor);
+   EXPECT_EQ(state.alpha, expected_state.alpha);
+   EXPECT_EQ(state.beta, expected_state.beta);
+   EXPECT_EQ(state.max_priority, expected_state.max_priority);
+   EXPECT_EQ(state.fresh_priority, expected_state.fresh_priority);
+   EXPECT_EQ(state.max_weight, expected_state.max_weight);
+   EXPECT_EQ(state.rng, expected_state.rng);
+}
+
+}  // namespace
+
+TEST(JournaledExperience, recover)
+{
+   // declared first, so that the files are removed after all buffers are closed
+   TemporaryJournal files("recover");
+   const auto& path = files.path;
+   per::PrioritizedExperience< std::string > expected(8, 0.6, 0.4, 0);
+   {
+      per::JournaledExperience< std::string > journaled(path, 8, 0.6, 0.4, 0);
+      journaled.push("a");
+      expected.push("a");
+      journaled.push(std::vector< std::string >{"bb", "ccc", "dddd", "eeeee", "f", "g", "h", "i"});
+      expected.push(std::vector< std::string >{"bb", "ccc", "dddd", "eeeee", "f", "g", "h", "i"});
+      journaled.update({0, 3, 5}, {0.5, 2., 0.1});
+      expected.update({0, 3, 5}, {0.5, 2., 0.1});
+      // a failing update is neither applied nor journaled
+      ASSERT_THROW(journaled.update({1, 2, 8}, {3., 3., 3.}), std::out_of_range);
+      ASSERT_THROW(journaled.update({1, 2}, {3.}), std::invalid_argument);
+      journaled.alpha(0.8);
+      expected.alpha(0.8);
+      journaled.beta(0.5);
+      expected.beta(0.5);
+      journaled.push("j");
+      expected.push("j");
+      expect_same_state(journaled.buffer(), expected);
+   }
+   // the recorded state overrides the configuration of the constructor
+   per::JournaledExperience< std::string > recovered(path, 8, 1., 1., 42);
+   expect_same_state(recovered.buffer(), expected);
+   ASSERT_THROW(per::JournaledExperience< std::string >(path, 16), std::invalid_argument);
+}
+
+TEST(JournaledExperience, compaction)
+{
+   TemporaryJournal files("compaction");
+   const auto& path = files.path;
+   per::PrioritizedExperience< int > expected(100, 0.7, 0.5, 0);
+   {
+      // a tiny threshold compacts after every record
+      per::JournaledExperience< int > journaled(path, 100, 0.7, 0.5, 0, 0.01, 64);
+      for(int i = 0; i < 150; i++) {
+         journaled.push(i);
+         expected.push(i);
+         if(i % 10 == 0) {
+            journaled.update({static_cast< size_t >(i) % 100}, {0.1 * i});
+            expected.update({static_cast< size_t >(i) % 100}, {0.1 * i});
+         }
+      }
+      ASSERT_GT(journaled.epoch(), 0);
+      ASSERT_LT(journaled.journal_bytes(), 64);
+      journaled.flush();
+   }
+   per::JournaledExperience< int > recovered(path, 100, 1., 1., 1);
+   expect_same_state(recovered.buffer(), expected);
+   // the sampling of the recovered buffer continues from the recovered state
+   auto [values, weights, indices] = recovered.sample(10);
+   auto [expected_values, expected_weights, expected_indices] = expected.sample(10);
+   ASSERT_EQ(indices, expected_indices);
+}
+
+TEST(JournaledExperience, torn_record)
+{
+   TemporaryJournal files("torn");
+   const auto& path = files.path;
+   per::PrioritizedExperience< double > expected(10, 1., 1., 0);
+   {
+      per::JournaledExperience< double > journaled(path, 10, 1., 1., 0);
+      journaled.push(std::vector< double >{1., 2., 3.});
+      expected.push(std::vector< double >{1., 2., 3.});
+      journaled.update({1}, {4.});
+      expected.update({1}, {4.});
+   }
+   {
+      // a crash in the middle of a write leaves an incomplete record behind
+      std::ofstream journal(path, std::ios::binary | std::ios::app);
+      per::JournalRecordHeader header{per::JournalOp::push, {0, 0, 0}, 0, 8};
+      journal.write(reinterpret_cast< const char* >(&header), sizeof(header));
+      journal.write("\x01\x02", 2);
+   }
+   {
+      per::JournaledExperience< double > recovered(path, 10);
+      expect_same_state(recovered.buffer(), expected);
+      // the torn record is cut off, so that new records directly follow the intact ones
+      recovered.push(5.);
+      expected.push(5.);
+   }
+   per::JournaledExperience< double > recovered(path, 10);
+   expect_same_state(recovered.buffer(), expected);
+}
@@ -0,0 +1,21 @@
+import pyper
+
+
+def test_journal_recover(tmp_path):
+    path = str(tmp_path / "buffer.journal")
+
+    buffer = pyper.JournaledPrioritizedExperience(path, 4, alpha=0.6, beta=0.4, seed=0)
+    buffer.push(b"a")
+    buffer.push([b"bb", b"ccc", b"dddd", b"eeeee"])
+    buffer.update([1, 2], [0.5, 2.0])
+    buffer.alpha = 0.8
+    buffer.flush()
+    assert buffer.journal_bytes > 0
+    del buffer
+
+    recovered = pyper.JournaledPrioritizedExperience(path, 4, seed=1)
+    assert len(recovered) == 4
+    assert recovered.alpha == 0.8
+    assert recovered.beta == 0.4
+    values, weights, indices = recovered.sample(16)
+    assert all(value in (b"bb", b"ccc", b"dddd", b"eeeee") for value in values)
@@ -0,0 +1,73 @@
+#include <limits>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(MultiBuffer, routes_pushes_and_updates)
+{
+   per::MultiBuffer< int > multi(3, 10, 1., 1., 0);
+   multi.push(0, std::vector< int >{0, 1, 2});
+   multi.push(2, 20);
+   ASSERT_EQ(multi.size(), 4);
+   ASSERT_EQ(multi.buffer(0).size(), 3);
+   ASSERT_EQ(multi.buffer(1).size(), 0);
+   ASSERT_NEAR(multi.total(), 4., 1e-12);
+   ASSERT_THROW(multi.push(3, 0), std::out_of_range);
+
+   multi.update({2, 0}, {0, 1}, {5., 0.});
+   ASSERT_NEAR(multi.buffer(2).total(), 5., 1e-12);
+   ASSERT_NEAR(multi.buffer(0).total(), 2., 1e-12);
+   ASSERT_NEAR(multi.total(), 7., 1e-12);
+}
+
+TEST(MultiBuffer, samples_across_buffers)
+{
+   per::MultiBuffer< int > multi(3, 10, 1., 1., 0);
+   for(int b = 0; b < 3; b++) {
+      for(int i = 0; i < 5; i++) {
+         multi.push(static_cast< size_t >(b), 10 * b + i);
+      }
+   }
+   // requesting more than all buffers hold returns every sample exactly once
+   auto [values, weights, buffers, indices] = multi.sample(20);
+   ASSERT_EQ(values.size(), 15);
+   std::set< int > unique(values.begin(), values.end());
+   ASSERT_EQ(unique.size(), 15);
+   for(size_t i = 0; i < values.size(); i++) {
+      ASSERT_EQ(values[i], 10 * static_cast< int >(buffers[i]) + static_cast< int >(indices[i]));
+   }
+   ASSERT_NEAR(multi.total(), 15., 1e-12);
+
+   // excluded buffers are never drawn from
+   multi.mixing_weights({0., 1., 0.});
+   ASSERT_NEAR(multi.total(), 5., 1e-12);
+   for(int round = 0; round < 10; round++) {
+      auto batch = multi.sample(3);
+      ASSERT_EQ(std::get< 0 >(batch).size(), 3);
+      for(auto b : std::get< 2 >(batch)) {
+         ASSERT_EQ(b, 1);
+      }
+   }
+   ASSERT_THROW(multi.mixing_weights({1., 1.}), std::invalid_argument);
+   ASSERT_THROW(
+      multi.mixing_weights({1., std::numeric_limits< double >::infinity(), 1.}),
+      std::invalid_argument);
+   ASSERT_THROW(
+      multi.mixing_weights({1., std::numeric_limits< double >::quiet_NaN(), 1.}),
+      std::invalid_argument);
+}
+
+TEST(MultiBuffer, reproducibility)
+{
+   per::MultiBuffer< int > multi1(4, 8, 1., 1., 42);
+   per::MultiBuffer< int > multi2(4, 8, 1., 1., 42);
+   for(int i = 0; i < 30; i++) {
+      auto b = static_cast< size_t >(i % 4);
+      multi1.push(b, i);
+      multi2.push(b, i);
+   }
+   for(int round = 0; round < 5; round++) {
+      ASSERT_EQ(multi1.sample(6), multi2.sample(6));
+   }
+}
@@ -0,0 +1,38 @@
+import pytest
+
+import pyper
+
+
+def test_multi_buffer_routing():
+    multi = pyper.MultiBuffer(3, capacity=10, seed=0)
+    multi.push(0, ["a", "b", "c"])
+    multi.push(2, "z")
+    assert len(multi) == 4
+    assert multi.n_buffers == 3
+    assert len(multi.buffer(0)) == 3
+    assert multi.total == 4.
+
+    multi.update([2, 0], [0, 1], [5., 0.])
+    assert multi.buffer(2).total == 5.
+    # the sub-buffers are read-only
+    assert not hasattr(multi.buffer(2), "update")
+    assert abs(multi.total - 7.) < 1e-12
+
+
+def test_multi_buffer_sample():
+    multi = pyper.MultiBuffer(3, capacity=10, seed=0)
+    for b in range(3):
+        multi.push(b, [(b, i) for i in range(5)])
+
+    values, weights, buffers, indices = multi.sample(20)
+    assert len(values) == 15
+    assert sorted(values) == [(b, i) for b in range(3) for i in range(5)]
+    assert all(value == (b, i) for value, b, i in zip(values, buffers, indices))
+
+    multi.mixing_weights = [0., 1., 0.]
+    assert multi.mixing_weights == [0., 1., 0.]
+    with pytest.raises(ValueError):
+        multi.mixing_weights = [0., float("inf"), 0.]
+    for _ in range(10):
+        _, _, buffers, _ = multi.sample(3)
+        assert buffers == [1, 1, 1]
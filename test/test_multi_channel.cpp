@@ -0,0 +1,90 @@
+#include <set>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(MultiChannelExperience, channels_match_separate_buffers)
+{
+   std::vector< double > alphas{1., 0.5};
+   std::vector< double > betas{1., 0.4};
+   per::MultiChannelExperience< int > multi(5, alphas, betas, 0);
+   std::vector< per::PrioritizedExperience< int > > separate;
+   for(size_t c = 0; c < 2; c++) {
+      separate.emplace_back(5, alphas[c], betas[c], 0);
+   }
+   ASSERT_EQ(multi.n_channels(), 2);
+
+   for(int i = 0; i < 8; i++) {
+      multi.push(i);
+      for(auto& buffer : separate) {
+         buffer.push(i);
+      }
+      multi.update({static_cast< size_t >(i) % 5}, {1. + i}, 0);
+      separate[0].update({static_cast< size_t >(i) % 5}, {1. + i});
+      multi.update({static_cast< size_t >(i) % 5}, {0.5 * (8 - i)}, 1);
+      separate[1].update({static_cast< size_t >(i) % 5}, {0.5 * (8 - i)});
+   }
+   ASSERT_EQ(multi.size(), 5);
+   for(size_t c = 0; c < 2; c++) {
+      ASSERT_NEAR(multi.total(c), separate[c].total(), 1e-12);
+      // the channels share the random stream, which advances once per sampled batch
+      auto [values, weights, indices] = multi.sample(3, c);
+      auto [ref_values, ref_weights, ref_indices] = separate[c].sample(3);
+      separate[1 - c].sample(0);
+      ASSERT_EQ(values, ref_values);
+      ASSERT_EQ(indices, ref_indices);
+      for(size_t i = 0; i < weights.size(); i++) {
+         ASSERT_NEAR(weights[i], ref_weights[i], 1e-12);
+      }
+   }
+}
+
+TEST(MultiChannelExperience, independent_priorities)
+{
+   per::MultiChannelExperience< int > multi(4, {1., 1.}, {1., 1.}, 0);
+   multi.push(std::vector< int >{0, 1, 2, 3});
+   multi.update({0, 1, 2, 3}, {1., 0., 0., 0.}, 0);
+   multi.update({0, 1, 2, 3}, {0., 0., 0., 1.}, 1);
+   for(int i = 0; i < 10; i++) {
+      ASSERT_EQ(std::get< 0 >(multi.sample(1, 0)), std::vector< int >{0});
+      ASSERT_EQ(std::get< 0 >(multi.sample(1, 1)), std::vector< int >{3});
+   }
+   multi.update({1, 2, 3}, {1., 1., 1.}, 0);
+   auto values = std::get< 0 >(multi.sample(10, 0));
+   ASSERT_EQ(std::set< int >(values.begin(), values.end()).size(), 4);
+
+   ASSERT_THROW(multi.sample(1, 2), std::out_of_range);
+   ASSERT_THROW((per::MultiChannelExperience< int >(4, {1.}, {1., 1.})), std::invalid_argument);
+}
+
+TEST(MultiChannelExperience, bulk_push)
+{
+   std::vector< double > alphas{1., 0.6};
+   std::vector< double > betas{1., 0.4};
+   per::MultiChannelExperience< int > sequential(10, alphas, betas, 0);
+   per::MultiChannelExperience< int > bulk(10, alphas, betas, 0);
+   int value = 0;
+   for(size_t batch : std::vector< size_t >{6, 9, 25}) {
+      std::vector< int > values;
+      for(size_t i = 0; i < batch; i++) {
+         values.push_back(value);
+         sequential.push(value++);
+      }
+      bulk.push(std::move(values));
+      for(size_t c = 0; c < 2; c++) {
+         auto [bulk_values, bulk_weights, bulk_indices] = bulk.sample(5, c);
+         auto [seq_values, seq_weights, seq_indices] = sequential.sample(5, c);
+         ASSERT_EQ(bulk_values, seq_values);
+         ASSERT_EQ(bulk_indices, seq_indices);
+         for(size_t i = 0; i < bulk_weights.size(); i++) {
+            // the running total of the bulk push may differ from the tree's sum by rounding only
+            ASSERT_TRUE(
+               bulk_weights[i] == seq_weights[i]
+               or std::abs(bulk_weights[i] - seq_weights[i]) < 1e-12);
+         }
+         // priorities below the maximum keep the maximum priority fixed for the next pushes
+         bulk.update(bulk_indices, {0.5, 0.2, 1., 0.3, 0.1}, c);
+         sequential.update(seq_indices, {0.5, 0.2, 1., 0.3, 0.1}, c);
+      }
+   }
+}
@@ -0,0 +1,18 @@
+import pyper
+
+
+def test_multi_channel():
+    multi = pyper.MultiChannelExperience(4, alphas=[1., 0.5], betas=[1., 1.], seed=0)
+    for value in ["a", "b", "c", "d"]:
+        multi.push(value)
+    assert len(multi) == 4
+    assert multi.n_channels == 2
+    assert multi.alpha(1) == 0.5
+
+    multi.update([0, 1, 2, 3], [1., 0., 0., 0.], channel=0)
+    multi.update([0, 1, 2, 3], [0., 0., 0., 4.], channel=1)
+    assert multi.total(0) == 1.
+    assert multi.total(1) == 2.
+    for _ in range(5):
+        assert multi.sample(1, channel=0)[0] == ["a"]
+        assert multi.sample(1, channel=1)[0] == ["d"]
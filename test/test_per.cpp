@@ -1,4 +1,7 @@
 
+#include <map>
+#include <set>
+
 #include <pybind11/embed.h>
 #include <pybind11/pybind11.h>
 
@@ -74,3 +77,244 @@ TEST(PrioritizedExperience, sample)
       sample_vs.begin(), sample_vs.end(), [](auto v) { return py::cast< size_t >(v) == 0; }));
    ASSERT_TRUE(std::all_of(sample_is.begin(), sample_is.end(), [](auto v) { return v == 0; }));
 }
+
+TEST(PrioritizedExperience, rng_state)
+{
+   per::PrioritizedExperience< int > per(20, 1., 1., 3);
+   for(int v = 0; v < 20; v++) {
+      per.push(v);
+   }
+   per.sample(4);
+   auto state = per.rng();
+   auto sample1 = per.sample(6);
+   auto sample2 = per.sample(6);
+   ASSERT_NE(sample1, sample2);
+
+   per.rng(per::CounterRng{state.seed(), state.counter()});
+   ASSERT_EQ(per.sample(6), sample1);
+   ASSERT_EQ(per.sample(6), sample2);
+}
+
+TEST(PrioritizedExperience, stale_handles)
+{
+   per::PrioritizedExperience< int > per(4, 1., 1., 0);
+   for(int v = 0; v < 4; v++) {
+      per.push(v);
+   }
+   auto [values, weights, handles] = per.sample_handles(4);
+   ASSERT_EQ(handles.size(), 4);
+   for(size_t i = 0; i < handles.size(); i++) {
+      ASSERT_EQ(static_cast< size_t >(values[i]), handles[i].index);
+      ASSERT_EQ(handles[i].generation, 1);
+   }
+   // overwrite the first two slots, which invalidates the handles pointing at them
+   per.push(std::vector< int >{4, 5});
+   ASSERT_EQ(per.update_handles(handles, {10., 10., 10., 10.}), 2);
+
+   std::vector< double > priorities(4, 1.);
+   auto [new_values, new_weights, new_handles] = per.sample_handles(4);
+   ASSERT_EQ(per.update_handles(new_handles, priorities), 4);
+   ASSERT_THROW(per.update_handles(new_handles, {1.}), std::invalid_argument);
+}
+
+TEST(PrioritizedExperience, bulk_push)
+{
+   per::PrioritizedExperience< int > sequential(10, 0.6, 0.4, 0);
+   per::PrioritizedExperience< int > bulk(10, 0.6, 0.4, 0);
+   int value = 0;
+   for(size_t batch : std::vector< size_t >{4, 9, 25}) {
+      std::vector< int > values;
+      for(size_t i = 0; i < batch; i++) {
+         values.push_back(value);
+         sequential.push(value++);
+      }
+      bulk.push(std::move(values));
+      auto [bulk_values, bulk_weights, bulk_indices] = bulk.sample(5);
+      auto [seq_values, seq_weights, seq_indices] = sequential.sample(5);
+      ASSERT_EQ(bulk_values, seq_values);
+      ASSERT_EQ(bulk_indices, seq_indices);
+      for(size_t i = 0; i < bulk_weights.size(); i++) {
+         // the running total of the bulk push may differ from the tree's sum by rounding only
+         ASSERT_TRUE(
+            bulk_weights[i] == seq_weights[i]
+            or std::abs(bulk_weights[i] - seq_weights[i]) < 1e-12);
+      }
+      // priorities below the maximum keep the maximum priority fixed for the next pushes
+      bulk.update(bulk_indices, {0.5, 0.2, 1., 0.3, 0.1});
+      sequential.update(seq_indices, {0.5, 0.2, 1., 0.3, 0.1});
+   }
+}
+
+TEST(PrioritizedExperience, lowest_priority_eviction)
+{
+   per::PrioritizedExperience< int > per(4, 1., 1., 0, per::EvictionPolicy::lowest_priority);
+   per.push(std::vector< int >{0, 1, 2, 3});
+   per.update({0, 1, 2, 3}, {5., 0.1, 5., 5.});
+   // the new samples replace the least important ones instead of the oldest ones
+   per.push(4);
+   per.push(5);
+   auto [values, weights, indices] = per.sample(4);
+   std::sort(values.begin(), values.end());
+   ASSERT_EQ(values, (std::vector< int >{0, 2, 3, 5}));
+}
+
+TEST(PrioritizedExperience, snapshot_sampling)
+{
+   per::PrioritizedExperience< int > per(8, 1., 1., 0);
+   per.push(std::vector< int >{0, 1, 2, 3, 4, 5});
+   per.update({0, 1, 2, 3, 4, 5}, {0., 1., 0., 2., 0., 1.});
+   ASSERT_FALSE(per.has_snapshot());
+   per.build_snapshot();
+   ASSERT_TRUE(per.has_snapshot());
+   // regular sampling restores the priorities and leaves the snapshot valid
+   per.sample(2);
+   ASSERT_TRUE(per.has_snapshot());
+
+   std::map< int, size_t > counts;
+   size_t n = 40000;
+   auto [values, weights, indices] = per.sample_snapshot(n);
+   ASSERT_EQ(values.size(), n);
+   for(size_t i = 0; i < n; i++) {
+      ASSERT_EQ(values[i], static_cast< int >(indices[i]));
+      counts[values[i]]++;
+   }
+   ASSERT_EQ(counts.size(), 3);
+   ASSERT_NEAR(static_cast< double >(counts[3]) / static_cast< double >(n), 0.5, 0.01);
+
+   per.update({0}, {1.});
+   ASSERT_FALSE(per.has_snapshot());
+   // an outdated snapshot is rebuilt on demand
+   std::tie(values, weights, indices) = per.sample_snapshot(n);
+   ASSERT_TRUE(per.has_snapshot());
+   ASSERT_NE(std::find(values.begin(), values.end(), 0), values.end());
+
+   // repeated multi-threaded builds reuse their threads and yield the same draws as a serial build
+   auto rng = per.rng();
+   per.build_snapshot(2);
+   per.build_snapshot(2);
+   auto threaded = per.sample_snapshot(100);
+   per.rng(per::CounterRng{rng.seed(), rng.counter()});
+   per.build_snapshot();
+   ASSERT_EQ(per.sample_snapshot(100), threaded);
+}
+
+TEST(PrioritizedExperience, decay_priorities)
+{
+   per::PrioritizedExperience< int > per(8, 0.5, 1., 0);
+   per.push(std::vector< int >{0, 1, 2, 3});
+   per.update({0, 1, 2, 3}, {4., 4., 4., 4.});
+   per.build_snapshot();
+   per.decay_priorities(0.25);
+   // the relative priorities are unchanged
+   ASSERT_TRUE(per.has_snapshot());
+   ASSERT_NEAR(per.total(), 4., 1e-12);
+   // the maximum priority (initially 1) is not decayed, hence a new sample takes a fifth of the
+   // total instead of the ninth it would take without the decay
+   per.push(4);
+   ASSERT_NEAR(per.total(), 5., 1e-12);
+   ASSERT_NEAR((per.total() - 4.) / per.total(), 0.2, 1e-12);
+   per.update({4}, {4.});
+   ASSERT_NEAR(per.total(), 6., 1e-12);
+}
+
+TEST(PrioritizedExperience, decay_and_wrap)
+{
+   per::PrioritizedExperience< int > per(4, 1., 1., 0);
+   per.push(std::vector< int >{0, 1, 2, 3});
+   per.update({0, 1, 2, 3}, {1., 1., 1., 1.});
+   per.decay_priorities(0.5);
+   // the fresh samples evict the decayed ones one by one
+   for(int i = 4; i < 8; i++) {
+      per.push(i);
+      ASSERT_NEAR(per.total(), 0.5 * (7 - i) + (i - 3), 1e-12);
+   }
+   // wrapping around evicts the holders of the maximum, which keeps the undecayed priority
+   for(int i = 8; i < 14; i++) {
+      per.push(i);
+      ASSERT_NEAR(per.total(), 4., 1e-12);
+   }
+   per.decay_priorities(0.25);
+   per.push(std::vector< int >{14, 15});
+   ASSERT_NEAR(per.total(), 0.5 + 2., 1e-12);
+   // a state round trip keeps the priority of new samples
+   per::PrioritizedExperience< int > restored(4, 1., 1., 1);
+   restored.restore(per.state());
+   restored.push(16);
+   per.push(16);
+   ASSERT_NEAR(restored.total(), per.total(), 1e-12);
+   ASSERT_NEAR(per.total(), 0.25 + 3., 1e-12);
+
+   // evicting the only holder of the maximum after a decay lowers the priority of new samples.
+   // The decayed tree cannot reproduce the undecayed maximum exactly for this factor.
+   per::PrioritizedExperience< int > shrunk(3, 1., 1., 0);
+   shrunk.push(std::vector< int >{0, 1, 2});
+   shrunk.decay_priorities(1. / 93.);
+   shrunk.push(std::vector< int >{3, 4, 5});
+   shrunk.update({1, 2}, {0.5, 0.5});
+   shrunk.resize(2);
+   shrunk.push(6);
+   ASSERT_NEAR(shrunk.total(), 1., 1e-12);
+}
+
+TEST(PrioritizedExperience, resize)
+{
+   per::PrioritizedExperience< int > per(4, 1., 1., 0);
+   per.push(std::vector< int >{0, 1, 2, 3, 4, 5});
+   per.update({0, 1, 2, 3}, {5., 6., 3., 4.});
+   per.reserve(2);
+   ASSERT_EQ(per.capacity(), 4);
+   per.reserve(6);
+   ASSERT_EQ(per.capacity(), 6);
+   ASSERT_EQ(per.size(), 4);
+   ASSERT_EQ(per.cursor(), 4);
+   ASSERT_NEAR(per.total(), 18., 1e-12);
+   per.push(6);
+   ASSERT_EQ(per.size(), 5);
+
+   // shrinking evicts the oldest samples 2, 3 and 4, whose priorities are 3, 4 and 5
+   per.resize(2);
+   ASSERT_EQ(per.size(), 2);
+   ASSERT_NEAR(per.total(), 7., 1e-12);
+   auto [values, weights, indices] = per.sample(2);
+   std::sort(values.begin(), values.end());
+   ASSERT_EQ(values, (std::vector< int >{5, 6}));
+}
+
+TEST(PrioritizedExperience, sweep_sampling)
+{
+   size_t capacity = 1000;
+   per::PrioritizedExperience< int > per(capacity, 1., 1., 0);
+   std::vector< size_t > indices(capacity);
+   std::vector< double > priorities(capacity);
+   for(size_t i = 0; i < capacity; i++) {
+      per.push(static_cast< int >(i));
+      indices[i] = i;
+      priorities[i] = 1. + static_cast< double >(i % 10);
+   }
+   // a single sample heavier than many strata
+   priorities[3] = 2000.;
+   per.update(indices, priorities);
+   double total = per.total();
+
+   // the sweep is opt-in, hence large batches are drawn sequentially by default
+   per::PrioritizedExperience< int > sequential(capacity, 1., 1., 0);
+   sequential.push(std::vector< int >(capacity, 0));
+   sequential.update(indices, priorities);
+   sequential.sweep_threshold(2.);
+   auto default_drawn = std::get< 2 >(per.sample(500));
+   ASSERT_EQ(default_drawn, std::get< 2 >(sequential.sample(500)));
+
+   for(double threshold : {1. / 16., 2.}) {
+      per.sweep_threshold(threshold);
+      for(size_t n : std::vector< size_t >{128, 500, 1000}) {
+         auto [values, weights, drawn] = per.sample(n);
+         ASSERT_EQ(drawn.size(), n);
+         ASSERT_EQ(std::set< size_t >(drawn.begin(), drawn.end()).size(), n);
+         ASSERT_NE(std::find(drawn.begin(), drawn.end(), 3), drawn.end());
+         for(size_t i = 0; i < n; i++) {
+            ASSERT_EQ(static_cast< size_t >(values[i]), drawn[i]);
+         }
+         ASSERT_NEAR(per.total(), total, 1e-9);
+      }
+   }
+}
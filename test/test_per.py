@@ -28,3 +28,61 @@ def test_per():
     assert per1.sample(5) == per2.sample(5)
     assert per1.sample(5) != per3.sample(5)
 
+
+
+def test_bulk_push():
+    per = pyper.PrioritizedExperience(10, seed=0)
+    per.push([0, 1, 2])
+    per.push((3, 4))
+    assert len(per) == 4
+    values, weights, indices = per.sample(20)
+    assert set(values) <= {0, 1, 2, (3, 4)}
+
+
+def test_rng_state():
+    per = pyper.PrioritizedExperience(10, seed=3)
+    for v in values:
+        per.push(v)
+    per.sample(2)
+    state = per.rng_state
+    sample = per.sample(5)
+    per.rng_state = state
+    assert per.sample(5) == sample
+
+
+def test_stale_handles():
+    per = pyper.PrioritizedExperience(4, seed=0)
+    for v in range(4):
+        per.push(v)
+    values, weights, handles = per.sample_handles(4)
+    assert [h.index for h in handles] == values
+    assert all(h.generation == 1 for h in handles)
+
+    # overwriting two slots invalidates the handles pointing at them
+    per.push([4, 5])
+    assert per.update(handles, [10.0] * 4) == 2
+
+
+def test_lowest_priority_eviction():
+    per = pyper.PrioritizedExperience(4, seed=0, policy=pyper.EvictionPolicy.lowest_priority)
+    for v in range(4):
+        per.push(v)
+    per.update([0, 1, 2, 3], [5.0, 0.1, 5.0, 5.0])
+    per.push(4)
+    values, weights, indices = per.sample(4)
+    assert sorted(values) == [0, 2, 3, 4]
+
+
+def test_snapshot_sampling():
+    per = pyper.PrioritizedExperience(8, seed=0)
+    per.push([0, 1, 2, 3])
+    per.update([0, 1, 2, 3], [0.0, 1.0, 0.0, 3.0])
+    per.build_snapshot()
+    assert per.has_snapshot
+    values, weights, indices = per.sample_snapshot(1000)
+    assert values == indices
+    assert set(values) == {1, 3}
+    assert 600 < values.count(3) < 900
+
+    per.push(4)
+    assert not per.has_snapshot
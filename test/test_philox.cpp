@@ -0,0 +1,43 @@
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(Philox4x32, known_answers)
+{
+   // known answer tests of the reference implementation (Random123)
+   using result_type = per::Philox4x32::result_type;
+   ASSERT_EQ(
+      per::Philox4x32::generate({0, 0, 0, 0}, {0, 0}),
+      (result_type{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+   ASSERT_EQ(
+      per::Philox4x32::generate(
+         {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+      (result_type{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+   ASSERT_EQ(
+      per::Philox4x32::generate(
+         {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+      (result_type{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(CounterRng, order_independence)
+{
+   per::CounterRng rng(42);
+   std::vector< double > forward;
+   for(size_t slot = 0; slot < 100; slot++) {
+      forward.emplace_back(rng.uniform(slot));
+   }
+   for(size_t slot = 100; slot > 0; slot--) {
+      ASSERT_EQ(rng.uniform(slot - 1), forward[slot - 1]);
+   }
+   ASSERT_TRUE(std::all_of(forward.begin(), forward.end(), [](double u) {
+      return 0. <= u and u < 1.;
+   }));
+
+   auto restored = per::CounterRng(rng.seed(), rng.counter());
+   rng.advance();
+   ASSERT_NE(rng, restored);
+   ASSERT_NE(rng.uniform(0), restored.uniform(0));
+   restored.advance();
+   ASSERT_EQ(rng.uniform(0), restored.uniform(0));
+   ASSERT_NE(per::CounterRng(43).uniform(0), per::CounterRng(42).uniform(0));
+}
@@ -0,0 +1,45 @@
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(PrefetchingSampler, matches_sequential_sampling)
+{
+   per::PrioritizedExperience< int > buffer(50, 1., 1., 0);
+   per::PrioritizedExperience< int > reference(50, 1., 1., 0);
+   for(int i = 0; i < 60; i++) {
+      buffer.push(i);
+      reference.push(i);
+   }
+   per::PrefetchingSampler< int > sampler(buffer, 8, 3);
+   for(int i = 0; i < 10; i++) {
+      auto batch = sampler.next();
+      ASSERT_TRUE(batch.has_value());
+      ASSERT_EQ(batch.value(), reference.sample(8));
+   }
+}
+
+TEST(PrefetchingSampler, waits_for_enough_samples)
+{
+   per::PrioritizedExperience< int > buffer(50, 1., 1., 0);
+   per::PrefetchingSampler< int > sampler(buffer, 4, 2);
+   for(int i = 0; i < 4; i++) {
+      sampler.push(i);
+   }
+   auto batch = sampler.next();
+   ASSERT_TRUE(batch.has_value());
+   ASSERT_EQ(std::get< 0 >(batch.value()).size(), 4);
+
+   // only entry 2 remains sampleable as first draw after the update was applied
+   sampler.update({0, 1, 2, 3}, {0., 0., 1., 0.});
+   sampler.push(std::vector< int >{4, 5});
+   sampler.update({4, 5}, {0., 0.});
+   bool seen_update = false;
+   for(int i = 0; i < 5 and not seen_update; i++) {
+      auto [values, weights, indices] = sampler.next().value();
+      seen_update = indices.front() == 2 and values.front() == 2;
+   }
+   ASSERT_TRUE(seen_update);
+
+   sampler.stop();
+   ASSERT_FALSE(sampler.next().has_value());
+}
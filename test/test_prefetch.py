@@ -0,0 +1,20 @@
+import pyper
+
+
+def test_prefetching_sampler():
+    per = pyper.PrioritizedExperience(10, seed=0)
+    reference = pyper.PrioritizedExperience(10, seed=0)
+    sampler = pyper.PrefetchingSampler(per, batch_size=4, n_prefetch=3)
+
+    values = [bool(0), 1, (2,), [3], {4: None}, [5, []], 7., "9"]
+    sampler.push(values)
+    reference.push(values)
+
+    assert len(per) == len(reference) == len(values)
+
+    for batch, _ in zip(sampler, range(5)):
+        assert len(batch[0]) == 4
+        assert batch == reference.sample(4)
+
+    sampler.close()
+    assert list(sampler) == []
@@ -0,0 +1,71 @@
+#include <map>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(RankBasedExperience, heap_ranks)
+{
+   per::RankBasedExperience< int > rank_based(6, 1., 1., 0);
+   rank_based.push(std::vector< int >{0, 1, 2, 3, 4});
+   rank_based.update({0, 1, 2, 3, 4}, {1., 5., 3., 2., 4.});
+   rank_based.sort();
+   std::vector< size_t > ranks;
+   for(size_t i = 0; i < rank_based.size(); i++) {
+      ranks.emplace_back(rank_based.rank(i));
+   }
+   ASSERT_EQ(ranks, (std::vector< size_t >{5, 1, 3, 4, 2}));
+   // new samples enter at the maximum priority, i.e. at the top of the heap
+   rank_based.push(5);
+   ASSERT_EQ(rank_based.rank(5), 1);
+   // the oldest sample is overwritten once full
+   rank_based.push(6);
+   ASSERT_EQ(rank_based.size(), 6);
+   ASSERT_LE(rank_based.rank(0), 2);
+   ASSERT_THROW(rank_based.update({7}, {1.}), std::out_of_range);
+}
+
+TEST(RankBasedExperience, segment_sampling)
+{
+   size_t capacity = 100;
+   per::RankBasedExperience< int > rank_based(capacity, 0.7, 0.5, 0);
+   std::vector< size_t > indices(capacity);
+   std::vector< double > priorities(capacity);
+   for(size_t i = 0; i < capacity; i++) {
+      rank_based.push(static_cast< int >(i));
+      indices[i] = i;
+      priorities[i] = static_cast< double >(i);
+   }
+   rank_based.update(indices, priorities);
+
+   // the segments are disjoint, hence every batch holds distinct samples
+   for(size_t batch : std::vector< size_t >{1, 10, 100}) {
+      auto [values, weights, drawn] = rank_based.sample(batch);
+      ASSERT_EQ(values.size(), batch);
+      ASSERT_EQ(std::set< int >(values.begin(), values.end()).size(), batch);
+      for(double weight : weights) {
+         ASSERT_GT(weight, 0.);
+         ASSERT_LE(weight, 1.);
+      }
+   }
+   ASSERT_EQ(std::get< 0 >(rank_based.sample(200)).size(), capacity);
+
+   // single draws follow the power law of the ranks
+   std::map< int, size_t > counts;
+   size_t n = 100000;
+   for(size_t i = 0; i < n; i++) {
+      counts[std::get< 0 >(rank_based.sample(1))[0]]++;
+   }
+   double total = 0.;
+   for(size_t r = 1; r <= capacity; r++) {
+      total += std::pow(static_cast< double >(r), -0.7);
+   }
+   for(int rank : {1, 2, 10}) {
+      double expected = std::pow(static_cast< double >(rank), -0.7) / total;
+      ASSERT_NEAR(
+         static_cast< double >(counts[static_cast< int >(capacity) - rank])
+            / static_cast< double >(n),
+         expected,
+         0.01);
+   }
+}
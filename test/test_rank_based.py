@@ -0,0 +1,16 @@
+import pyper
+
+
+def test_rank_based():
+    buffer = pyper.RankBasedExperience(10, alpha=0.7, beta=0.5, seed=0)
+    for value in range(10):
+        buffer.push(value)
+    buffer.update(list(range(10)), [float(v) for v in range(10)])
+    buffer.sort()
+    assert buffer.rank(9) == 1
+    assert buffer.rank(0) == 10
+
+    values, weights, indices = buffer.sample(5)
+    assert len(set(values)) == 5
+    assert values == indices
+    assert all(0. < w <= 1. for w in weights)
@@ -0,0 +1,74 @@
+
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(RateLimiter, admission)
+{
+   per::RateLimiter limiter(2., 4, 4.);
+   ASSERT_FALSE(limiter.can_sample(1));
+   limiter.inserted(4);
+   // the difference is now at its target 2 * 4 = 8, which tolerates +-4
+   ASSERT_TRUE(limiter.can_sample(4));
+   ASSERT_FALSE(limiter.can_sample(5));
+   ASSERT_TRUE(limiter.can_insert(2));
+   ASSERT_FALSE(limiter.can_insert(3));
+   limiter.sampled(4);
+   ASSERT_FALSE(limiter.can_sample(1));
+   ASSERT_TRUE(limiter.can_insert(4));
+   ASSERT_FALSE(limiter.admissible_sample(9));
+
+   ASSERT_THROW(per::RateLimiter(0., 1, 1.), std::invalid_argument);
+   ASSERT_THROW(per::RateLimiter(4., 1, 2.), std::invalid_argument);
+}
+
+TEST(RateLimitedExperience, timeouts)
+{
+   per::PrioritizedExperience< int > buffer(100, 1., 1., 0);
+   per::RateLimitedExperience< int > limited(buffer, per::RateLimiter(1., 2, 2.));
+
+   ASSERT_FALSE(limited.sample(1, 0.01).has_value());
+   ASSERT_EQ(limited.push(std::vector< int >{0, 1, 2, 3, 4}, 0.01), 4);
+   ASSERT_FALSE(limited.push(5, 0.));
+   auto batch = limited.sample(2, 0.);
+   ASSERT_TRUE(batch.has_value());
+   ASSERT_EQ(std::get< 0 >(batch.value()).size(), 2);
+   ASSERT_TRUE(limited.push(5, 0.));
+
+   auto stats = limited.stats();
+   ASSERT_EQ(stats.inserts, 5);
+   ASSERT_EQ(stats.samples, 2);
+   ASSERT_EQ(stats.insert_timeouts, 2);
+   ASSERT_EQ(stats.sample_timeouts, 1);
+   ASSERT_GT(stats.sample_wait_seconds, 0.);
+   ASSERT_THROW(limited.sample(5), std::invalid_argument);
+}
+
+TEST(RateLimitedExperience, balances_threads)
+{
+   per::PrioritizedExperience< int > buffer(1000, 1., 1., 0);
+   per::RateLimitedExperience< int > limited(buffer, per::RateLimiter(4., 8, 16.));
+
+   std::thread actor([&] {
+      for(int v = 0; v < 200; v++) {
+         ASSERT_TRUE(limited.push(v));
+      }
+   });
+   size_t sampled = 0;
+   while(sampled < 200 * 4 - 16) {
+      auto batch = limited.sample(8);
+      ASSERT_TRUE(batch.has_value());
+      sampled += std::get< 0 >(batch.value()).size();
+   }
+   actor.join();
+   auto stats = limited.stats();
+   ASSERT_EQ(stats.inserts, 200);
+   ASSERT_EQ(stats.samples, sampled);
+
+   // a stopped buffer releases blocked callers
+   std::thread learner([&] { ASSERT_FALSE(limited.sample(16).has_value()); });
+   limited.stop();
+   learner.join();
+   ASSERT_FALSE(limited.push(0));
+}
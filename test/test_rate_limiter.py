@@ -0,0 +1,32 @@
+import threading
+
+import pyper
+
+
+def test_rate_limited_experience():
+    per = pyper.PrioritizedExperience(100, seed=0)
+    limited = pyper.RateLimitedExperience(
+        per, pyper.RateLimiter(samples_per_insert=2.0, min_size_to_sample=4, error_buffer=8.0)
+    )
+
+    assert limited.sample(2, timeout=0.01) is None
+
+    def act():
+        for v in range(50):
+            assert limited.push(v)
+
+    actor = threading.Thread(target=act)
+    actor.start()
+    sampled = 0
+    while sampled < 50 * 2 - 8:
+        values, weights, indices = limited.sample(4)
+        sampled += len(values)
+    actor.join()
+
+    stats = limited.stats
+    assert stats.inserts == 50
+    assert stats.samples == sampled
+    assert stats.sample_timeouts == 1
+
+    limited.stop()
+    assert not limited.push(0)
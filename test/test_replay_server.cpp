@@ -0,0 +1,222 @@
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+namespace {
+
+std::string socket_path(const std::string& stem)
+{
+   return "/tmp/per_test_" + stem + "_" + std::to_string(getpid()) + ".sock";
+}
+
+/// runs the server's event loop on a background thread for the lifetime of the fixture object
+struct ServingThread {
+   per::ReplayServer& server;
+   std::thread thread{[this] { server.serve(); }};
+
+   ~ServingThread()
+   {
+      server.stop();
+      thread.join();
+   }
+};
+
+/// listens on a socket path and answers the first connection with the given raw bytes
+struct RawServer {
+   std::string path;
+   std::vector< char > response;
+   int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   std::thread thread;
+
+   RawServer(std::string path_, std::vector< char > response_)
+       : path(std::move(path_)), response(std::move(response_))
+   {
+      auto address = per::ReplayProtocol::make_address(path);
+      if(bind(fd, reinterpret_cast< sockaddr* >(&address), sizeof(address)) != 0
+         or listen(fd, 1) != 0) {
+         throw std::system_error(errno, std::generic_category(), "bind " + path);
+      }
+      thread = std::thread([this] {
+         int connection = accept(fd, nullptr, nullptr);
+         per::ReplayProtocol::write_all(connection, response.data(), response.size());
+         // wait for the client to close the connection
+         char byte;
+         while(recv(connection, &byte, 1, 0) > 0) {
+         }
+         close(connection);
+      });
+   }
+
+   ~RawServer()
+   {
+      thread.join();
+      close(fd);
+      unlink(path.c_str());
+   }
+};
+
+}  // namespace
+
+TEST(ReplayServer, matches_prioritized_experience)
+{
+   per::ReplayServer server(socket_path("match"), 20, 0.7, 1., 0);
+   per::PrioritizedExperience< std::string > plain(20, 0.7, 1., 0);
+   ServingThread serving{server};
+   per::ReplayClient client(server.socket_path());
+
+   std::vector< std::string > values;
+   for(int v = 0; v < 30; v++) {
+      values.push_back(std::to_string(v));
+      plain.push(std::to_string(v));
+   }
+   ASSERT_EQ(client.push(values), 30);
+   ASSERT_EQ(client.update({3, 7, 11}, {5., 0.1, 2.}), 3);
+   plain.update({3, 7, 11}, {5., 0.1, 2.});
+
+   per::ReplaySampleBatch batch;
+   for(int i = 0; i < 5; i++) {
+      client.sample(6, batch);
+      auto [plain_values, plain_weights, plain_indices] = plain.sample(6);
+      ASSERT_EQ(batch.size(), 6);
+      for(size_t j = 0; j < batch.size(); j++) {
+         ASSERT_EQ(batch.value(j), plain_values[j]);
+         ASSERT_EQ(batch.indices[j], plain_indices[j]);
+         ASSERT_DOUBLE_EQ(batch.weights[j], plain_weights[j]);
+      }
+   }
+}
+
+TEST(ReplayServer, pipelining)
+{
+   per::ReplayServer server(socket_path("pipeline"), 10, 1., 1., 0);
+   ServingThread serving{server};
+   per::ReplayClient client(server.socket_path());
+
+   client.send_push({"a", "bb", "ccc"});
+   client.send_sample(2);
+   client.send_sample(5);
+   ASSERT_EQ(client.pending(), 3);
+
+   per::ReplaySampleBatch batch;
+   ASSERT_EQ(client.receive_ack(), 3);
+   client.receive_sample(batch);
+   ASSERT_EQ(batch.size(), 2);
+   // the buffer only holds 3 samples, hence a larger request is capped
+   client.receive_sample(batch);
+   ASSERT_EQ(batch.size(), 3);
+   std::vector< std::string > received;
+   for(size_t i = 0; i < batch.size(); i++) {
+      received.emplace_back(batch.value(i));
+   }
+   std::sort(received.begin(), received.end());
+   ASSERT_EQ(received, (std::vector< std::string >{"a", "bb", "ccc"}));
+   ASSERT_EQ(client.pending(), 0);
+   ASSERT_THROW(client.receive_ack(), std::logic_error);
+}
+
+TEST(ReplayServer, errors_keep_connection)
+{
+   per::ReplayServer server(socket_path("error"), 4, 1., 1., 0);
+   ServingThread serving{server};
+   per::ReplayClient client(server.socket_path());
+
+   client.push({"x", "y"});
+   ASSERT_THROW(client.update({17}, {1.}), std::runtime_error);
+   ASSERT_THROW(client.update({0, 1}, {1.}), std::invalid_argument);
+   ASSERT_EQ(client.pending(), 0);
+   ASSERT_EQ(client.update({0, 1}, {1., 2.}), 2);
+
+   // receiving the response of a different request type skips its payload
+   client.send_sample(2);
+   ASSERT_THROW(client.receive_ack(), std::runtime_error);
+   ASSERT_EQ(client.pending(), 0);
+   ASSERT_EQ(client.update({0}, {3.}), 1);
+
+   per::ReplayClient other(server.socket_path());
+   ASSERT_EQ(other.push({"z"}), 1);
+   per::ReplaySampleBatch batch;
+   client.sample(3, batch);
+   ASSERT_EQ(batch.size(), 3);
+}
+
+TEST(ReplayServer, answers_before_shutdown)
+{
+   per::ReplayServer server(socket_path("shutdown"), 4, 1., 1., 0);
+   ServingThread serving{server};
+   int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   auto address = per::ReplayProtocol::make_address(server.socket_path());
+   ASSERT_EQ(connect(fd, reinterpret_cast< sockaddr* >(&address), sizeof(address)), 0);
+
+   // a push of the single value "v" and a sample request, sent before shutting down the writing
+   // side of the connection
+   std::vector< char > request;
+   per::ReplayProtocol::append(
+      request, per::ReplayProtocol::make_header(per::ReplayOp::push, 3 * sizeof(uint64_t) + 1));
+   per::ReplayProtocol::append(request, std::vector< uint64_t >{1, 0, 1}.data(), 3);
+   per::ReplayProtocol::append(request, 'v');
+   per::ReplayProtocol::append(
+      request, per::ReplayProtocol::make_header(per::ReplayOp::sample, sizeof(uint64_t)));
+   per::ReplayProtocol::append(request, uint64_t(1));
+   per::ReplayProtocol::write_all(fd, request.data(), request.size());
+   ASSERT_EQ(shutdown(fd, SHUT_WR), 0);
+
+   per::ReplayMessageHeader header;
+   uint64_t n = 0;
+   per::ReplayProtocol::read_all(fd, &header, sizeof(header));
+   ASSERT_EQ(header.op, per::ReplayOp::ack);
+   per::ReplayProtocol::read_all(fd, &n, sizeof(n));
+   ASSERT_EQ(n, 1);
+   per::ReplayProtocol::read_all(fd, &header, sizeof(header));
+   ASSERT_EQ(header.op, per::ReplayOp::batch);
+   std::vector< char > payload(header.payload_bytes);
+   per::ReplayProtocol::read_all(fd, payload.data(), payload.size());
+   ASSERT_EQ(payload.back(), 'v');
+   // the server closes the connection once the responses are sent
+   char byte;
+   ASSERT_EQ(recv(fd, &byte, 1, 0), 0);
+   close(fd);
+}
+
+TEST(ReplayClient, rejects_inconsistent_responses)
+{
+   using per::ReplayOp;
+   using per::ReplayProtocol;
+   std::vector< char > response;
+   // an acknowledgement with a payload of two counts
+   ReplayProtocol::append(response, ReplayProtocol::make_header(ReplayOp::ack, 16));
+   ReplayProtocol::append(response, std::vector< uint64_t >{1, 2}.data(), 2);
+   // a batch whose count exceeds its payload
+   ReplayProtocol::append(response, ReplayProtocol::make_header(ReplayOp::batch, 24));
+   ReplayProtocol::append(response, std::vector< uint64_t >{uint64_t(1) << 60u, 0, 0}.data(), 3);
+   // a batch with decreasing offsets
+   ReplayProtocol::append(response, ReplayProtocol::make_header(ReplayOp::batch, 66));
+   ReplayProtocol::append(response, uint64_t(2));
+   ReplayProtocol::append(response, std::vector< uint64_t >{0, 1}.data(), 2);
+   ReplayProtocol::append(response, std::vector< double >{1., 1.}.data(), 2);
+   ReplayProtocol::append(response, std::vector< uint64_t >{0, 3, 2}.data(), 3);
+   ReplayProtocol::append(response, "ab", 2);
+   // a valid acknowledgement
+   ReplayProtocol::append(response, ReplayProtocol::make_header(ReplayOp::ack, 8));
+   ReplayProtocol::append(response, uint64_t(5));
+   RawServer server(socket_path("raw"), response);
+
+   {
+      per::ReplayClient client(server.path);
+      client.send_update({0}, {1.});
+      client.send_sample(1);
+      client.send_sample(2);
+      client.send_update({0}, {1.});
+      per::ReplaySampleBatch batch;
+      ASSERT_THROW(client.receive_ack(), std::runtime_error);
+      ASSERT_THROW(client.receive_sample(batch), std::runtime_error);
+      ASSERT_THROW(client.receive_sample(batch), std::runtime_error);
+      // the inconsistent payloads are skipped, hence the stream remains in sync
+      ASSERT_EQ(client.receive_ack(), 5);
+   }
+}
@@ -0,0 +1,34 @@
+import os
+import threading
+
+import pyper
+
+
+def test_replay_server_roundtrip():
+    socket_path = f"/tmp/pyper_test_{os.getpid()}.sock"
+    server = pyper.ReplayServer(socket_path, capacity=10, seed=0)
+    serving = threading.Thread(target=server.serve)
+    serving.start()
+    try:
+        client = pyper.ReplayClient(socket_path)
+        assert client.push([b"a", b"bb", b"ccc"]) == 3
+
+        values, weights, indices = client.sample(3)
+        assert sorted(values) == [b"a", b"bb", b"ccc"]
+        assert len(weights) == len(indices) == 3
+        assert client.update(indices, [1.0, 2.0, 3.0]) == 3
+
+        # pipelined requests are answered in order
+        batch = pyper.ReplaySampleBatch()
+        client.send_sample(2)
+        client.send_push([b"dddd"])
+        assert client.pending == 2
+        client.receive_sample(batch)
+        assert len(batch) == 2
+        assert client.receive_ack() == 1
+
+        client.sample_into(4, batch)
+        assert sorted(batch.values) == [b"a", b"bb", b"ccc", b"dddd"]
+    finally:
+        server.stop()
+        serving.join()
@@ -0,0 +1,147 @@
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <numeric>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+namespace {
+
+std::string unique_name(const std::string& stem)
+{
+   return "/per_test_" + stem + "_" + std::to_string(getpid());
+}
+
+}  // namespace
+
+TEST(SharedPrioritizedExperience, matches_prioritized_experience)
+{
+   per::SharedPrioritizedExperience shared(unique_name("match"), 20, 16, 0.7, 1., 0);
+   per::PrioritizedExperience< std::string > plain(20, 0.7, 1., 0);
+   for(int v = 0; v < 30; v++) {
+      shared.push(std::to_string(v));
+      plain.push(std::to_string(v));
+   }
+   shared.update({3, 7, 11}, {5., 0.1, 2.});
+   plain.update({3, 7, 11}, {5., 0.1, 2.});
+   // evicting a sample updated above the maximum keeps the maximum
+   shared.update({10}, {3.});
+   plain.update({10}, {3.});
+   for(int v = 30; v < 45; v++) {
+      shared.push(std::to_string(v));
+      plain.push(std::to_string(v));
+   }
+
+   ASSERT_EQ(shared.size(), 20);
+   for(int i = 0; i < 5; i++) {
+      auto [shared_values, shared_weights, shared_indices] = shared.sample(6);
+      auto [plain_values, plain_weights, plain_indices] = plain.sample(6);
+      ASSERT_EQ(shared_values, plain_values);
+      ASSERT_EQ(shared_indices, plain_indices);
+   }
+}
+
+TEST(SharedPrioritizedExperience, attach)
+{
+   auto name = unique_name("attach");
+   per::SharedPrioritizedExperience owner(name, 8, 4, 1., 1., 0);
+   {
+      per::SharedPrioritizedExperience attached(name);
+      ASSERT_FALSE(attached.owner());
+      ASSERT_EQ(attached.capacity(), 8);
+      ASSERT_EQ(attached.slot_size(), 4);
+      attached.push(std::string("abcd"));
+      ASSERT_THROW(attached.push(std::string("abcde")), std::invalid_argument);
+   }
+   auto [values, weights, indices] = owner.sample(1);
+   ASSERT_EQ(values, std::vector< std::string >{"abcd"});
+   ASSERT_THROW(per::SharedPrioritizedExperience(name, 8, 4), std::system_error);
+   owner.unlink();
+   ASSERT_THROW(per::SharedPrioritizedExperience{name}, std::system_error);
+}
+
+TEST(SharedPrioritizedExperience, push_from_other_process)
+{
+   auto name = unique_name("fork");
+   per::SharedPrioritizedExperience owner(name, 100, 8, 1., 1., 0);
+   std::vector< pid_t > children;
+   for(int child = 0; child < 4; child++) {
+      auto pid = fork();
+      ASSERT_GE(pid, 0);
+      if(pid == 0) {
+         per::SharedPrioritizedExperience actor(name);
+         for(int v = 0; v < 10; v++) {
+            actor.push(std::to_string(child) + "-" + std::to_string(v));
+         }
+         _exit(0);
+      }
+      children.emplace_back(pid);
+   }
+   for(auto pid : children) {
+      int status = 0;
+      waitpid(pid, &status, 0);
+      ASSERT_TRUE(WIFEXITED(status) and WEXITSTATUS(status) == 0);
+   }
+   ASSERT_EQ(owner.size(), 40);
+   auto [values, weights, indices] = owner.sample(40);
+   std::sort(values.begin(), values.end());
+   ASSERT_EQ(std::unique(values.begin(), values.end()), values.end());
+   ASSERT_EQ(values.front(), "0-0");
+   ASSERT_EQ(values.back(), "3-9");
+}
+
+#if OS == LINUX
+TEST(SharedPrioritizedExperience, sampler_dies_holding_the_lock)
+{
+   auto name = unique_name("robust");
+   size_t capacity = 4096;
+   per::SharedPrioritizedExperience owner(name, capacity, 8, 1., 1., 0);
+   for(size_t v = 0; v < capacity; v++) {
+      owner.push(std::to_string(v));
+   }
+   std::vector< size_t > all(capacity);
+   std::iota(all.begin(), all.end(), 0);
+   owner.update(all, std::vector< double >(capacity, 2.));
+
+   int ready[2];
+   ASSERT_EQ(pipe(ready), 0);
+   auto pid = fork();
+   ASSERT_GE(pid, 0);
+   if(pid == 0) {
+      per::SharedPrioritizedExperience sampler(name);
+      char byte = 0;
+      [[maybe_unused]] auto written = write(ready[1], &byte, 1);
+      // the lock is held for almost the entire loop, hence the kill lands in a sampling
+      while(true) {
+         sampler.sample(capacity);
+      }
+   }
+   char byte = 0;
+   ASSERT_EQ(read(ready[0], &byte, 1), 1);
+   std::this_thread::sleep_for(std::chrono::milliseconds(50));
+   kill(pid, SIGKILL);
+   int status = 0;
+   waitpid(pid, &status, 0);
+   close(ready[0]);
+   close(ready[1]);
+
+   // the masked leaves are restored, hence a full sample draws every entry exactly once
+   auto [values, weights, indices] = owner.sample(capacity);
+   std::sort(indices.begin(), indices.end());
+   ASSERT_EQ(indices, all);
+   // pushing evicts a holder of the maximum priority, which is recomputed to 2 from the restored
+   // leaves. The next sample enters with it and is weighted by about 2 / total * capacity = 1.
+   owner.push(std::string("new"));
+   owner.push(std::string("newer"));
+   auto [all_values, all_weights, all_indices] = owner.sample(capacity);
+   auto position = std::find(all_indices.begin(), all_indices.end(), 1) - all_indices.begin();
+   ASSERT_EQ(all_values[static_cast< size_t >(position)], "newer");
+   ASSERT_NEAR(all_weights[static_cast< size_t >(position)], 1., 1e-3);
+}
+#endif
@@ -0,0 +1,38 @@
+import multiprocessing
+import os
+import pickle
+
+import pyper
+
+
+def _act(buffer, actor):
+    for v in range(10):
+        buffer.push(f"{actor}-{v}".encode())
+
+
+def test_shared_per_multiprocessing():
+    name = f"pyper_test_{os.getpid()}"
+    buffer = pyper.SharedPrioritizedExperience(name, capacity=100, slot_size=16, seed=0)
+    assert buffer.owner
+
+    ctx = multiprocessing.get_context("spawn")
+    actors = [ctx.Process(target=_act, args=(buffer, actor)) for actor in range(4)]
+    for actor in actors:
+        actor.start()
+    for actor in actors:
+        actor.join()
+        assert actor.exitcode == 0
+
+    assert len(buffer) == 40
+    values, weights, indices = buffer.sample(40)
+    assert sorted(values) == sorted(f"{a}-{v}".encode() for a in range(4) for v in range(10))
+
+
+def test_shared_per_attach():
+    name = f"pyper_test_attach_{os.getpid()}"
+    buffer = pyper.SharedPrioritizedExperience(name, capacity=10, slot_size=8, seed=0)
+    attached = pickle.loads(pickle.dumps(buffer))
+    assert not attached.owner
+    attached.push([b"a", b"bc"])
+    assert len(buffer) == 2
+    assert sorted(buffer.sample(2)[0]) == [b"a", b"bc"]
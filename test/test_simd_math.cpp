@@ -0,0 +1,77 @@
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "per/per.hpp"
+
+TEST(SimdMath, pow_abs_accuracy)
+{
+   std::mt19937_64 rng(0);
+   std::uniform_real_distribution< double > log_dist(-30., 30.);
+   // an odd size leaves a remainder for the scalar tail of every kernel
+   size_t n = 1001;
+   std::vector< double > in(n);
+   for(size_t i = 0; i < n; i++) {
+      in[i] = std::exp(log_dist(rng)) * (i % 2 == 0 ? 1. : -1.);
+   }
+   in[3] = 0.;
+   in[7] = 1e-310;
+   in[9] = std::numeric_limits< double >::infinity();
+   in[11] = 1e300;
+   for(auto isa : {per::SimdIsa::scalar, per::SimdIsa::avx2, per::SimdIsa::avx512}) {
+      if(not per::simd_supported(isa)) {
+         ASSERT_THROW(per::pow_abs(in.data(), in.data(), n, 1., isa), std::invalid_argument);
+         continue;
+      }
+      for(double exponent : {0.6, 1., 2.5, -0.4}) {
+         std::vector< double > out(n);
+         per::pow_abs(in.data(), out.data(), n, exponent, isa);
+         // the output may overwrite the input
+         auto in_place = in;
+         per::pow_abs(in_place.data(), in_place.data(), n, exponent, isa);
+         ASSERT_EQ(in_place, out);
+         for(size_t i = 0; i < n; i++) {
+            double expected = std::pow(std::abs(in[i]), exponent);
+            if(expected == 0. or std::isinf(expected)) {
+               ASSERT_EQ(out[i], expected);
+            } else {
+               // twice the documented bound (|e log x| + 4) 2^-53
+               double bound = 2. * (std::abs(std::log(expected)) + 4.) * 0x1p-53;
+               ASSERT_NEAR(out[i] / expected, 1., bound) << "input " << in[i];
+            }
+         }
+      }
+   }
+}
+
+TEST(SimdMath, buffer_matches_scalar_pow)
+{
+   size_t capacity = 200;
+   double alpha = 0.6;
+   double beta = 0.4;
+   per::PrioritizedExperience< int > per(capacity, alpha, beta, 0);
+   std::vector< int > values(capacity);
+   std::vector< size_t > indices(capacity);
+   std::vector< double > priorities(capacity);
+   for(size_t i = 0; i < capacity; i++) {
+      values[i] = static_cast< int >(i);
+      indices[i] = i;
+      priorities[i] = 0.01 * static_cast< double >(i + 1) * (i % 3 == 0 ? -1. : 1.);
+   }
+   per.push(values);
+   per.update(indices, priorities);
+   double total = 0.;
+   for(double priority : priorities) {
+      total += std::pow(std::abs(priority), alpha);
+   }
+   ASSERT_NEAR(per.total(), total, 1e-12 * total);
+
+   // switching alpha re-exponentiates the held priorities
+   per.alpha(0.9);
+   total = 0.;
+   for(double priority : priorities) {
+      total += std::pow(std::abs(priority), 0.9);
+   }
+   ASSERT_NEAR(per.total(), total, 1e-12 * total);
+}
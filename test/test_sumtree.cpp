@@ -1,4 +1,6 @@
 
+#include <random>
+
 #include <pybind11/embed.h>
 #include <pybind11/pybind11.h>
 
@@ -83,3 +85,266 @@ TEST(SumTree, PriorityIterator)
       }
    }
 }
+
+TEST(SumTree, BulkInsert)
+{
+   // batches which fit, wrap around the capacity, and exceed the capacity
+   for(auto batch : std::vector< size_t >{3, 5, 17}) {
+      per::SumTree< int > sequential(7);
+      per::SumTree< int > bulk(7);
+      size_t n_evicted = 0;
+      int value = 0;
+      for(int round = 0; round < 4; round++) {
+         std::vector< int > values;
+         std::vector< double > priorities;
+         for(size_t i = 0; i < batch; i++, value++) {
+            values.push_back(value);
+            priorities.push_back(1. + value % 5);
+            n_evicted += sequential.insert(value, 1. + value % 5).has_value();
+         }
+         auto evicted = bulk.insert(values, priorities);
+         ASSERT_LE(evicted.size(), 7);
+
+         ASSERT_EQ(bulk.size(), sequential.size());
+         ASSERT_EQ(bulk.cursor(), sequential.cursor());
+         ASSERT_NEAR(bulk.total(), sequential.total(), 1e-12);
+         for(size_t i = 0; i < bulk.size(); i++) {
+            ASSERT_EQ(bulk[i], sequential[i]);
+            ASSERT_EQ(bulk.priority(i), sequential.priority(i));
+            ASSERT_EQ(bulk.generation(i), sequential.generation(i));
+         }
+         for(double target : {0., 0.3, 0.5, 0.99, 1.}) {
+            ASSERT_EQ(bulk.find(target), sequential.find(target));
+         }
+      }
+      ASSERT_GT(n_evicted, 0);
+   }
+}
+
+TEST(SumTree, LowestPriorityEviction)
+{
+   per::SumTree< int > tree(8, per::EvictionPolicy::lowest_priority);
+   for(int i = 0; i < 8; i++) {
+      tree.insert(i, 1. + i);
+   }
+   tree.update(5, 0.5);
+   auto evicted = tree.insert(100, 10.);
+   ASSERT_TRUE(evicted.has_value());
+   ASSERT_EQ(std::get< 0 >(evicted.value()), 5);
+   ASSERT_EQ(tree[5], 100);
+   ASSERT_EQ(tree.generation(5), 2);
+   // the lowest priority is now held by the element at index 0
+   evicted = tree.insert(101, 0.1);
+   ASSERT_EQ(std::get< 0 >(evicted.value()), 0);
+   evicted = tree.insert(102, 5.);
+   ASSERT_EQ(std::get< 0 >(evicted.value()), 101);
+   ASSERT_NEAR(tree.total(), 2. + 3. + 4. + 5. + 10. + 7. + 8. + 5., 1e-12);
+}
+
+TEST(SumTree, ReservoirEviction)
+{
+   size_t capacity = 100;
+   size_t n = 10000;
+   per::SumTree< size_t > tree(capacity, per::EvictionPolicy::reservoir, 0);
+   for(size_t i = 0; i < n; i++) {
+      tree.insert(i, 1.);
+   }
+   ASSERT_EQ(tree.size(), capacity);
+   ASSERT_NEAR(tree.total(), static_cast< double >(capacity), 1e-9);
+   // every element is retained with probability capacity / n, hence the retained elements are
+   // spread uniformly over the insertion history
+   size_t late = 0;
+   for(size_t i = 0; i < capacity; i++) {
+      late += tree[i] >= n / 2;
+   }
+   ASSERT_GT(late, 30);
+   ASSERT_LT(late, 70);
+}
+
+TEST(SumTree, FixedCapacity)
+{
+   per::SumTree< int, 13 > fixed(13, per::EvictionPolicy::lowest_priority);
+   per::SumTree< int > dynamic(13, per::EvictionPolicy::lowest_priority);
+   static_assert(per::SumTree< int, 13 >::fixed_leaf_level == 5);
+   ASSERT_THROW((per::SumTree< int, 13 >(12)), std::invalid_argument);
+   for(int i = 0; i < 40; i++) {
+      ASSERT_EQ(fixed.insert(i, 1. + i % 7), dynamic.insert(i, 1. + i % 7));
+   }
+   fixed.update(3, 0.25);
+   dynamic.update(3, 0.25);
+   ASSERT_EQ(fixed.insert({50, 51}, {2., 3.}), dynamic.insert({50, 51}, {2., 3.}));
+
+   ASSERT_EQ(fixed.size(), dynamic.size());
+   ASSERT_NEAR(fixed.total(), dynamic.total(), 1e-12);
+   ASSERT_TRUE(std::equal(fixed.value_begin(), fixed.value_end(), dynamic.value_begin()));
+   ASSERT_TRUE(std::equal(fixed.priority_begin(), fixed.priority_end(), dynamic.priority_begin()));
+   for(double target : {0., 0.1, 0.5, 0.77, 1.}) {
+      ASSERT_EQ(fixed.find(target), dynamic.find(target));
+   }
+
+   // a single leaf is the root itself
+   per::SumTree< int, 1 > single(1);
+   single.insert(7, 2.);
+   ASSERT_EQ(single.get(0.5), std::make_tuple(size_t(0), 7, 2.));
+}
+
+TEST(SumTree, ScalePriorities)
+{
+   per::SumTree< int > scaled(6, per::EvictionPolicy::lowest_priority);
+   per::SumTree< int > reference(6, per::EvictionPolicy::lowest_priority);
+   for(int i = 0; i < 6; i++) {
+      scaled.insert(i, 1. + i);
+      reference.insert(i, (1. + i) * 0.5);
+   }
+   scaled.scale_priorities(0.5);
+   ASSERT_EQ(scaled.scale(), 0.5);
+   ASSERT_NEAR(scaled.total(), reference.total(), 1e-12);
+   scaled.update(2, 4.);
+   reference.update(2, 4.);
+   ASSERT_EQ(scaled.insert(6, 0.25), reference.insert(6, 0.25));
+   for(size_t i = 0; i < scaled.size(); i++) {
+      ASSERT_NEAR(scaled.priority(i), reference.priority(i), 1e-12);
+   }
+   ASSERT_NEAR(scaled.total(), reference.total(), 1e-12);
+   for(double target : {0., 0.2, 0.5, 0.9}) {
+      ASSERT_EQ(scaled.find(target), reference.find(target));
+      ASSERT_EQ(scaled.find(target * reference.total(), false), reference.find(target));
+   }
+
+   // repeated decays are renormalized before the stored priorities overflow
+   for(int i = 0; i < 1000; i++) {
+      scaled.scale_priorities(0.5);
+   }
+   ASSERT_GE(scaled.scale(), 1e-100);
+   scaled.update(0, 1.);
+   ASSERT_NEAR(scaled.total(), 1., 1e-12);
+   scaled.renormalize();
+   ASSERT_EQ(scaled.scale(), 1.);
+   ASSERT_EQ(scaled.priority(0), 1.);
+   ASSERT_THROW(scaled.scale_priorities(0.), std::invalid_argument);
+}
+
+TEST(SumTree, Resize)
+{
+   per::SumTree< int > tree(5);
+   for(int i = 0; i < 7; i++) {
+      tree.insert(i, 1. + i);
+   }
+   auto generation = tree.generation(0);
+   // the ring wrapped around, hence the elements are relinked oldest first
+   ASSERT_TRUE(tree.resize(8).empty());
+   ASSERT_EQ(tree.capacity(), 8);
+   ASSERT_EQ(tree.size(), 5);
+   ASSERT_EQ(tree.cursor(), 5);
+   ASSERT_GT(tree.generation(0), generation);
+   for(size_t i = 0; i < tree.size(); i++) {
+      ASSERT_EQ(tree[i], i + 2);
+      ASSERT_EQ(tree.priority(i), 3. + static_cast< double >(i));
+   }
+   ASSERT_EQ(tree.total(), 25.);
+   ASSERT_FALSE(tree.insert(7, 8.).has_value());
+
+   // shrinking evicts the oldest elements
+   auto evicted = tree.resize(3);
+   ASSERT_EQ(evicted.size(), 3);
+   ASSERT_EQ(evicted[0], std::make_tuple(2, 3.));
+   ASSERT_EQ(evicted[2], std::make_tuple(4, 5.));
+   ASSERT_EQ(tree.size(), 3);
+   ASSERT_EQ(tree.total(), 21.);
+   ASSERT_EQ(tree.get(0.), std::make_tuple(size_t(0), 5, 6.));
+   ASSERT_EQ(tree.insert(8, 1.), std::make_tuple(5, 6.));
+
+   // a tree that has not wrapped around grows in place
+   per::SumTree< int > growing(3);
+   growing.insert(0, 1.);
+   growing.insert(1, 2.);
+   growing.scale_priorities(0.5);
+   growing.reserve(4);
+   growing.reserve(2);
+   ASSERT_EQ(growing.capacity(), 4);
+   ASSERT_EQ(growing.cursor(), 2);
+   ASSERT_EQ(growing.total(), 1.5);
+   growing.resize(9);
+   ASSERT_EQ(growing.scale(), 0.5);
+   ASSERT_EQ(growing.priority(1), 1.);
+   ASSERT_EQ(growing.total(), 1.5);
+
+   // the min-tree is relinked as well
+   per::SumTree< int > lowest(4, per::EvictionPolicy::lowest_priority);
+   for(int i = 0; i < 4; i++) {
+      lowest.insert(i, std::vector< double >{3., 1., 2., 4.}[static_cast< size_t >(i)]);
+   }
+   lowest.resize(2);
+   ASSERT_EQ(lowest.insert(9, 5.), std::make_tuple(2, 2.));
+
+   per::SumTree< int, 4 > fixed(4);
+   ASSERT_THROW(fixed.resize(8), std::logic_error);
+   ASSERT_THROW(tree.resize(0), std::invalid_argument);
+}
+
+TEST(SumTree, Assign)
+{
+   per::SumTree< int > tree(4, per::EvictionPolicy::lowest_priority);
+   tree.insert(9, 9.);
+   tree.scale_priorities(0.5);
+   auto generation = tree.generation(0);
+   // a full tree continues its ring at the given cursor
+   tree.assign({0, 1, 2, 3}, {1., 2., 3., 4.}, 2);
+   ASSERT_EQ(tree.size(), 4);
+   ASSERT_EQ(tree.cursor(), 2);
+   ASSERT_EQ(tree.scale(), 1.);
+   ASSERT_EQ(tree.total(), 10.);
+   ASSERT_GT(tree.generation(0), generation);
+   ASSERT_EQ(tree.get(0.45), std::make_tuple(size_t(2), 2, 3.));
+   // the min-tree is rebuilt as well
+   ASSERT_EQ(tree.insert(4, 5.), std::make_tuple(0, 1.));
+
+   tree.assign({7}, {2.}, 1);
+   ASSERT_EQ(tree.size(), 1);
+   ASSERT_EQ(tree.total(), 2.);
+   ASSERT_THROW(tree.assign({7}, {2.}, 0), std::invalid_argument);
+   ASSERT_THROW(tree.assign({0, 1, 2, 3, 4}, {1., 1., 1., 1., 1.}, 0), std::invalid_argument);
+}
+
+TEST(SumTree, FindSorted)
+{
+   std::mt19937_64 rng(0);
+   std::uniform_real_distribution< double > dist(0., 1.);
+   per::SumTree< int > tree(1000);
+   for(int i = 0; i < 700; i++) {
+      // include empty leaves, which are never found
+      tree.insert(i, i % 7 == 0 ? 0. : dist(rng));
+   }
+   tree.scale_priorities(2.);
+   std::vector< double > targets(300);
+   for(auto& target : targets) {
+      target = dist(rng);
+   }
+   std::sort(targets.begin(), targets.end());
+   auto leaves = tree.find_sorted(targets);
+   ASSERT_EQ(leaves.size(), targets.size());
+   for(size_t i = 0; i < targets.size(); i++) {
+      ASSERT_EQ(leaves[i], tree.find(targets[i]));
+      ASSERT_NE(leaves[i] % 7, 0);
+   }
+   for(auto& target : targets) {
+      target *= tree.total();
+   }
+   ASSERT_EQ(tree.find_sorted(targets, false), leaves);
+   ASSERT_TRUE(tree.find_sorted({}).empty());
+}
+
+TEST(SumTree, FindSkipsEmptySubtrees)
+{
+   per::SumTree< int > tree(4);
+   tree.insert(0, 1.);
+   tree.insert(1, 1.);
+   tree.insert(2, 1.);
+   // a target beyond the total, as produced by rounding drift of the internal sums, ends in the
+   // last filled leaf instead of the unfilled one
+   ASSERT_EQ(tree.find(3.5, false), 2);
+   ASSERT_EQ(tree.find(1. + 1e-12), 2);
+   // a zero priority leaf is never found either
+   tree.update(2, 0.);
+   ASSERT_EQ(tree.find(2.5, false), 1);
+}
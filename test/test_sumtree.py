@@ -37,6 +37,15 @@ class TestSumTree:
             tree.insert(value=i, priority=2 * i)
         assert len(tree) == n - 3
 
+    def test_bulk_insert(self, default_trees):
+        for n, expected in default_trees.items():
+            tree = pyper.SumTree(n)
+            evicted = tree.insert(list(range(2 * n)), [2. * i for i in range(2 * n)])
+            assert evicted == []
+            assert len(tree) == n
+            assert tree.total == expected.total
+            assert list(tree.value_iter()) == list(expected.value_iter())
+
     def test_insert_and_get(self, default_trees):
         expected = {
             10: [5, 15, 30.],
@@ -67,3 +76,23 @@ class TestSumTree:
         for n, tree in default_trees.items():
             for (k, i), expected in zip(tree, range(n, 2 * n)):
                 assert k == expected, i == 2 * k
+
+    def test_scale_priorities(self, default_trees):
+        for n, tree in default_trees.items():
+            total = tree.total
+            tree.scale_priorities(0.5)
+            assert tree.scale == 0.5
+            assert abs(tree.total - total / 2) < 1e-9
+            for k, i in zip(tree.priority_iter(), range(n, 2 * n)):
+                assert k == i
+            assert tree.scale == 1.
+
+    def test_resize(self, default_trees):
+        for n, tree in default_trees.items():
+            tree.reserve(2 * n)
+            assert tree.capacity == 2 * n
+            assert len(tree) == n
+            evicted = tree.resize(n // 2)
+            assert evicted == [(n + i, 2 * (n + i)) for i in range(n - n // 2)]
+            assert len(tree) == n // 2
+            assert list(tree.value_iter()) == list(range(2 * n - n // 2, 2 * n))